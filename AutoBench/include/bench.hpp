@@ -0,0 +1,120 @@
+/**
+ * bench.hpp
+ * Minimal benchmark harness for the autonomous helper
+ *
+ * Copyright (c) 2018 FRC Team 2655 - The Flying Platypi
+ * See LICENSE file for details
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace bench{
+
+struct Result{
+	std::string name;
+	uint64_t iterations;
+	double nsPerIteration;
+	double allocsPerIteration;
+	double itemsPerSecond; // 0 unless the benchmark counts items
+};
+
+/**
+ * Number of calls to operator new made by the benchmark process so far
+ */
+uint64_t allocationCount();
+
+/**
+ * Results of every benchmark run so far
+ */
+std::vector<Result> &results();
+
+/**
+ * Should a benchmark run (matches --benchmark_filter). Check it before expensive setup so filtered out benchmarks cost nothing.
+ */
+bool shouldRun(const std::string &name);
+
+/**
+ * Record a benchmark result and print it
+ * @param itemsPerIteration Items processed by each call (reported as items per second when not 0)
+ */
+void report(const std::string &name, uint64_t iterations, double totalNs, uint64_t allocations, uint64_t itemsPerIteration = 0);
+
+/**
+ * Prevent the compiler from optimizing away a value
+ */
+template<class T>
+inline void doNotOptimize(const T &value){
+#ifdef _MSC_VER
+	static volatile const void *sink;
+	sink = &value;
+	_ReadWriteBarrier();
+#else
+	asm volatile("" : : "g"(&value) : "memory");
+#endif
+}
+
+/**
+ * Run a function repeatedly until minSeconds have passed and record the average time per call
+ * @param name The name of the benchmark
+ * @param fn The function to time
+ * @param minSeconds Minimum total time to run for
+ * @param itemsPerIteration Items processed by each call (reported as items per second when not 0)
+ */
+template<class F>
+void run(const std::string &name, F &&fn, double minSeconds = 0.5, uint64_t itemsPerIteration = 0){
+	typedef std::chrono::steady_clock Clock;
+	if(!shouldRun(name))
+		return;
+	fn(); // Warm up
+	uint64_t iterations = 0;
+	uint64_t allocations = allocationCount();
+	Clock::time_point start = Clock::now();
+	Clock::duration elapsed;
+	do{
+		fn();
+		iterations++;
+		elapsed = Clock::now() - start;
+	}while(elapsed < std::chrono::duration<double>(minSeconds));
+	allocations = allocationCount() - allocations;
+	report(name, iterations, (double)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(), allocations, itemsPerIteration);
+}
+
+/**
+ * Write a reproducible script with the given number of rows
+ * @param path Where to write the script
+ * @param rows The number of rows in the script
+ * @param seed Seed for the generator (same seed gives the same script)
+ */
+void writeSyntheticScript(const std::string &path, size_t rows, uint32_t seed = 2655);
+
+/**
+ * Write a dependency graph script where every row runs after the previous one
+ * @param path Where to write the script
+ * @param rows The number of rows in the script
+ */
+void writeChainScript(const std::string &path, size_t rows);
+
+/**
+ * Path of a script in the source tree (ex "Test.csv")
+ */
+std::string sourcePath(const std::string &relative);
+
+// Benchmark groups
+void loadBenchmarks();
+void runBenchmarks();
+void executorBenchmarks();
+void backgroundBenchmarks();
+void coroutineBenchmarks();
+void batchBenchmarks();
+void commandBenchmarks();
+
+}
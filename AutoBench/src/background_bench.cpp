@@ -0,0 +1,184 @@
+#include <bench.hpp>
+#include <quiet_commands.hpp>
+
+#include <utility>
+#include <string>
+
+using namespace team2655;
+using namespace quiet;
+
+namespace{
+
+// A background command with a fixed amount of independent work per tick (like vision processing)
+template<int Id>
+class BusyCommand : public TypedBackgroundAutoCommand<>{
+private:
+	double value = 0;
+public:
+	void updateArgs(std::string_view commandName, const std::tuple<> &args) override {  }
+	void process() override {
+		for(int i = 0; i < 20000; ++i){
+			value = value * 0.5 + i;
+		}
+		bench::doNotOptimize(value);
+	}
+	void kill() override {  }
+	bool shouldProcess() override { return true; }
+	bool isParallelSafe() override { return true; }
+};
+
+// A background command with nothing to do. Either polled (shouldProcess returns false every tick) or asleep.
+template<int Id, bool Sleeps>
+class IdleCommand : public TypedBackgroundAutoCommand<>{
+public:
+	void updateArgs(std::string_view commandName, const std::tuple<> &args) override {  }
+	void process() override {  }
+	void kill() override {  }
+	bool shouldProcess() override {
+		if(Sleeps)
+			sleep();
+		return false;
+	}
+};
+
+// A background command that is processed every tick but does almost nothing (the per command overhead)
+template<int Id>
+class LightCommand : public TypedBackgroundAutoCommand<>{
+private:
+	int count = 0;
+public:
+	void updateArgs(std::string_view commandName, const std::tuple<> &args) override {  }
+	void process() override { count++; }
+	void kill() override {  }
+	bool shouldProcess() override { return true; }
+};
+
+// One type registered many times with registerBackgroundInstance. Inactive instances go to sleep.
+class CounterCommand : public TypedBackgroundAutoCommand<>{
+private:
+	int count = 0;
+public:
+	bool active = true;
+	void updateArgs(std::string_view commandName, const std::tuple<> &args) override {  }
+	void process() override { count++; }
+	void kill() override {  }
+	bool shouldProcess() override {
+		if(!active)
+			sleep();
+		return active;
+	}
+};
+
+void registerCounters(AutoManager &manager, int registered, int active){
+	for(int i = 0; i < registered; ++i){
+		CounterCommand *command = manager.registerBackgroundInstance<CounterCommand>("counter" + std::to_string(i));
+		command->active = i < active;
+	}
+}
+
+template<int... Ids>
+void registerLight(AutoManager &manager, std::integer_sequence<int, Ids...>){
+	(manager.registerBackgroundCommand<LightCommand<Ids>>("light" + std::to_string(Ids)), ...);
+}
+
+template<bool Sleeps, int... Ids>
+void registerIdle(AutoManager &manager, std::integer_sequence<int, Ids...>){
+	(manager.registerBackgroundCommand<IdleCommand<Ids, Sleeps>>("idle" + std::to_string(Ids)), ...);
+}
+
+void registerBusy(AutoManager &manager){
+	manager.registerBackgroundCommand<BusyCommand<0>>("busy0");
+	manager.registerBackgroundCommand<BusyCommand<1>>("busy1");
+	manager.registerBackgroundCommand<BusyCommand<2>>("busy2");
+	manager.registerBackgroundCommand<BusyCommand<3>>("busy3");
+}
+
+}
+
+namespace bench{
+
+void backgroundBenchmarks(){
+	// One tick with 0, 10 and 100 background commands that are processed every tick
+	AutoManager light0;
+	registerCommands(light0);
+	light0.addCommand("drive", {"1000000"});
+	run("background/tick/0", [&](){
+		light0.process();
+	});
+
+	AutoManager light10;
+	registerCommands(light10);
+	registerLight(light10, std::make_integer_sequence<int, 10>());
+	light10.addCommand("drive", {"1000000"});
+	run("background/tick/10", [&](){
+		light10.process();
+	});
+
+	AutoManager light100;
+	registerCommands(light100);
+	registerLight(light100, std::make_integer_sequence<int, 100>());
+	light100.addCommand("drive", {"1000000"});
+	run("background/tick/100", [&](){
+		light100.process();
+	});
+
+	// Same as background/tick/100 with 100 instances of one type (processed in one batch)
+	AutoManager instances100;
+	registerCommands(instances100);
+	registerCounters(instances100, 100, 100);
+	instances100.addCommand("drive", {"1000000"});
+	run("background/instances/100", [&](){
+		instances100.process();
+	});
+
+	// Cost should follow the number of active commands, not the number registered
+	const int activeCounts[][2] = { { 10, 100 }, { 10, 1000 }, { 100, 1000 }, { 1000, 1000 } };
+	for(const auto &counts : activeCounts){
+		AutoManager manager;
+		registerCommands(manager);
+		registerCounters(manager, counts[1], counts[0]);
+		manager.addCommand("drive", {"1000000"});
+		manager.process(); // Inactive commands go to sleep
+		run("background/active/" + std::to_string(counts[0]) + "of" + std::to_string(counts[1]), [&](){
+			manager.process();
+		});
+	}
+
+	// One tick with four expensive background commands, serial vs fanned out to a pool
+	AutoManager serial;
+	registerCommands(serial);
+	registerBusy(serial);
+	serial.addCommand("drive", {"1000"});
+	run("background/busy4/serial", [&](){
+		serial.process();
+	});
+
+	WorkStealingPool pool;
+	AutoManager parallel;
+	registerCommands(parallel);
+	registerBusy(parallel);
+	parallel.setThreadPool(&pool);
+	parallel.addCommand("drive", {"1000"});
+	run("background/busy4/pool" + std::to_string(pool.size()), [&](){
+		parallel.process();
+	});
+
+	// One tick with 100 idle background commands. Sleeping commands are not looked at.
+	AutoManager polling;
+	registerCommands(polling);
+	registerIdle<false>(polling, std::make_integer_sequence<int, 100>());
+	polling.addCommand("drive", {"1000000"});
+	run("background/idle100/polling", [&](){
+		polling.process();
+	});
+
+	AutoManager sleeping;
+	registerCommands(sleeping);
+	registerIdle<true>(sleeping, std::make_integer_sequence<int, 100>());
+	sleeping.addCommand("drive", {"1000000"});
+	run("background/idle100/sleeping", [&](){
+		sleeping.process();
+	});
+}
+
+}
@@ -0,0 +1,73 @@
+#include <bench.hpp>
+#include <quiet_commands.hpp>
+#include <quiet_batch_commands.hpp>
+
+#include <vector>
+#include <memory>
+
+using namespace team2655;
+using namespace quiet;
+
+namespace{
+
+// Distance and lifter target of each instance
+double driveSeconds(size_t instance){ return 0.5 + (instance % 16) * 0.1; }
+int lifterTarget(size_t instance){ return (int)(instance % 20); }
+
+}
+
+namespace bench{
+
+void batchBenchmarks(){
+	const size_t instances = 1000;
+	if(!shouldRun("batch/Test.csv/1000") && !shouldRun("batch/separate_managers/1000"))
+		return; // Both need the instance ticks from a full batch run
+
+	// Test.csv with a different first DRIVE time and first MOVE_LIFTER target for each instance
+	AutoBatch batch;
+	registerBatchCommands(batch);
+	batch.loadScript(sourcePath("Test.csv"));
+	batch.setInstances(instances);
+	double *lifter = batch.argument(0, 0);
+	double *drive = batch.argument(1, 0);
+	for(size_t i = 0; i < instances; ++i){
+		lifter[i] = lifterTarget(i);
+		drive[i] = driveSeconds(i);
+	}
+
+	// Instance ticks: ticks each instance had commands left (same count for both benchmarks)
+	batch.run(100000);
+	uint64_t instanceTicks = 0;
+	for(size_t i = 0; i < instances; ++i){
+		instanceTicks += batch.finishTick(i);
+	}
+
+	run("batch/Test.csv/1000", [&](){
+		batch.run(100000);
+	}, 0.5, instanceTicks);
+
+	// The same instances as 1000 separate managers
+	if(!shouldRun("batch/separate_managers/1000"))
+		return;
+	std::vector<std::unique_ptr<AutoManager>> managers;
+	for(size_t i = 0; i < instances; ++i){
+		managers.emplace_back(new AutoManager());
+		AutoManager &manager = *managers.back();
+		registerCommands(manager);
+		manager.addCommand("move_lifter", {std::to_string(lifterTarget(i))});
+		manager.addCommand("drive", {std::to_string(driveSeconds(i))});
+		manager.addCommand("intake_in", {});
+		manager.addCommand("rotate", {"0.5"});
+		manager.addCommand("intake_stop", {});
+		manager.addCommand("move_lifter", {"5"});
+		manager.addCommand("drive", {"3"});
+	}
+	run("batch/separate_managers/1000", [&](){
+		for(auto &manager : managers){
+			manager->restartScript();
+			while(manager->process()){  }
+		}
+	}, 0.5, instanceTicks);
+}
+
+}
@@ -0,0 +1,70 @@
+#include <bench.hpp>
+#include <quiet_commands.hpp>
+
+#include <string>
+
+using namespace team2655;
+using namespace quiet;
+
+namespace{
+
+// Exposes the AutoManager internals measured here
+class BenchManager : public AutoManager{
+public:
+	using AutoManager::split;
+	using AutoManager::resolveName;
+	using AutoManager::acquireCommand;
+	using AutoManager::recycleCommand;
+};
+
+template<int Id>
+class NamedCommand : public quiet::TickCommand{  };
+
+template<int... Ids>
+void registerNamed(AutoManager &manager, std::integer_sequence<int, Ids...>){
+	(manager.registerCommand<NamedCommand<Ids>>("command" + std::to_string(Ids)), ...);
+}
+
+}
+
+namespace bench{
+
+void commandBenchmarks(){
+	BenchManager manager;
+	registerCommands(manager);
+
+	std::string line = "MOVE_LIFTER,10,0.5,true,some text";
+	run("command/split", [&](){
+		doNotOptimize(manager.split(line, ','));
+	});
+
+	// Name lookups with 4 and 104 registered names (what resolving each distinct script name costs)
+	run("command/lookup/4", [&](){
+		doNotOptimize(manager.resolveName("move_lifter"));
+	});
+	registerNamed(manager, std::make_integer_sequence<int, 100>());
+	run("command/lookup/104", [&](){
+		doNotOptimize(manager.resolveName("command57"));
+	});
+	run("command/lookup_miss/104", [&](){
+		doNotOptimize(manager.resolveName("not_registered"));
+	});
+
+	run("command/register/100", [&](){
+		AutoManager fresh;
+		registerNamed(fresh, std::make_integer_sequence<int, 100>());
+	});
+
+	// A command made by its creator and destroyed vs taken from and returned to the manager's pool
+	run("command/create_destroy", [&](){
+		CmdPointer command = CommandCreator<TickCommand>();
+		doNotOptimize(command);
+	});
+	run("command/pooled", [&](){
+		CmdPointer command = manager.acquireCommand(0);
+		doNotOptimize(command);
+		manager.recycleCommand(command, 0);
+	});
+}
+
+}
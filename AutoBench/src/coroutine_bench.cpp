@@ -0,0 +1,98 @@
+#include <bench.hpp>
+
+#include <autonomous.hpp>
+#include <autocoroutine.hpp>
+
+#include <fstream>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace team2655;
+
+namespace bench{
+
+#ifdef AUTOHELPER_HAS_COROUTINES
+
+// Waits a number of ticks written as a state machine
+class StepCommand : public TypedAutoCommand<int>{
+private:
+	int remaining = 0;
+public:
+	void start(std::string_view commandName, const std::tuple<int> &args) override {
+		remaining = std::get<0>(args);
+	}
+	void process() override {
+		if(remaining-- <= 0)
+			complete();
+	}
+	void handleComplete() override {  }
+};
+
+// The same command written as a coroutine
+class StepCoroutine : public CoroutineAutoCommand<int>{
+public:
+	AutoTask run(int ticks) override {
+		for(int i = 0; i < ticks; ++i){
+			co_await nextTick();
+		}
+	}
+};
+
+// Waits a number of ticks in a sub-command then sleeps
+class NestedCoroutine : public CoroutineAutoCommand<int>{
+private:
+	AutoTask wait(int ticks){
+		for(int i = 0; i < ticks; ++i){
+			co_await nextTick();
+		}
+	}
+public:
+	AutoTask run(int ticks) override {
+		co_await wait(ticks / 2);
+		co_await sleepFor(AutoTime(ticks - ticks / 2));
+	}
+};
+
+void coroutineBenchmarks(){
+	// 100 commands of 10 ticks each. Frames are reused from the manager's pool so runs should not allocate.
+	std::string path = "autohelper_bench_coroutine.csv";
+	{
+		std::ofstream file(path);
+		for(int i = 0; i < 100; ++i){
+			file << "step,10\n";
+		}
+	}
+
+	auto runScript = [&](const char *name, AutoManager &manager){
+		manager.loadScript(path);
+		run(name, [&](){
+			manager.restartScript();
+			int64_t tick = 0;
+			while(manager.process(AutoTime(tick++))){  }
+		});
+	};
+
+	AutoManager stateMachine;
+	stateMachine.registerCommand<StepCommand>("step");
+	runScript("coroutine/state_machine/100x10", stateMachine);
+
+	AutoManager coroutine;
+	coroutine.registerCommand<StepCoroutine>("step");
+	runScript("coroutine/coroutine/100x10", coroutine);
+
+	AutoManager nested;
+	nested.registerCommand<NestedCoroutine>("step");
+	runScript("coroutine/nested_sleep/100x10", nested);
+
+	std::remove(path.c_str());
+}
+
+#else
+
+void coroutineBenchmarks(){
+	std::printf("coroutine benchmarks skipped (not compiled as C++20)\n");
+}
+
+#endif
+
+}
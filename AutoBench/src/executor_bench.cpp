@@ -0,0 +1,71 @@
+#include <bench.hpp>
+#include <quiet_commands.hpp>
+#include <autoexecutor.hpp>
+#include <autosimulator.hpp>
+
+using namespace team2655;
+using namespace quiet;
+
+namespace bench{
+
+void executorBenchmarks(){
+	const size_t managerCount = 256;
+
+	// The same managers run serially on one thread and on the executor (barrier mode)
+	AutoExecutor executor;
+	for(size_t i = 0; i < managerCount; ++i){
+		AutoManager &manager = executor.add(std::unique_ptr<AutoManager>(new AutoManager()));
+		registerCommands(manager);
+		manager.loadScript(sourcePath("Test.csv"));
+	}
+
+	run("executor/serial/" + std::to_string(managerCount), [&](){
+		for(size_t i = 0; i < executor.size(); ++i){
+			executor.get(i).restartScript();
+		}
+		bool running = true;
+		while(running){
+			running = false;
+			AutoTime now = SteadyAutoClock::instance().now();
+			for(size_t i = 0; i < executor.size(); ++i){
+				running = executor.get(i).process(now) || running;
+			}
+		}
+	});
+
+	run("executor/barrier/" + std::to_string(managerCount), [&](){
+		for(size_t i = 0; i < executor.size(); ++i){
+			executor.get(i).restartScript();
+		}
+		while(executor.tick() > 0){  }
+	});
+
+	run("executor/free_running/" + std::to_string(managerCount), [&](){
+		for(size_t i = 0; i < executor.size(); ++i){
+			executor.get(i).restartScript();
+		}
+		executor.runFreeRunning();
+	});
+
+	// Parameter sweep: 1000 variants of Test.csv with a different first drive, simulated on every core
+	std::vector<SimulationCase> cases;
+	for(int i = 0; i < 1000; ++i){
+		SimulationCase simulationCase;
+		simulationCase.name = "drive_" + std::to_string(i);
+		simulationCase.setup = [i](AutoManager &manager){
+			registerCommands(manager);
+			if(!manager.loadScript(sourcePath("Test.csv")))
+				return false;
+			manager.addCommand("drive", { std::to_string(i / 1000.0) }, 0);
+			return true;
+		};
+		cases.push_back(simulationCase);
+	}
+	AutoSimulator simulator;
+	run("simulate/batch/1000", [&](){
+		std::vector<SimulationResult> results = simulator.runBatch(cases);
+		doNotOptimize(results);
+	}, 2.0);
+}
+
+}
@@ -0,0 +1,95 @@
+#include <bench.hpp>
+#include <quiet_commands.hpp>
+#include <autonomous.hpp>
+
+#include <fstream>
+#include <sstream>
+#include <regex>
+#include <cstdio>
+
+using namespace team2655;
+using namespace quiet;
+
+namespace{
+
+std::vector<std::string> split(const std::string& s, char delimiter){
+	std::vector<std::string> tokens;
+	std::string token;
+	std::istringstream tokenStream(s);
+	while (std::getline(tokenStream, token, delimiter)){
+		tokens.push_back(token);
+	}
+	return tokens;
+}
+
+// The stringstream + regex + split loader AutoManager::loadScript used before the single pass parser
+size_t legacyLoad(const std::string &fileName, std::vector<std::string> &commands, std::vector<std::vector<std::string>> &arguments){
+	commands.clear();
+	arguments.clear();
+	std::ifstream scriptFile;
+	scriptFile.open(fileName);
+	std::stringstream fileContents;
+	fileContents << scriptFile.rdbuf();
+	scriptFile.close();
+	std::string csvData = std::regex_replace(fileContents.str(), std::regex("(\r\n|\r|\n)"), "\n");
+	std::vector<std::string> lines = split(csvData, '\n');
+	for(size_t i = 0; i < lines.size(); i++){
+		std::vector<std::string> columns = split(lines[i], ',');
+		commands.push_back(columns[0]);
+		columns.erase(columns.begin());
+		arguments.push_back(columns);
+	}
+	return commands.size();
+}
+
+}
+
+namespace bench{
+
+void loadBenchmarks(){
+	const size_t sizes[] = { 100, 10000, 100000, 1000000 };
+	for(size_t rows : sizes){
+		std::string legacyName = "load/legacy_regex/" + std::to_string(rows);
+		std::string singlePassName = "load/single_pass/" + std::to_string(rows);
+		std::string binaryName = "load/binary/" + std::to_string(rows);
+		bool legacy = rows <= 100000 && shouldRun(legacyName); // The regex loader takes seconds per iteration beyond this
+		bool binary = shouldRun(binaryName);
+		if(!legacy && !binary && !shouldRun(singlePassName))
+			continue; // Writing the bigger scripts takes seconds
+
+		std::string path = "autohelper_bench_" + std::to_string(rows) + ".csv";
+		writeSyntheticScript(path, rows);
+
+		std::vector<std::string> commands;
+		std::vector<std::vector<std::string>> arguments;
+		if(legacy){
+			run(legacyName, [&](){
+				doNotOptimize(legacyLoad(path, commands, arguments));
+			});
+		}
+
+		AutoManager manager;
+		registerCommands(manager); // Loading fails if a row has no registered command
+		run(singlePassName, [&](){
+			manager.loadScript(path);
+			doNotOptimize(manager.loadedCommandCount());
+		});
+
+		// Same script precompiled with saveBinary (what AutoCompile writes)
+		std::string binaryPath = "autohelper_bench_" + std::to_string(rows) + ".bin";
+		if(binary){
+			AutoScript compiled;
+			compiled.loadCsv(path);
+			compiled.saveBinary(binaryPath);
+			run(binaryName, [&](){
+				manager.loadScript(binaryPath);
+				doNotOptimize(manager.loadedCommandCount());
+			});
+			std::remove(binaryPath.c_str());
+		}
+
+		std::remove(path.c_str());
+	}
+}
+
+}
@@ -0,0 +1,227 @@
+#include <bench.hpp>
+
+#include <iostream>
+#include <fstream>
+#include <random>
+#include <regex>
+#include <atomic>
+#include <thread>
+#include <ctime>
+#include <new>
+#include <cstdio>
+#include <cstdlib>
+
+// Count every allocation made by the process so benchmarks can report allocations per iteration
+static std::atomic<uint64_t> allocations{0};
+
+void *operator new(size_t size){
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	void *result = std::malloc(size == 0 ? 1 : size);
+	if(result == nullptr)
+		throw std::bad_alloc();
+	return result;
+}
+
+void operator delete(void *ptr) noexcept{
+	std::free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept{
+	std::free(ptr);
+}
+
+namespace{
+
+// Command line options (named like Google Benchmark's so the same scripts and compare tools work)
+struct Options{
+	std::string filter;            // --benchmark_filter=<regex>
+	bool json = false;             // --benchmark_format=json (JSON on stdout instead of the table)
+	std::string outPath;           // --benchmark_out=<file> (JSON)
+	std::string executable;
+};
+
+Options options;
+std::regex filterRegex;
+
+std::string jsonEscape(const std::string &text){
+	std::string escaped;
+	for(char c : text){
+		if(c == '"' || c == '\\')
+			escaped += '\\';
+		escaped += c;
+	}
+	return escaped;
+}
+
+// Same layout as Google Benchmark's JSON reporter. allocs_per_iter is reported like a user counter.
+void writeJson(std::ostream &out){
+	char date[64];
+	std::time_t now = std::time(nullptr);
+	std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S%z", std::localtime(&now));
+
+	out << "{\n";
+	out << "  \"context\": {\n";
+	out << "    \"date\": \"" << date << "\",\n";
+	out << "    \"executable\": \"" << jsonEscape(options.executable) << "\",\n";
+	out << "    \"num_cpus\": " << std::thread::hardware_concurrency() << ",\n";
+#ifdef NDEBUG
+	out << "    \"library_build_type\": \"release\"\n";
+#else
+	out << "    \"library_build_type\": \"debug\"\n";
+#endif
+	out << "  },\n";
+	out << "  \"benchmarks\": [";
+	const std::vector<bench::Result> &all = bench::results();
+	for(size_t i = 0; i < all.size(); ++i){
+		const bench::Result &result = all[i];
+		out << (i == 0 ? "\n" : ",\n");
+		out << "    {\n";
+		out << "      \"name\": \"" << jsonEscape(result.name) << "\",\n";
+		out << "      \"run_name\": \"" << jsonEscape(result.name) << "\",\n";
+		out << "      \"run_type\": \"iteration\",\n";
+		out << "      \"repetitions\": 1,\n";
+		out << "      \"repetition_index\": 0,\n";
+		out << "      \"threads\": 1,\n";
+		out << "      \"iterations\": " << result.iterations << ",\n";
+		out << "      \"real_time\": " << result.nsPerIteration << ",\n";
+		out << "      \"cpu_time\": " << result.nsPerIteration << ",\n"; // Only wall time is measured
+		out << "      \"time_unit\": \"ns\",\n";
+		out << "      \"allocs_per_iter\": " << result.allocsPerIteration;
+		if(result.itemsPerSecond > 0)
+			out << ",\n      \"items_per_second\": " << result.itemsPerSecond;
+		out << "\n";
+		out << "    }";
+	}
+	out << "\n  ]\n}\n";
+}
+
+void printUsage(){
+	std::cerr << "Usage: " << options.executable << " [--benchmark_filter=<regex>] [--benchmark_format=console|json] [--benchmark_out=<file>]" << std::endl;
+}
+
+bool parseOptions(int argc, char *argv[]){
+	options.executable = argv[0];
+	for(int i = 1; i < argc; ++i){
+		std::string arg = argv[i];
+		if(arg.rfind("--benchmark_filter=", 0) == 0){
+			options.filter = arg.substr(19);
+		}else if(arg == "--benchmark_format=json"){
+			options.json = true;
+		}else if(arg == "--benchmark_format=console"){
+			options.json = false;
+		}else if(arg.rfind("--benchmark_out=", 0) == 0){
+			options.outPath = arg.substr(16);
+		}else if(arg.rfind("--benchmark_out_format=", 0) == 0){
+			// Only JSON files are written
+		}else{
+			std::cerr << "Unknown option " << arg << std::endl;
+			printUsage();
+			return false;
+		}
+	}
+	if(!options.filter.empty()){
+		// std::regex reports a bad pattern by throwing
+		try{
+			filterRegex = std::regex(options.filter);
+		}catch(const std::regex_error &e){
+			std::cerr << "Invalid --benchmark_filter \"" << options.filter << "\": " << e.what() << std::endl;
+			printUsage();
+			return false;
+		}
+	}
+	return true;
+}
+
+}
+
+namespace bench{
+
+bool shouldRun(const std::string &name){
+	return options.filter.empty() || std::regex_search(name, filterRegex);
+}
+
+uint64_t allocationCount(){
+	return allocations.load(std::memory_order_relaxed);
+}
+
+std::string sourcePath(const std::string &relative){
+	return std::string(AUTOHELPER_SOURCE_DIR) + "/" + relative;
+}
+
+std::vector<Result> &results(){
+	static std::vector<Result> all;
+	return all;
+}
+
+void report(const std::string &name, uint64_t iterations, double totalNs, uint64_t allocations, uint64_t itemsPerIteration){
+	Result result;
+	result.name = name;
+	result.iterations = iterations;
+	result.nsPerIteration = totalNs / iterations;
+	result.allocsPerIteration = (double)allocations / iterations;
+	result.itemsPerSecond = itemsPerIteration * 1e9 / result.nsPerIteration;
+	results().push_back(result);
+	if(options.json)
+		return;
+	std::printf("%-48s %12llu iterations %16.1f ns/iter %12.1f allocs/iter", name.c_str(), (unsigned long long)iterations,
+			result.nsPerIteration, result.allocsPerIteration);
+	if(itemsPerIteration > 0)
+		std::printf(" %12.3gM items/s", result.itemsPerSecond / 1e6);
+	std::printf("\n");
+}
+
+void writeSyntheticScript(const std::string &path, size_t rows, uint32_t seed){
+	static const char *commands[] = { "DRIVE", "ROTATE", "INTAKE_IN", "INTAKE_OUT", "INTAKE_STOP", "MOVE_LIFTER" };
+	// Only raw mt19937 output is used (it is fully specified) so every platform writes the same script
+	std::mt19937 rng(seed);
+
+	std::ofstream file(path, std::ios::binary);
+	for(size_t i = 0; i < rows; ++i){
+		int command = (int)(rng() % 6);
+		file << commands[command];
+		if(command < 2){
+			file << "," << (rng() % 5000) / 1000.0;
+		}else if(command == 5){
+			file << "," << (int)(rng() % 20);
+		}
+		file << "\r\n";
+	}
+}
+
+void writeChainScript(const std::string &path, size_t rows){
+	std::ofstream file(path, std::ios::binary);
+	for(size_t i = 0; i < rows; ++i){
+		file << "drive,0.1,id=n" << i;
+		if(i > 0)
+			file << ",after=n" << (i - 1);
+		file << "\n";
+	}
+}
+
+}
+
+// autohelper_bench [--benchmark_filter=<regex>] [--benchmark_format=console|json] [--benchmark_out=<file>]
+int main(int argc, char *argv[]){
+	if(!parseOptions(argc, argv))
+		return 1;
+
+	bench::loadBenchmarks();
+	bench::commandBenchmarks();
+	bench::runBenchmarks();
+	bench::executorBenchmarks();
+	bench::backgroundBenchmarks();
+	bench::coroutineBenchmarks();
+	bench::batchBenchmarks();
+
+	if(options.json)
+		writeJson(std::cout);
+	if(!options.outPath.empty()){
+		std::ofstream out(options.outPath);
+		writeJson(out);
+		if(!out.good()){
+			std::cerr << "Could not write " << options.outPath << std::endl;
+			return 1;
+		}
+	}
+	return 0;
+}
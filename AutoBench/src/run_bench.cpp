@@ -0,0 +1,109 @@
+#include <bench.hpp>
+#include <quiet_commands.hpp>
+
+#include <fstream>
+#include <thread>
+#include <cstdio>
+
+using namespace team2655;
+using namespace quiet;
+
+namespace bench{
+
+void runBenchmarks(){
+	// Run Test.csv to completion over and over. Commands are reused so this should not allocate.
+	AutoManager manager;
+	registerCommands(manager);
+	manager.loadScript(sourcePath("Test.csv"));
+	run("run/Test.csv", [&](){
+		manager.restartScript();
+		while(manager.process()){  }
+	});
+
+	// Same run with a profiler attached to show the cost of measuring
+	AutoProfiler profiler;
+	profiler.setAllocationCounter(allocationCount);
+	manager.setProfiler(&profiler);
+	run("run/Test.csv (profiled)", [&](){
+		manager.restartScript();
+		while(manager.process()){  }
+	});
+	manager.setProfiler(nullptr);
+
+	// Same run with a telemetry log. Recording is a ring buffer write; the writer thread saves to disk.
+	TelemetryLog telemetry;
+	std::string telemetryPath = "autohelper_bench_telemetry.bin";
+	telemetry.open(telemetryPath);
+	manager.setTelemetry(&telemetry);
+	run("run/Test.csv (telemetry)", [&](){
+		manager.restartScript();
+		while(manager.process()){  }
+	});
+	manager.setTelemetry(nullptr);
+	telemetry.close();
+	std::remove(telemetryPath.c_str());
+
+	// Same run saving a snapshot every tick to a mapped file
+	SnapshotBuffer snapshots;
+	std::string snapshotPath = "autohelper_bench_snapshot.bin";
+	snapshots.open(snapshotPath);
+	manager.setSnapshotBuffer(&snapshots);
+	run("run/Test.csv (snapshot)", [&](){
+		manager.restartScript();
+		while(manager.process()){  }
+	});
+	manager.setSnapshotBuffer(nullptr);
+	snapshots.close();
+	std::remove(snapshotPath.c_str());
+
+	// Same script with the commands fixed at compile time (no std::function creators, no virtual calls from the manager)
+	StaticQuietManager staticManager;
+	staticManager.loadScript(sourcePath("Test.csv"));
+	run("run/Test.csv (static)", [&](){
+		staticManager.restartScript();
+		while(staticManager.process()){  }
+	});
+
+	// Dependency graph with 10k rows. Each row runs after the previous one so only one row is ready per tick.
+	// Time per run should grow with the number of rows, not rows * ticks.
+	if(shouldRun("run/graph_chain/10000")){
+		std::string graphPath = "autohelper_bench_graph.csv";
+		writeChainScript(graphPath, 10000);
+		AutoManager graphManager;
+		registerCommands(graphManager);
+		graphManager.loadScript(graphPath);
+		run("run/graph_chain/10000", [&](){
+			graphManager.restartScript();
+			while(graphManager.process()){  }
+		});
+		std::remove(graphPath.c_str());
+	}
+
+	// Four threads inject 250 commands each while the manager runs them (build with -DAUTOHELPER_SANITIZER=thread to check for races)
+	AutoManager injected;
+	registerCommands(injected);
+	injected.enableCommandInjection(256);
+	run("run/inject/4x250", [&](){
+		std::vector<std::thread> producers;
+		for(int p = 0; p < 4; ++p){
+			producers.emplace_back([&](){
+				for(int i = 0; i < 250;){
+					if(injected.injectCommand("drive", {"0"}))
+						i++;
+					else
+						std::this_thread::yield();
+				}
+			});
+		}
+		bool running;
+		do{
+			running = injected.process();
+		}while(running || injected.loadedCommandCount() < 1000);
+		for(std::thread &producer : producers){
+			producer.join();
+		}
+		injected.clearCommands();
+	});
+}
+
+}
@@ -0,0 +1,65 @@
+/**
+ * AutoCompile
+ * Compiles CSV autonomous scripts to the binary format loaded by AutoManager::loadScript.
+ * Usage: AutoCompile input.csv [output.bin]   (output defaults to the input with a .bin extension)
+ *        AutoCompile --dump compiled.bin      (print a compiled script as CSV)
+ *
+ * Copyright (c) 2018 FRC Team 2655 - The Flying Platypi
+ * See LICENSE file for details
+ */
+
+#include <autoscript.hpp>
+
+#include <iostream>
+#include <string>
+
+using namespace team2655;
+
+static int dump(const std::string &fileName){
+	AutoScript script;
+	if(!script.loadBinary(fileName))
+		return 1;
+	for(size_t i = 0; i < script.size(); ++i){
+		const ScriptRow &row = script.row(i);
+		std::cout << script.name(row.nameId);
+		for(const std::string_view &arg : row.arguments()){
+			std::cout << "," << arg;
+		}
+		std::cout << "\n";
+	}
+	return 0;
+}
+
+int main(int argc, char *argv[]){
+	if(argc < 2 || argc > 3){
+		std::cerr << "Usage: " << argv[0] << " input.csv [output.bin]" << std::endl;
+		std::cerr << "       " << argv[0] << " --dump compiled.bin" << std::endl;
+		return 2;
+	}
+
+	std::string input = argv[1];
+	if(input == "--dump")
+		return (argc == 3) ? dump(argv[2]) : 2;
+
+	std::string output;
+	if(argc == 3){
+		output = argv[2];
+	}else{
+		size_t dot = input.find_last_of('.');
+		size_t slash = input.find_last_of("/\\");
+		if(dot != std::string::npos && (slash == std::string::npos || dot > slash))
+			output = input.substr(0, dot);
+		else
+			output = input;
+		output += ".bin";
+	}
+
+	AutoScript script;
+	if(!script.loadCsv(input))
+		return 1;
+	if(!script.saveBinary(output))
+		return 1;
+
+	std::cout << input << " -> " << output << " (" << script.size() << " rows, " << script.nameCount() << " names)" << std::endl;
+	return 0;
+}
@@ -0,0 +1,95 @@
+/**
+ * test.hpp
+ * Minimal test harness for the autonomous helper. Each suite is a function run by name (one CTest test per suite).
+ *
+ * Copyright (c) 2018 FRC Team 2655 - The Flying Platypi
+ * See LICENSE file for details
+ */
+
+#pragma once
+
+#include <autoclock.hpp>
+
+#include <string>
+#include <sstream>
+#include <chrono>
+#include <cstdint>
+
+namespace test{
+
+/**
+ * Record a failed check (the suite keeps running and fails at the end)
+ */
+void fail(const char *file, int line, const std::string &message);
+
+/**
+ * Number of failed checks so far
+ */
+size_t failureCount();
+
+/**
+ * Number of calls to operator new made by the test process so far
+ */
+uint64_t allocationCount();
+
+/**
+ * Path of a file in the source tree (ex "Test.csv")
+ */
+std::string sourcePath(const std::string &relative);
+
+/**
+ * Path for a file a test writes (in the build directory, named after the test)
+ */
+std::string tempPath(const std::string &name);
+
+/**
+ * Write a script file
+ * @param name File name (see tempPath)
+ * @param text The rows of the script
+ * @return The full path to the script
+ */
+std::string writeScript(const std::string &name, const std::string &text);
+
+/**
+ * One tick of the default 20ms period
+ */
+constexpr team2655::AutoTime Tick = std::chrono::milliseconds(20);
+
+#define CHECK(condition) \
+	do{ \
+		if(!(condition)) \
+			::test::fail(__FILE__, __LINE__, "CHECK(" #condition ") failed"); \
+	}while(false)
+
+#define CHECK_EQUAL(actual, expected) \
+	do{ \
+		auto checkActual = (actual); \
+		auto checkExpected = (expected); \
+		if(!(checkActual == checkExpected)){ \
+			std::ostringstream checkMessage; \
+			checkMessage << "CHECK_EQUAL(" #actual ", " #expected ") failed: " << checkActual << " != " << checkExpected; \
+			::test::fail(__FILE__, __LINE__, checkMessage.str()); \
+		} \
+	}while(false)
+
+// Test suites
+void poolTests();
+void threadTests();
+void runnerTests();
+void scriptTests();
+void preloadTests();
+void groupTests();
+void graphTests();
+void sleepTests();
+void injectionTests();
+void analysisTests();
+void snapshotTests();
+void profilerTests();
+void coroutineTests();
+void simulatorTests();
+void telemetryTests();
+void staticTests();
+void backgroundTests();
+void batchTests();
+
+}
@@ -0,0 +1,112 @@
+/**
+ * test_commands.hpp
+ * Commands and helpers shared by the test suites (the example commands are in quiet_commands.hpp)
+ *
+ * Copyright (c) 2018 FRC Team 2655 - The Flying Platypi
+ * See LICENSE file for details
+ */
+
+#pragma once
+
+#include <test.hpp>
+#include <quiet_commands.hpp>
+
+#include <string>
+#include <functional>
+
+namespace test{
+
+using quiet::TickCommand;
+using quiet::IntakeCommand;
+using quiet::LifterCommand;
+using quiet::registerCommands;
+
+// drive,<seconds>: runs until its timeout, which is bounded by its argument
+class DriveCommand : public team2655::TypedAutoCommand<double>{
+public:
+	static team2655::AutoTime timeoutFor(const std::tuple<double> &args){
+		return std::chrono::duration_cast<team2655::AutoTime>(std::chrono::duration<double>(std::get<0>(args)));
+	}
+	void start(std::string_view commandName, const std::tuple<double> &args) override {  }
+	void process() override {  }
+	void handleComplete() override {  }
+};
+
+inline std::string events; // "<label> start@<tick> " and "<label> end@<tick> " in the order they happened (see run)
+inline int currentTick = 0;
+
+// run,<label>,<ticks>: completes itself after being processed <ticks> times
+class RecordingCommand : public team2655::TypedAutoCommand<std::string_view, int>{
+private:
+	std::string label;
+	int ticksLeft = 0;
+public:
+	void start(std::string_view commandName, const std::tuple<std::string_view, int> &args) override {
+		label = std::string(std::get<0>(args));
+		ticksLeft = std::get<1>(args);
+		events += label + " start@" + std::to_string(currentTick) + " ";
+	}
+	void process() override {
+		if(--ticksLeft <= 0)
+			complete();
+	}
+	void handleComplete() override {
+		events += label + " end@" + std::to_string(currentTick) + " ";
+	}
+};
+
+// flag,<n>: records "flag<n>@<tick> " when the script gives it arguments
+class FlagCommand : public team2655::TypedBackgroundAutoCommand<int>{
+public:
+	void updateArgs(std::string_view commandName, const std::tuple<int> &args) override {
+		events += "flag" + std::to_string(std::get<0>(args)) + "@" + std::to_string(currentTick) + " ";
+		sleep();
+	}
+	void process() override {  }
+	void kill() override {  }
+	bool shouldProcess() override { return false; }
+};
+
+/**
+ * Run a script of run and flag rows and get what happened
+ * @param name The name of the script file
+ * @param text The script
+ * @param beforeTick Called before each tick (with currentTick set) to change the script while it runs
+ * @return The events followed by "done@<tick>" (empty if the script failed to load)
+ */
+inline std::string run(const std::string &name, const std::string &text, std::function<void(team2655::AutoManager&)> beforeTick = nullptr){
+	team2655::AutoManager manager;
+	team2655::FakeAutoClock clock;
+	manager.setClock(&clock);
+	manager.registerCommand<RecordingCommand>("run");
+	manager.registerBackgroundCommand<FlagCommand>("flag");
+	events.clear();
+	currentTick = 0;
+	if(!manager.loadScript(writeScript(name, text)))
+		return "";
+	while(currentTick < 1000){
+		if(beforeTick)
+			beforeTick(manager);
+		if(!manager.process())
+			break;
+		clock.advance(Tick);
+		currentTick++;
+	}
+	events += "done@" + std::to_string(currentTick);
+	return events;
+}
+
+/**
+ * Run a script to the end (or maxTicks)
+ * @return The number of ticks process() returned true for
+ */
+inline size_t runToEnd(team2655::AutoManager &manager, team2655::FakeAutoClock &clock, size_t maxTicks = 10000){
+	size_t ticks = 0;
+	while(ticks < maxTicks && manager.process()){
+		clock.advance(std::chrono::milliseconds(20));
+		ticks++;
+	}
+	return ticks;
+}
+
+}
@@ -0,0 +1,110 @@
+#include <test.hpp>
+#include <test_commands.hpp>
+
+#include <string>
+
+using namespace team2655;
+
+namespace{
+
+// wait: runs until something completes it (no bound)
+class WaitCommand : public AutoCommand{
+public:
+	void start(std::string_view commandName, const ArgList &args) override {  }
+	void process() override {  }
+	void handleComplete() override {  }
+};
+
+void registerCommands(AutoManager &manager){
+	manager.registerCommand<test::DriveCommand>("drive");
+	manager.registerCommand<WaitCommand>("wait");
+	manager.registerBackgroundCommand<test::IntakeCommand>({"intake_in", "intake_out", "intake_stop"});
+}
+
+/**
+ * Load a script and check that its worst case is what a run of it takes (every command runs to its timeout)
+ * @param name The name of the script file
+ * @param text The script
+ */
+void checkWorstCase(const std::string &name, const std::string &text){
+	AutoManager manager;
+	FakeAutoClock clock;
+	manager.setClock(&clock);
+	registerCommands(manager);
+	manager.setDurationLimit(std::chrono::seconds(15));
+	CHECK(manager.loadScript(test::writeScript(name, text)));
+
+	ScriptAnalysis analysis = manager.analyzeScript();
+	CHECK(analysis.valid);
+	CHECK(analysis.bounded);
+	CHECK_EQUAL(analysis.worstCaseTicks, (uint64_t)test::runToEnd(manager, clock));
+	CHECK(analysis.worstCase == analysis.worstCaseTicks * test::Tick);
+}
+
+/**
+ * Load a script
+ * @param limit The duration limit (0 for none)
+ * @return Did it load
+ */
+bool load(const std::string &name, const std::string &text, AutoTime limit){
+	AutoManager manager;
+	registerCommands(manager);
+	manager.setDurationLimit(limit);
+	return manager.loadScript(test::writeScript(name, text));
+}
+
+// The worst case is exact when every command runs to its timeout
+void linearWorstCase(){
+	checkWorstCase("analysis_linear.csv", "drive,0.5\nintake_in\ndrive,0.1\nintake_stop\ndrive,0.03\n");
+}
+
+void groupWorstCase(){
+	checkWorstCase("analysis_groups.csv", "PARALLEL_BEGIN\ndrive,0.3\ndrive,0.5\nPARALLEL_END\n"
+			"RACE_BEGIN\ndrive,0.2\ndrive,0.6\nRACE_END\n"
+			"DEADLINE_BEGIN\ndrive,0.1\nintake_in\ndrive,0.7\nDEADLINE_END\ndrive,0.04\n");
+}
+
+void graphWorstCase(){
+	checkWorstCase("analysis_graph.csv", "drive,0.3,id=a\ndrive,0.5,id=b\ndrive,0.2,after=a\nintake_in,id=c,after=a\ndrive,0.1,after=b,after=c\n");
+	checkWorstCase("analysis_graph_background.csv", "drive,0.1,id=a\nintake_in,after=a\n"); // Ends with a background row
+}
+
+// A script that waits on a command without a bound is only rejected with a duration limit
+void unboundedRows(){
+	std::string text = "drive,1\nwait\n";
+	CHECK(!load("analysis_unbounded.csv", text, std::chrono::seconds(15)));
+	CHECK(load("analysis_unbounded.csv", text, AutoTime(0)));
+
+	AutoManager manager;
+	registerCommands(manager);
+	CHECK(manager.loadScript(test::writeScript("analysis_unbounded.csv", text)));
+	ScriptAnalysis analysis = manager.analyzeScript();
+	CHECK(analysis.valid);
+	CHECK(!analysis.bounded);
+	CHECK_EQUAL(analysis.unboundedRow, (size_t)1);
+}
+
+// Scripts are rejected when their worst case is over the limit
+void durationLimit(){
+	std::string text = "drive,10\ndrive,6\n";
+	CHECK(!load("analysis_long.csv", text, std::chrono::seconds(15)));
+	CHECK(load("analysis_long.csv", text, std::chrono::seconds(17)));
+}
+
+// Rows with no registered command or arguments of the wrong type fail the load
+void invalidRows(){
+	CHECK(!load("analysis_unknown.csv", "drive,1\nfly,2\n", AutoTime(0)));
+	CHECK(!load("analysis_bad_args.csv", "drive,fast\n", AutoTime(0)));
+	CHECK(!load("analysis_missing_args.csv", "drive\n", AutoTime(0)));
+}
+
+}
+
+void test::analysisTests(){
+	linearWorstCase();
+	groupWorstCase();
+	graphWorstCase();
+	unboundedRows();
+	durationLimit();
+	invalidRows();
+}
@@ -0,0 +1,124 @@
+#include <test.hpp>
+#include <test_commands.hpp>
+
+#include <autoprofiler.hpp>
+
+#include <string>
+#include <vector>
+
+using namespace team2655;
+
+namespace{
+
+std::string events; // "u:<name>" for each update and "<name>" for each process, in the order they happened
+
+// A background command of one of several types that records its updates and processing.
+// set_<name>,<n>: processed on the next n ticks then sleeps until it gets new arguments. Runs after the commands in after.
+template<int Type>
+class TraceCommand : public TypedBackgroundAutoCommand<int>{
+public:
+	std::string name;
+	std::vector<std::string> after;
+	int ticksLeft = 0;
+	void updateArgs(std::string_view commandName, const std::tuple<int> &args) override {
+		events += "u:" + name + " ";
+		ticksLeft = std::get<0>(args);
+	}
+	void process() override {
+		events += name + " ";
+		if(--ticksLeft <= 0)
+			sleep();
+	}
+	void kill() override {
+		ticksLeft = 0;
+		sleep();
+	}
+	bool shouldProcess() override {
+		return ticksLeft > 0;
+	}
+	std::vector<std::string> runAfter() override {
+		return after;
+	}
+};
+
+/**
+ * Register an instance of a trace command
+ */
+template<int Type>
+void add(AutoManager &manager, const std::string &name, const std::vector<std::string> &after = {}){
+	TraceCommand<Type> *command = manager.registerBackgroundInstance<TraceCommand<Type>>("set_" + name);
+	CHECK(command != nullptr);
+	if(command != nullptr){
+		command->name = name;
+		command->after = after;
+	}
+}
+
+/**
+ * Run a script of set_ rows with instances of three types registered interleaved
+ * @param profiled Attach a profiler (the manager then processes commands one at a time instead of in batches)
+ * @param a0After What a0 runs after
+ * @return The events of each tick
+ */
+std::vector<std::string> run(const std::string &name, const std::string &text, bool profiled, const std::vector<std::string> &a0After = {}){
+	AutoProfiler profiler;
+	AutoManager manager;
+	FakeAutoClock clock;
+	manager.setClock(&clock);
+	if(profiled)
+		manager.setProfiler(&profiler);
+	manager.registerCommand<test::TickCommand>("drive");
+	add<0>(manager, "a0", a0After);
+	add<0>(manager, "a1");
+	add<1>(manager, "b0");
+	add<0>(manager, "a2");
+	add<2>(manager, "c0");
+	add<1>(manager, "b1");
+	add<1>(manager, "b2");
+	add<0>(manager, "a3");
+
+	std::vector<std::string> ticks;
+	CHECK(manager.loadScript(test::writeScript(name, text)));
+	for(int i = 0; i < 1000; ++i){
+		events.clear();
+		bool more = manager.process();
+		clock.advance(test::Tick);
+		ticks.push_back(events);
+		if(!more)
+			break;
+	}
+	return ticks;
+}
+
+// Commands are updated in script order and processed in registration order whatever their type,
+// the same as when each command is processed on its own
+void registrationOrder(){
+	std::string text = "set_b2,2\nset_a3,1\nset_c0,3\nset_a0,2\nset_b0,1\nset_a2,3\nset_a1,1\nset_b1,2\ndrive,0.4\nset_a3,1\nset_b1,1\ndrive,0.2\n";
+	std::vector<std::string> batched = run("background_order.csv", text, false);
+	std::vector<std::string> single = run("background_order.csv", text, true);
+	CHECK(batched == single);
+	CHECK(batched.size() >= 7);
+	if(batched.size() < 7)
+		return;
+	CHECK_EQUAL(batched[0], std::string("u:b2 u:a3 u:c0 u:a0 u:b0 u:a2 u:a1 u:b1 a0 a1 b0 a2 c0 b1 b2 a3 "));
+	CHECK_EQUAL(batched[1], std::string("a0 a2 c0 b1 b2 "));
+	CHECK_EQUAL(batched[2], std::string("a2 c0 "));
+	CHECK_EQUAL(batched[3], std::string());
+	CHECK_EQUAL(batched[4], std::string("u:a3 u:b1 b1 a3 ")); // The drive ends on tick 3 and the next rows run on tick 4
+}
+
+// A command that runs after another is still processed after it, and the rest keep their order
+void dependencyMoves(){
+	std::string text = "set_a0,1\nset_a1,1\nset_b0,1\nset_b2,1\ndrive,0.1\n";
+	std::vector<std::string> batched = run("background_after.csv", text, false, { "set_b2" });
+	std::vector<std::string> single = run("background_after.csv", text, true, { "set_b2" });
+	CHECK(batched == single);
+	CHECK(!batched.empty() && batched[0] == "u:a0 u:a1 u:b0 u:b2 a1 b0 b2 a0 ");
+}
+
+}
+
+void test::backgroundTests(){
+	registrationOrder();
+	dependencyMoves();
+}
@@ -0,0 +1,111 @@
+#include <test.hpp>
+#include <test_commands.hpp>
+#include <quiet_batch_commands.hpp>
+
+#include <autosimulator.hpp>
+
+#include <string>
+#include <vector>
+#include <algorithm>
+
+using namespace team2655;
+
+namespace{
+
+// Arguments of each instance: the first MOVE_LIFTER target, the first DRIVE time and the ROTATE time of Test.csv
+double lifterTarget(size_t instance){ return (double)(instance % 7) * 3 - 6; }
+double driveSeconds(size_t instance){ return (instance % 13) * 0.15; }
+double rotateSeconds(size_t instance){ return 0.05 + (instance % 5) * 0.3; }
+
+/**
+ * Run Test.csv with an instance's arguments in an AutoManager driven by an AutoSimulator
+ * @return What the simulator returned
+ */
+SimulationResult simulate(size_t instance){
+	AutoManager manager;
+	test::registerCommands(manager);
+	manager.addCommand("move_lifter", { std::to_string((int)lifterTarget(instance)) });
+	manager.addCommand("drive", { std::to_string(driveSeconds(instance)) });
+	manager.addCommand("intake_in", {});
+	manager.addCommand("rotate", { std::to_string(rotateSeconds(instance)) });
+	manager.addCommand("intake_stop", {});
+	manager.addCommand("move_lifter", { "5" });
+	manager.addCommand("drive", { "3" });
+	AutoSimulator simulator;
+	return simulator.run(manager);
+}
+
+/**
+ * Load Test.csv into a batch and give each instance its arguments
+ */
+void setUp(AutoBatch &batch, size_t instances){
+	quiet::registerBatchCommands(batch);
+	CHECK(batch.loadScript(test::sourcePath("Test.csv")));
+	CHECK_EQUAL(batch.rowCount(), (size_t)7);
+	batch.setInstances(instances);
+	double *lifter = batch.argument(0, 0);
+	double *drive = batch.argument(1, 0);
+	double *rotate = batch.argument(3, 0);
+	CHECK(lifter != nullptr && drive != nullptr && rotate != nullptr);
+	CHECK(batch.argument(2, 0) == nullptr); // INTAKE_IN has no arguments
+	if(lifter == nullptr || drive == nullptr || rotate == nullptr)
+		return;
+	for(size_t i = 0; i < instances; ++i){
+		lifter[i] = lifterTarget(i);
+		drive[i] = driveSeconds(i);
+		rotate[i] = rotateSeconds(i);
+	}
+}
+
+// Each instance finishes on the tick an AutoManager with its arguments does (the last process() call of a
+// simulated run is the tick it has no commands left)
+void sameTicksAsManager(){
+	const size_t instances = 200;
+	AutoBatch batch;
+	setUp(batch, instances);
+	size_t ticks = batch.run(100000);
+	uint32_t longest = 0;
+	for(size_t i = 0; i < instances; ++i){
+		SimulationResult result = simulate(i);
+		CHECK(result.finished);
+		CHECK(batch.isFinished(i));
+		CHECK_EQUAL((uint64_t)batch.finishTick(i) + 1, result.ticks);
+		longest = std::max(longest, batch.finishTick(i));
+	}
+	CHECK_EQUAL(ticks, (size_t)longest + 1);
+
+	// The same again (run starts every instance from the first row)
+	CHECK_EQUAL(batch.run(100000), ticks);
+	for(size_t i = 0; i < instances; ++i){
+		CHECK_EQUAL((uint64_t)batch.finishTick(i) + 1, simulate(i).ticks);
+	}
+}
+
+// Instances that have not finished when the tick limit is reached are not finished. The others finish on the same tick.
+void stopsAtLimit(){
+	const size_t instances = 50;
+	AutoBatch batch;
+	setUp(batch, instances);
+	batch.run(100000);
+	std::vector<uint32_t> finishTicks;
+	for(size_t i = 0; i < instances; ++i){
+		finishTicks.push_back(batch.finishTick(i));
+	}
+	const size_t limit = 45;
+	CHECK_EQUAL(batch.run(limit), limit);
+	size_t finished = 0;
+	for(size_t i = 0; i < instances; ++i){
+		CHECK_EQUAL(batch.isFinished(i), finishTicks[i] < limit);
+		if(batch.isFinished(i))
+			CHECK_EQUAL(batch.finishTick(i), finishTicks[i]);
+		finished += batch.isFinished(i);
+	}
+	CHECK(finished > 0 && finished < instances); // The limit stops some instances
+}
+
+}
+
+void test::batchTests(){
+	sameTicksAsManager();
+	stopsAtLimit();
+}
@@ -0,0 +1,169 @@
+#include <test.hpp>
+#include <test_commands.hpp>
+
+#include <autocoroutine.hpp>
+
+#include <string>
+#include <iostream>
+
+using namespace team2655;
+
+#ifdef AUTOHELPER_HAS_COROUTINES
+
+namespace{
+
+std::string events; // "<what>@<tick> " in the order they happened
+int currentTick = 0;
+bool ready = false; // What the story command waits for with until
+int frames = 0;     // Frames of the held command alive
+
+void log(const char *what){
+	events += std::string(what) + "@" + std::to_string(currentTick) + " ";
+}
+
+// story,<ms>: goes through each kind of wait and logs as it resumes
+class StoryCommand : public CoroutineAutoCommand<int>{
+private:
+	AutoTask part(int ticks){
+		log("part");
+		for(int i = 0; i < ticks; ++i){
+			co_await nextTick();
+		}
+		log("part_end");
+	}
+public:
+	AutoTask run(int ms) override {
+		log("begin");
+		co_await nextTick();
+		log("next");
+		co_await sleepFor(std::chrono::milliseconds(ms));
+		log("slept");
+		co_await until([](){ return ready; });
+		log("ready");
+		co_await part(2);
+		log("end");
+	}
+};
+
+// Counts the frames alive (a local of the coroutine is destroyed with its frame)
+struct FrameCounter{
+	FrameCounter(){ frames++; }
+	~FrameCounter(){ frames--; }
+};
+
+// hold,<seconds>: waits until woken, bounded by its argument
+class HoldCommand : public CoroutineAutoCommand<double>{
+public:
+	static AutoTime timeoutFor(const std::tuple<double> &args){
+		return std::chrono::duration_cast<AutoTime>(std::chrono::duration<double>(std::get<0>(args)));
+	}
+	AutoTask run(double seconds) override {
+		FrameCounter counter;
+		co_await sleep();
+		log("woken");
+	}
+};
+
+// count,<ticks>: waits a number of ticks (nothing logged so runs do not allocate)
+class CountCommand : public CoroutineAutoCommand<int>{
+public:
+	AutoTask run(int ticks) override {
+		for(int i = 0; i < ticks; ++i){
+			co_await nextTick();
+		}
+	}
+};
+
+struct Run{
+	AutoManager manager;
+	FakeAutoClock clock;
+
+	Run(){
+		manager.setClock(&clock);
+		manager.registerCommand<StoryCommand>("story");
+		manager.registerCommand<HoldCommand>("hold");
+		manager.registerCommand<CountCommand>("count");
+		manager.registerCommand<test::TickCommand>("drive");
+		events.clear();
+		currentTick = 0;
+		ready = false;
+		frames = 0;
+	}
+
+	/**
+	 * Process one tick
+	 * @return What process returned
+	 */
+	bool tick(){
+		bool result = manager.process();
+		clock.advance(test::Tick);
+		currentTick++;
+		return result;
+	}
+};
+
+// A coroutine resumes after each wait on the tick its wait ends and a sub-task runs within its caller
+void resumeOrder(){
+	Run run;
+	CHECK(run.manager.loadScript(test::writeScript("coroutine_story.csv", "story,100\ndrive,0.1\n")));
+	while(currentTick < 1000 && run.tick()){
+		if(currentTick == 10)
+			ready = true;
+	}
+	CHECK_EQUAL(events, std::string("begin@0 next@1 slept@6 ready@10 part@10 part_end@12 end@12 "));
+}
+
+// A timeout or killAuto completes the command without resuming it and destroys its frame
+void timeoutDestroysFrame(){
+	Run run;
+	CHECK(run.manager.loadScript(test::writeScript("coroutine_timeout.csv", "hold,0.1\ndrive,0.1\n")));
+	run.tick();
+	CHECK_EQUAL(frames, 1);
+	while(currentTick < 1000 && run.tick()){  }
+	CHECK_EQUAL(frames, 0);
+	CHECK_EQUAL(events, std::string());
+
+	CHECK(run.manager.loadScript(test::writeScript("coroutine_kill.csv", "hold,10\n")));
+	run.tick();
+	CHECK_EQUAL(frames, 1);
+	run.manager.killAuto();
+	CHECK_EQUAL(frames, 0);
+	CHECK(!run.tick());
+	CHECK_EQUAL(events, std::string());
+}
+
+// Running a script again takes every frame from the manager's pool
+void warmRestartDoesNotAllocate(){
+	Run run;
+	CHECK(run.manager.loadScript(test::writeScript("coroutine_warm.csv", "count,3\ncount,5\ncount,2\n")));
+	int cold = 0;
+	while(cold < 1000 && run.tick()){
+		cold++;
+	}
+	run.manager.restartScript();
+
+	uint64_t before = test::allocationCount();
+	int warm = 0;
+	while(warm < 1000 && run.manager.process()){
+		run.clock.advance(test::Tick);
+		warm++;
+	}
+	CHECK_EQUAL(test::allocationCount() - before, (uint64_t)0);
+	CHECK_EQUAL(warm, cold);
+}
+
+}
+
+void test::coroutineTests(){
+	resumeOrder();
+	timeoutDestroysFrame();
+	warmRestartDoesNotAllocate();
+}
+
+#else
+
+void test::coroutineTests(){
+	std::cout << "coroutines: not compiled as C++20, skipped" << std::endl;
+}
+
+#endif
@@ -0,0 +1,69 @@
+#include <test.hpp>
+#include <test_commands.hpp>
+
+#include <string>
+
+using namespace team2655;
+using test::run;
+using test::currentTick;
+
+namespace{
+
+// Rows start the tick after the last row they run after= finishes. Rows without after= start on the first tick.
+void rowsWaitForDependencies(){
+	CHECK_EQUAL(run("graph_diamond.csv", "run,a,2,id=a\nrun,b,4,id=b\nrun,c,1,after=a,after=b\nrun,d,1,after=a\n"),
+			std::string("a start@0 b start@0 a end@1 d start@2 d end@2 b end@3 c start@4 c end@4 done@4"));
+}
+
+// A row inserted in front of a running graph runs once and every other row still runs once, in order
+void insertBeforeRunningRows(){
+	CHECK_EQUAL(run("graph_insert_front.csv", "run,a,3,id=a\nrun,b,1,after=a\n", [](AutoManager &manager){
+		if(currentTick == 1)
+			manager.addCommand("run", {"x", "1"}, 0);
+	}), std::string("a start@0 x start@1 x end@1 a end@2 b start@3 b end@3 done@3"));
+}
+
+// An appended row waits for the running row it runs after=
+void appendAfterRunningRow(){
+	CHECK_EQUAL(run("graph_append_running.csv", "run,a,3,id=a\nrun,b,1,id=b,after=a\n", [](AutoManager &manager){
+		if(currentTick == 1)
+			manager.addCommands({"run", "run"}, {{"y", "1", "after=a"}, {"z", "1", "id=z", "after=b"}});
+	}), std::string("a start@0 a end@2 b start@3 b end@3 y start@3 y end@3 z start@4 z end@4 done@4"));
+}
+
+// An appended row that runs after a finished row starts on the next tick and the finished row is not run again
+void appendAfterFinishedRow(){
+	CHECK_EQUAL(run("graph_append_finished.csv", "run,a,1,id=a\nrun,b,3\n", [](AutoManager &manager){
+		if(currentTick == 2)
+			manager.addCommand("run", {"y", "1", "after=a"});
+	}), std::string("a start@0 a end@0 b start@0 b end@2 y start@2 y end@2 done@2"));
+}
+
+// Nothing starts after the graph was killed
+void noRowsAfterKill(){
+	CHECK_EQUAL(run("graph_killed.csv", "run,a,3,id=a\nrun,b,1,after=a\n", [](AutoManager &manager){
+		if(currentTick == 1){
+			manager.killAuto();
+			manager.addCommand("run", {"y", "1"});
+		}
+	}), std::string("a start@0 a end@1 done@1"));
+}
+
+// Graphs that cannot run fail the load
+void badGraphsFailToLoad(){
+	CHECK_EQUAL(run("graph_cycle.csv", "run,a,1,id=a,after=b\nrun,b,1,id=b,after=a\n"), std::string());
+	CHECK_EQUAL(run("graph_unknown.csv", "run,a,1,id=a\nrun,b,1,after=c\n"), std::string());
+	CHECK_EQUAL(run("graph_duplicate.csv", "run,a,1,id=a\nrun,b,1,id=a\n"), std::string());
+	CHECK_EQUAL(run("graph_group.csv", "run,a,1,id=a\nPARALLEL_BEGIN\nrun,b,1\nPARALLEL_END\n"), std::string());
+}
+
+}
+
+void test::graphTests(){
+	rowsWaitForDependencies();
+	insertBeforeRunningRows();
+	appendAfterRunningRow();
+	appendAfterFinishedRow();
+	noRowsAfterKill();
+	badGraphsFailToLoad();
+}
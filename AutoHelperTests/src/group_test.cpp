@@ -0,0 +1,53 @@
+#include <test.hpp>
+#include <test_commands.hpp>
+
+#include <string>
+
+using namespace team2655;
+using test::run;
+
+namespace{
+
+// Every command of a PARALLEL group starts on the same tick and the next row waits for all of them
+void parallelWaitsForAll(){
+	CHECK_EQUAL(run("parallel.csv", "PARALLEL_BEGIN\nrun,a,3\nflag,1\nrun,b,5\nPARALLEL_END\nrun,c,1\n"),
+			std::string("flag1@0 a start@0 b start@0 a end@2 b end@4 c start@5 c end@5 done@6"));
+}
+
+// A RACE group ends with its first command to finish. The others are ended on the same tick.
+void raceEndsWithFirst(){
+	CHECK_EQUAL(run("race.csv", "RACE_BEGIN\nrun,a,5\nrun,b,2\nRACE_END\nrun,c,1\n"),
+			std::string("a start@0 b start@0 b end@1 a end@1 c start@2 c end@2 done@3"));
+}
+
+// A DEADLINE group ends with its first command, however long the others run for
+void deadlineEndsWithFirstCommand(){
+	CHECK_EQUAL(run("deadline_short.csv", "DEADLINE_BEGIN\nrun,a,2\nrun,b,5\nDEADLINE_END\nrun,c,1\n"),
+			std::string("a start@0 b start@0 a end@1 b end@1 c start@2 c end@2 done@3"));
+	CHECK_EQUAL(run("deadline_long.csv", "DEADLINE_BEGIN\nrun,a,4\nrun,b,2\nDEADLINE_END\nrun,c,1\n"),
+			std::string("a start@0 b start@0 b end@1 a end@3 c start@4 c end@4 done@5"));
+}
+
+// An empty group finishes right away
+void emptyGroup(){
+	CHECK_EQUAL(run("empty_group.csv", "run,a,1\nPARALLEL_BEGIN\nPARALLEL_END\nrun,b,1\n"),
+			std::string("a start@0 a end@0 b start@2 b end@2 done@3"));
+}
+
+// Groups that cannot run fail the load
+void badGroupsFailToLoad(){
+	CHECK_EQUAL(run("nested.csv", "PARALLEL_BEGIN\nRACE_BEGIN\nrun,a,1\nRACE_END\nPARALLEL_END\n"), std::string());
+	CHECK_EQUAL(run("unmatched_end.csv", "run,a,1\nPARALLEL_END\n"), std::string());
+	CHECK_EQUAL(run("wrong_end.csv", "PARALLEL_BEGIN\nrun,a,1\nRACE_END\n"), std::string());
+	CHECK_EQUAL(run("never_ended.csv", "DEADLINE_BEGIN\nrun,a,1\n"), std::string());
+}
+
+}
+
+void test::groupTests(){
+	parallelWaitsForAll();
+	raceEndsWithFirst();
+	deadlineEndsWithFirstCommand();
+	emptyGroup();
+	badGroupsFailToLoad();
+}
@@ -0,0 +1,136 @@
+#include <test.hpp>
+#include <test_commands.hpp>
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+
+using namespace team2655;
+
+namespace{
+
+const int Producers = 4;
+const int PerProducer = 500;
+
+int nextSeq[Producers];  // Per producer: the sequence number its next command should have
+size_t marks = 0;        // Commands started
+size_t outOfOrder = 0;   // Commands started out of their producer's order (or more than once)
+int currentTick = 0;
+int lastStartTick = -1;  // Tick the last command started on
+
+// mark,<producer>,<seq>: records that it started and completes the first time it is processed
+class MarkCommand : public TypedAutoCommand<int, int>{
+public:
+	void start(std::string_view commandName, const std::tuple<int, int> &args) override {
+		int producer = std::get<0>(args);
+		int seq = std::get<1>(args);
+		if(producer < 0 || producer >= Producers || seq != nextSeq[producer])
+			outOfOrder++;
+		else
+			nextSeq[producer]++;
+		marks++;
+		lastStartTick = currentTick;
+	}
+	void process() override {
+		complete();
+	}
+	void handleComplete() override {  }
+};
+
+void setUp(AutoManager &manager, FakeAutoClock &clock){
+	manager.setClock(&clock);
+	manager.registerCommand<MarkCommand>("mark");
+	manager.registerCommand<test::TickCommand>("drive");
+	manager.enableCommandInjection(64);
+	for(int &seq : nextSeq){
+		seq = 0;
+	}
+	marks = 0;
+	outOfOrder = 0;
+	currentTick = 0;
+	lastStartTick = -1;
+}
+
+/**
+ * Inject commands from several threads while the manager ticks
+ * @param scriptName The name of the script file
+ * @param text The script the commands are appended to
+ */
+void injectWhileTicking(const std::string &scriptName, const std::string &text){
+	AutoManager manager;
+	FakeAutoClock clock;
+	setUp(manager, clock);
+	CHECK(manager.loadScript(test::writeScript(scriptName, text)));
+
+	std::atomic<bool> stopping{false}; // Set if the manager stops taking commands (so a failing test cannot hang)
+	std::atomic<int> injecting{Producers};
+	std::vector<std::thread> producers;
+	for(int p = 0; p < Producers; ++p){
+		producers.emplace_back([&manager, &stopping, &injecting, p](){
+			std::string producer = std::to_string(p);
+			for(int seq = 0; seq < PerProducer; ++seq){
+				std::string number = std::to_string(seq);
+				while(!manager.injectCommand("mark", {producer, number})){
+					if(stopping)
+						return;
+					std::this_thread::yield(); // Queue full until the next tick
+				}
+			}
+			injecting--;
+		});
+	}
+
+	// Tick until every command ran (giving up some ticks after the producers finished)
+	size_t expected = Producers * PerProducer;
+	for(size_t ticksLeft = 2 * expected; marks < expected && ticksLeft > 0;){
+		if(injecting == 0)
+			ticksLeft--;
+		manager.process();
+		clock.advance(test::Tick);
+		std::this_thread::yield();
+	}
+	stopping = true;
+	for(std::thread &producer : producers){
+		producer.join();
+	}
+
+	CHECK_EQUAL(marks, expected);
+	CHECK_EQUAL(outOfOrder, (size_t)0);
+	for(int p = 0; p < Producers; ++p){
+		CHECK_EQUAL(nextSeq[p], PerProducer);
+	}
+}
+
+// Every injected command runs exactly once and in the order its thread injected it
+void linearStress(){
+	injectWhileTicking("inject_linear.csv", "drive,0.5\n");
+}
+
+void graphStress(){
+	injectWhileTicking("inject_graph.csv", "drive,0.5,id=start\n");
+}
+
+// A command injected with after= into a running graph waits for that row
+void injectAfterRunningRow(){
+	AutoManager manager;
+	FakeAutoClock clock;
+	setUp(manager, clock);
+	CHECK(manager.loadScript(test::writeScript("inject_after.csv", "drive,0.3,id=a\n")));
+	for(currentTick = 0; currentTick < 10; ++currentTick){
+		if(currentTick == 1)
+			CHECK(manager.injectCommand("mark", {"0", "0", "after=a"}));
+		manager.process();
+		clock.advance(test::Tick);
+	}
+	CHECK_EQUAL(marks, (size_t)1);
+	CHECK_EQUAL(lastStartTick, 3);
+}
+
+}
+
+void test::injectionTests(){
+	linearStress();
+	graphStress();
+	injectAfterRunningRow();
+}
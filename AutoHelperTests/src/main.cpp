@@ -0,0 +1,117 @@
+#include <test.hpp>
+
+#include <iostream>
+#include <fstream>
+#include <atomic>
+#include <new>
+#include <cstdlib>
+#include <cstring>
+
+// Count every allocation made by the process so tests can check that hot paths do not allocate
+static std::atomic<uint64_t> allocations{0};
+
+void *operator new(size_t size){
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	void *result = std::malloc(size == 0 ? 1 : size);
+	if(result == nullptr)
+		throw std::bad_alloc();
+	return result;
+}
+
+void operator delete(void *ptr) noexcept{
+	std::free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept{
+	std::free(ptr);
+}
+
+namespace{
+
+std::atomic<size_t> failures{0};
+
+struct Suite{
+	const char *name;
+	void (*run)();
+};
+
+const Suite suites[] = {
+	{ "pools", test::poolTests },
+	{ "threads", test::threadTests },
+	{ "runner", test::runnerTests },
+	{ "scripts", test::scriptTests },
+	{ "preload", test::preloadTests },
+	{ "groups", test::groupTests },
+	{ "graph", test::graphTests },
+	{ "sleep", test::sleepTests },
+	{ "injection", test::injectionTests },
+	{ "analysis", test::analysisTests },
+	{ "snapshot", test::snapshotTests },
+	{ "profiler", test::profilerTests },
+	{ "coroutines", test::coroutineTests },
+	{ "simulator", test::simulatorTests },
+	{ "telemetry", test::telemetryTests },
+	{ "static", test::staticTests },
+	{ "background", test::backgroundTests },
+	{ "batch", test::batchTests },
+};
+
+}
+
+namespace test{
+
+void fail(const char *file, int line, const std::string &message){
+	failures++;
+	std::cerr << file << ":" << line << ": " << message << std::endl;
+}
+
+size_t failureCount(){
+	return failures.load();
+}
+
+uint64_t allocationCount(){
+	return allocations.load(std::memory_order_relaxed);
+}
+
+std::string sourcePath(const std::string &relative){
+	return std::string(AUTOHELPER_SOURCE_DIR) + "/" + relative;
+}
+
+std::string tempPath(const std::string &name){
+	return "autohelper_test_" + name;
+}
+
+std::string writeScript(const std::string &name, const std::string &text){
+	std::string path = tempPath(name);
+	std::ofstream file(path, std::ios::binary);
+	file << text;
+	return path;
+}
+
+}
+
+// AutoHelperTests [suite...]   Run the named suites (every suite if none are named). Exits with 1 if any check fails.
+int main(int argc, char *argv[]){
+	size_t ran = 0;
+	for(const Suite &suite : suites){
+		bool selected = argc < 2;
+		for(int i = 1; i < argc; ++i){
+			selected = selected || std::strcmp(argv[i], suite.name) == 0;
+		}
+		if(!selected)
+			continue;
+		size_t before = test::failureCount();
+		suite.run();
+		std::cout << suite.name << ": " << ((test::failureCount() == before) ? "passed" : "FAILED") << std::endl;
+		ran++;
+	}
+	if(ran == 0){
+		std::cerr << "No test suite matches. Suites:";
+		for(const Suite &suite : suites){
+			std::cerr << " " << suite.name;
+		}
+		std::cerr << std::endl;
+		return 1;
+	}
+	return test::failureCount() == 0 ? 0 : 1;
+}
@@ -0,0 +1,75 @@
+#include <test.hpp>
+#include <test_commands.hpp>
+
+#include <string>
+
+using namespace team2655;
+
+namespace{
+
+std::string started; // Type and name of every command started
+
+class CommandA : public TypedAutoCommand<>{
+public:
+	void start(std::string_view commandName, const std::tuple<> &args) override {
+		started += "A:" + std::string(commandName) + " ";
+	}
+	void process() override {  } // Runs until it is ended
+	void handleComplete() override {  }
+};
+
+class CommandB : public TypedAutoCommand<>{
+public:
+	void start(std::string_view commandName, const std::tuple<> &args) override {
+		started += "B:" + std::string(commandName) + " ";
+		complete();
+	}
+	void process() override {  }
+	void handleComplete() override {  }
+};
+
+// Repeated runs of a script reuse pooled commands and do not allocate once warm
+void warmRunsDoNotAllocate(){
+	AutoManager manager;
+	FakeAutoClock clock;
+	manager.setClock(&clock);
+	test::registerCommands(manager);
+	CHECK(manager.loadScript(test::sourcePath("Test.csv")));
+
+	size_t ticks = test::runToEnd(manager, clock);
+	CHECK(ticks > 0);
+	uint64_t allocations = test::allocationCount();
+	for(int run = 0; run < 10; ++run){
+		manager.restartScript();
+		CHECK_EQUAL(test::runToEnd(manager, clock), ticks);
+	}
+	CHECK_EQUAL(test::allocationCount() - allocations, (uint64_t)0);
+}
+
+// Commands running when everything is unregistered never end up in the pool of a command registered later
+void unregisterAllDropsRunningCommands(){
+	AutoManager manager;
+	FakeAutoClock clock;
+	manager.setClock(&clock);
+	manager.registerCommand<CommandA>("a");
+	manager.registerCommand<CommandB>("b");
+	manager.addCommands({"a", "b"}, {{}, {}});
+	CHECK(manager.process()); // a is running
+
+	manager.unregisterAll();
+	manager.registerCommand<CommandB>("b"); // Creator indices are swapped
+	manager.registerCommand<CommandA>("a");
+	started.clear();
+	manager.addCommand("b", {}, 0);
+	manager.restartScript();
+	manager.process();
+	manager.process();
+	CHECK_EQUAL(started, std::string("B:b A:a "));
+}
+
+}
+
+void test::poolTests(){
+	warmRunsDoNotAllocate();
+	unregisterAllDropsRunningCommands();
+}
@@ -0,0 +1,121 @@
+#include <test.hpp>
+#include <test_commands.hpp>
+
+#include <chrono>
+#include <fstream>
+#include <thread>
+#include <cstdio>
+#include <algorithm>
+#include <vector>
+#include <iostream>
+
+using namespace team2655;
+
+namespace{
+
+typedef std::chrono::steady_clock WallClock;
+
+// Most ticks must take less than one 20ms period while a script loads. Single ticks may go over (the machine
+// may be busy running other tests) but not by more than the ceiling.
+const WallClock::duration TickBudget = std::chrono::milliseconds(20);
+const WallClock::duration TickCeiling = std::chrono::milliseconds(100);
+const size_t MinTimedTicks = 1000;
+
+std::string writeLargeScript(const std::string &name, size_t rows){
+	std::string path = test::tempPath(name);
+	std::ofstream file(path, std::ios::binary);
+	for(size_t i = 0; i < rows; ++i){
+		if(i % 3 == 0)
+			file << "MOVE_LIFTER," << (i % 20) << "\n";
+		else
+			file << "DRIVE," << (i % 7) / 10.0 << "\n";
+	}
+	return path;
+}
+
+/**
+ * Process one tick (restarting the script when it ends so there is always something running)
+ * @return How long process() took
+ */
+WallClock::duration timedTick(AutoManager &manager, FakeAutoClock &clock){
+	WallClock::time_point start = WallClock::now();
+	if(!manager.process())
+		manager.restartScript();
+	WallClock::duration elapsed = WallClock::now() - start;
+	clock.advance(test::Tick);
+	return elapsed;
+}
+
+// A large script loads on the loader thread while the control loop keeps ticking within its budget
+void ticksStayInBudgetWhileLoading(){
+	const size_t rows = 300000;
+	std::string largePath = writeLargeScript("large.csv", rows);
+
+	AutoManager manager;
+	FakeAutoClock clock;
+	manager.setClock(&clock);
+	test::registerCommands(manager);
+	CHECK(manager.loadScript(test::sourcePath("Test.csv")));
+
+	manager.preloadScript(largePath);
+	std::vector<WallClock::duration> tickTimes;
+	tickTimes.reserve(MinTimedTicks * 4);
+	size_t ticksWhileLoading = 0;
+	WallClock::time_point giveUp = WallClock::now() + std::chrono::seconds(60);
+	while(manager.getPreloadStatus(largePath) == ScriptLoader::Status::Loading && WallClock::now() < giveUp){
+		tickTimes.push_back(timedTick(manager, clock));
+		ticksWhileLoading++;
+	}
+	CHECK(manager.getPreloadStatus(largePath) == ScriptLoader::Status::Ready);
+	CHECK(ticksWhileLoading > 0);
+
+	// Switching happens at the start of a tick. The old script is destroyed on the loader thread.
+	CHECK(manager.useScript(largePath));
+	tickTimes.push_back(timedTick(manager, clock));
+	CHECK_EQUAL(manager.loadedCommandCount(), rows);
+	while(tickTimes.size() < MinTimedTicks){
+		tickTimes.push_back(timedTick(manager, clock));
+	}
+
+	std::sort(tickTimes.begin(), tickTimes.end());
+	auto us = [](WallClock::duration time){ return std::to_string(std::chrono::duration_cast<std::chrono::microseconds>(time).count()) + "us"; };
+	WallClock::duration p99 = tickTimes[tickTimes.size() * 99 / 100];
+	WallClock::duration longest = tickTimes.back();
+	std::cout << "preload: " << tickTimes.size() << " ticks, p99 " << us(p99) << ", longest " << us(longest) << std::endl;
+	if(p99 > TickBudget)
+		test::fail(__FILE__, __LINE__, "p99 tick " + us(p99) + " while a script loaded (budget " + us(TickBudget) + ")");
+	if(longest > TickCeiling)
+		test::fail(__FILE__, __LINE__, "a tick took " + us(longest) + " while a script loaded (ceiling " + us(TickCeiling) + ")");
+	std::remove(largePath.c_str());
+}
+
+// A preload that fails leaves the running script alone
+void failedPreloadKeepsScript(){
+	std::string badPath = test::writeScript("bad_preload.csv", "DRIVE,1\nNOT_A_COMMAND\n");
+
+	AutoManager manager;
+	FakeAutoClock clock;
+	manager.setClock(&clock);
+	test::registerCommands(manager);
+	CHECK(manager.loadScript(test::sourcePath("Test.csv")));
+	size_t rows = manager.loadedCommandCount();
+
+	manager.preloadScript(badPath);
+	WallClock::time_point giveUp = WallClock::now() + std::chrono::seconds(10);
+	while(manager.getPreloadStatus(badPath) == ScriptLoader::Status::Loading && WallClock::now() < giveUp){
+		timedTick(manager, clock);
+		std::this_thread::yield();
+	}
+	CHECK(manager.getPreloadStatus(badPath) == ScriptLoader::Status::Failed);
+	CHECK(!manager.useScript(badPath));
+	timedTick(manager, clock);
+	CHECK_EQUAL(manager.loadedCommandCount(), rows);
+	std::remove(badPath.c_str());
+}
+
+}
+
+void test::preloadTests(){
+	ticksStayInBudgetWhileLoading();
+	failedPreloadKeepsScript();
+}
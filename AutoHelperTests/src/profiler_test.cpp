@@ -0,0 +1,157 @@
+#include <test.hpp>
+#include <test_commands.hpp>
+
+#include <autoprofiler.hpp>
+
+#include <string>
+#include <vector>
+#include <sstream>
+#include <algorithm>
+
+using namespace team2655;
+
+namespace{
+
+/**
+ * Count the times text appears in a string
+ */
+size_t countOf(const std::string &in, const std::string &text){
+	size_t count = 0;
+	for(size_t at = in.find(text); at != std::string::npos; at = in.find(text, at + text.size())){
+		count++;
+	}
+	return count;
+}
+
+// Values under 8 have their own bucket. Larger values are reported as the top of their bucket, within 12.5%.
+void histogramBuckets(){
+	std::vector<uint64_t> values = { 1, 7, 8, 9, 15, 16, 17, 100, 127, 128, 129, 1000, 1023, 1024, 1025, 999999, 1ull << 40 };
+	for(uint64_t value : values){
+		LatencyHistogram histogram;
+		histogram.record(value);
+		histogram.record(1ull << 50); // So the reported value is not capped by the max
+		uint64_t reported = histogram.percentile(50);
+		if(value < 8)
+			CHECK_EQUAL(reported, value);
+		CHECK(reported >= value);
+		CHECK(reported <= value + value / 8);
+	}
+
+	// 99 values in the bucket of 100 (96 to 103) and one outlier
+	LatencyHistogram histogram;
+	CHECK_EQUAL(histogram.percentile(99), (uint64_t)0);
+	for(int i = 0; i < 99; ++i){
+		histogram.record(100);
+	}
+	histogram.record(1000000);
+	CHECK_EQUAL(histogram.getCount(), (uint64_t)100);
+	CHECK_EQUAL(histogram.getTotal(), (uint64_t)(99 * 100 + 1000000));
+	CHECK_EQUAL(histogram.getMax(), (uint64_t)1000000);
+	CHECK_EQUAL(histogram.percentile(50), (uint64_t)103);
+	CHECK_EQUAL(histogram.percentile(99), (uint64_t)103);
+	CHECK_EQUAL(histogram.percentile(100), (uint64_t)1000000);
+
+	// Never more than the largest value recorded
+	LatencyHistogram single;
+	single.record(1000);
+	CHECK_EQUAL(single.percentile(50), (uint64_t)1000);
+	single.reset();
+	CHECK_EQUAL(single.getCount(), (uint64_t)0);
+	CHECK_EQUAL(single.percentile(50), (uint64_t)0);
+}
+
+// The trace keeps the newest events, oldest first
+void traceKeepsNewest(){
+	AutoProfiler profiler;
+	profiler.record(AutoProfiler::Kind::Tick, 0, AutoTime(0), AutoTime(1)); // Not kept without a trace
+	CHECK(profiler.traceEvents().empty());
+
+	profiler.enableTrace(3);
+	for(int i = 0; i < 5; ++i){
+		profiler.record(AutoProfiler::Kind::Process, (uint32_t)i, AutoTime(i * 10), AutoTime(i));
+	}
+	std::vector<AutoProfiler::TraceEvent> events = profiler.traceEvents();
+	CHECK_EQUAL(events.size(), (size_t)3);
+	for(size_t i = 0; i < events.size(); ++i){
+		CHECK_EQUAL(events[i].index, (uint32_t)(i + 2));
+	}
+	CHECK_EQUAL(profiler.indexCount(AutoProfiler::Kind::Process), (size_t)5);
+	CHECK_EQUAL(profiler.histogram(AutoProfiler::Kind::Process, 4).getCount(), (uint64_t)1);
+	CHECK_EQUAL(profiler.histogram(AutoProfiler::Kind::Process, 9).getCount(), (uint64_t)0);
+	CHECK_EQUAL(profiler.histogram(AutoProfiler::Kind::Tick, 0).getCount(), (uint64_t)1);
+
+	profiler.reset();
+	CHECK(profiler.traceEvents().empty());
+	CHECK_EQUAL(profiler.histogram(AutoProfiler::Kind::Tick, 0).getCount(), (uint64_t)0);
+}
+
+// A profiled run of Test.csv measures every tick and is named by command
+void profileOfRun(){
+	AutoProfiler profiler;
+	profiler.setAllocationCounter(test::allocationCount);
+	AutoManager manager;
+	FakeAutoClock clock;
+	manager.setClock(&clock);
+	manager.setProfiler(&profiler);
+	test::registerCommands(manager);
+	CHECK(manager.loadScript(test::sourcePath("Test.csv")));
+	uint64_t processCalls = test::runToEnd(manager, clock) + 1; // The last call returns false
+
+	std::vector<ProfileEntry> profile = manager.getProfile();
+	auto find = [&profile](const std::string &name) -> const ProfileEntry* {
+		for(const ProfileEntry &entry : profile){
+			if(entry.name == name)
+				return &entry;
+		}
+		return nullptr;
+	};
+	const ProfileEntry *tick = find("tick");
+	CHECK(tick != nullptr && tick->count == processCalls);
+	CHECK(tick != nullptr && tick->p50 <= tick->p99 && tick->p99 <= tick->max && tick->max <= tick->total);
+	const ProfileEntry *driveStart = find("drive.start");
+	CHECK(driveStart != nullptr && driveStart->count == 2);
+	CHECK(find("drive.process") != nullptr);
+	const ProfileEntry *rotateStart = find("rotate.start");
+	CHECK(rotateStart != nullptr && rotateStart->count == 1);
+	CHECK(find("intake_in.process") != nullptr);
+	CHECK(find("move_lifter.process") != nullptr);
+	CHECK_EQUAL(profiler.getAllocationsPerTick().getCount(), processCalls);
+}
+
+// The trace is written as Chrome trace event JSON with one complete event per kept measurement
+void chromeTrace(){
+	AutoProfiler profiler;
+	profiler.enableTrace(100);
+	AutoManager manager;
+	FakeAutoClock clock;
+	manager.setClock(&clock);
+	std::ostringstream none;
+	CHECK(!manager.writeChromeTrace(none));
+
+	manager.setProfiler(&profiler);
+	test::registerCommands(manager);
+	CHECK(manager.loadScript(test::sourcePath("Test.csv")));
+	test::runToEnd(manager, clock);
+
+	std::ostringstream out;
+	CHECK(manager.writeChromeTrace(out));
+	std::string json = out.str();
+	CHECK_EQUAL(json.rfind("{\"traceEvents\":[", 0), (size_t)0);
+	CHECK_EQUAL(json.substr(json.size() - 4), std::string("\n]}\n"));
+	CHECK_EQUAL(countOf(json, "\"ph\":\"X\""), profiler.traceEvents().size());
+	CHECK_EQUAL(countOf(json, "{"), profiler.traceEvents().size() + 1);
+	CHECK_EQUAL(countOf(json, "}"), profiler.traceEvents().size() + 1);
+	CHECK(countOf(json, "\"name\":\"tick\"") > 0);
+	CHECK(countOf(json, "\"name\":\"move_lifter.process\"") > 0);
+	CHECK_EQUAL(countOf(json, "\"ts\":-"), (size_t)0);
+	CHECK(countOf(json, "\"ts\":0,") > 0); // Times start at the oldest kept event
+}
+
+}
+
+void test::profilerTests(){
+	histogramBuckets();
+	traceKeepsNewest();
+	profileOfRun();
+	chromeTrace();
+}
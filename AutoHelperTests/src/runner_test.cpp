@@ -0,0 +1,86 @@
+#include <test.hpp>
+#include <test_commands.hpp>
+
+#include <autorunner.hpp>
+
+#include <thread>
+#include <atomic>
+
+using namespace team2655;
+
+namespace{
+
+// A stop requested before run() is not lost
+void stopBeforeRun(){
+	AutoManager manager;
+	test::registerCommands(manager);
+	CHECK(manager.loadScript(test::sourcePath("Test.csv")));
+	PeriodicRunner runner(manager, 1000);
+	runner.stop();
+	runner.run();
+	CHECK_EQUAL(runner.getStats().ticks, (uint64_t)0);
+
+	// The request was used up so the next run goes to the end of the script
+	runner.run();
+	CHECK(runner.getStats().ticks > 0);
+}
+
+// Stats can be read from another thread while the runner ticks
+void statsFromAnotherThread(){
+	AutoManager manager;
+	test::registerCommands(manager);
+	CHECK(manager.loadScript(test::sourcePath("Test.csv")));
+	PeriodicRunner runner(manager, 1000);
+
+	std::atomic<bool> done{false};
+	uint64_t lastTicks = 0;
+	bool increasing = true;
+	std::thread reader([&](){
+		while(!done.load()){
+			uint64_t ticks = runner.getStats().ticks;
+			increasing = increasing && ticks >= lastTicks;
+			lastTicks = ticks;
+			std::this_thread::yield();
+		}
+	});
+	runner.run();
+	done = true;
+	reader.join();
+	CHECK(increasing);
+
+	// Every tick until process() returned false (one more than the ticks it returned true for)
+	AutoManager reference;
+	FakeAutoClock clock;
+	reference.setClock(&clock);
+	test::registerCommands(reference);
+	CHECK(reference.loadScript(test::sourcePath("Test.csv")));
+	CHECK_EQUAL(runner.getStats().ticks, (uint64_t)test::runToEnd(reference, clock) + 1);
+
+	runner.resetStats();
+	CHECK_EQUAL(runner.getStats().ticks, (uint64_t)0);
+}
+
+// stop() from another thread ends run() after the current tick
+void stopFromAnotherThread(){
+	AutoManager manager;
+	manager.registerCommand<test::TickCommand>("drive");
+	manager.addCommand("drive", {"1000"}); // Far longer than the test
+	PeriodicRunner runner(manager, 1000);
+	std::thread stopper([&](){
+		while(runner.getStats().ticks < 5){
+			std::this_thread::yield();
+		}
+		runner.stop();
+	});
+	runner.run();
+	stopper.join();
+	CHECK(runner.getStats().ticks >= 5);
+}
+
+}
+
+void test::runnerTests(){
+	stopBeforeRun();
+	statsFromAnotherThread();
+	stopFromAnotherThread();
+}
@@ -0,0 +1,129 @@
+#include <test.hpp>
+#include <test_commands.hpp>
+
+#include <autoscript.hpp>
+
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+#include <cstddef>
+#include <iterator>
+
+using namespace team2655;
+
+namespace{
+
+const char *csvText =
+		"MOVE_LIFTER,10\r\n"
+		"Drive,1.5,\n"
+		"intake_in\n"
+		"PARALLEL_BEGIN\n"
+		"drive,0.5\n"
+		"rotate,-2,extra,text with spaces\n"
+		"PARALLEL_END\n"
+		"move_lifter,+3,id=lift,after=start\n"
+		"\n"
+		"DRIVE,3";
+
+void checkSameRows(const AutoScript &a, const AutoScript &b){
+	CHECK_EQUAL(a.size(), b.size());
+	for(size_t i = 0; i < a.size() && i < b.size(); ++i){
+		const ScriptRow &rowA = a.row(i);
+		const ScriptRow &rowB = b.row(i);
+		CHECK_EQUAL(a.name(rowA.nameId), b.name(rowB.nameId));
+		CHECK_EQUAL(rowA.argCount + rowA.annotationCount, rowB.argCount + rowB.annotationCount);
+		for(uint32_t arg = 0; arg < rowA.argCount + rowA.annotationCount && arg < rowB.argCount + rowB.annotationCount; ++arg){
+			CHECK_EQUAL(rowA.args[arg], rowB.args[arg]);
+		}
+	}
+}
+
+// CSV -> binary -> load gives the same rows and arguments
+void binaryRoundTrip(){
+	std::string csvPath = test::writeScript("roundtrip.csv", csvText);
+	std::string binaryPath = test::tempPath("roundtrip.bin");
+
+	AutoScript csv;
+	CHECK(csv.load(csvPath));
+	CHECK_EQUAL(csv.size(), (size_t)9);
+	CHECK_EQUAL(csv.name(csv.row(1).nameId), std::string_view("drive"));
+	CHECK(csv.saveBinary(binaryPath));
+
+	AutoScript binary;
+	CHECK(binary.load(binaryPath));
+	checkSameRows(csv, binary);
+
+	// Loading appends, so a binary script loaded after another script keeps both
+	AutoScript both;
+	CHECK(both.load(csvPath));
+	CHECK(both.load(binaryPath));
+	CHECK_EQUAL(both.size(), csv.size() * 2);
+	CHECK_EQUAL(both.nameCount(), csv.nameCount());
+
+	std::remove(binaryPath.c_str());
+}
+
+// A compiled Test.csv runs exactly like the CSV
+void binaryRunsLikeCsv(){
+	std::string binaryPath = test::tempPath("Test.bin");
+	AutoScript csv;
+	CHECK(csv.load(test::sourcePath("Test.csv")));
+	CHECK(csv.saveBinary(binaryPath));
+
+	size_t ticks[2];
+	int lifter[2];
+	const std::string paths[2] = { test::sourcePath("Test.csv"), binaryPath };
+	for(int i = 0; i < 2; ++i){
+		AutoManager manager;
+		FakeAutoClock clock;
+		manager.setClock(&clock);
+		manager.registerCommand<test::TickCommand>("drive");
+		manager.registerCommand<test::TickCommand>("rotate");
+		manager.registerBackgroundCommand<test::IntakeCommand>({"intake_in", "intake_out", "intake_stop"});
+		test::LifterCommand *lifterCommand = manager.registerBackgroundInstance<test::LifterCommand>("move_lifter");
+		CHECK(manager.loadScript(paths[i]));
+		ticks[i] = test::runToEnd(manager, clock);
+		lifter[i] = lifterCommand->currentPos;
+	}
+	CHECK_EQUAL(ticks[0], ticks[1]);
+	CHECK_EQUAL(lifter[0], 5);
+	CHECK_EQUAL(lifter[1], 5);
+	std::remove(binaryPath.c_str());
+}
+
+// Truncated or damaged binary scripts fail to load instead of being read past their end
+void damagedBinaryFails(){
+	std::string csvPath = test::writeScript("damaged.csv", csvText);
+	std::string binaryPath = test::tempPath("damaged.bin");
+	AutoScript csv;
+	CHECK(csv.load(csvPath));
+	CHECK(csv.saveBinary(binaryPath));
+
+	std::ifstream in(binaryPath, std::ios::binary);
+	std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+	in.close();
+
+	// Truncated
+	for(size_t cut : { data.size() / 2, data.size() - 1, sizeof(BinaryScriptHeader) }){
+		std::ofstream(binaryPath, std::ios::binary).write(data.data(), cut);
+		AutoScript loaded;
+		CHECK(!loaded.loadBinary(binaryPath));
+	}
+
+	// Another version
+	std::string otherVersion = data;
+	uint32_t version = BinaryScriptHeader::CurrentVersion + 1;
+	std::memcpy(&otherVersion[offsetof(BinaryScriptHeader, version)], &version, sizeof(version));
+	std::ofstream(binaryPath, std::ios::binary).write(otherVersion.data(), otherVersion.size());
+	AutoScript loaded;
+	CHECK(!loaded.loadBinary(binaryPath));
+	std::remove(binaryPath.c_str());
+}
+
+}
+
+void test::scriptTests(){
+	binaryRoundTrip();
+	binaryRunsLikeCsv();
+	damagedBinaryFails();
+}
@@ -0,0 +1,106 @@
+#include <test.hpp>
+#include <test_commands.hpp>
+
+#include <autosimulator.hpp>
+
+#include <string>
+#include <vector>
+
+using namespace team2655;
+
+namespace{
+
+/**
+ * Run a script with the fake clock (the same steps as the simulator)
+ * @return The number of process() calls, counting the last one that returned false
+ */
+uint64_t referenceTicks(const std::string &path){
+	AutoManager manager;
+	FakeAutoClock clock;
+	manager.setClock(&clock);
+	test::registerCommands(manager);
+	CHECK(manager.loadScript(path));
+	return test::runToEnd(manager, clock) + 1;
+}
+
+// Test.csv runs to the end in simulated time. A script longer than the time limit is stopped at the limit.
+void runsTestScript(){
+	AutoManager manager;
+	test::registerCommands(manager);
+	CHECK(manager.loadScript(test::sourcePath("Test.csv")));
+	AutoSimulator simulator;
+	SimulationResult result = simulator.run(manager);
+	CHECK(result.loaded);
+	CHECK(result.finished);
+	CHECK_EQUAL(result.ticks, referenceTicks(test::sourcePath("Test.csv")));
+	CHECK(result.simulatedTime == (int64_t)(result.ticks - 1) * test::Tick);
+	CHECK(&manager.getClock() == &SteadyAutoClock::instance()); // Given back its clock
+
+	// Runs the same again (run restarts the script)
+	SimulationResult again = simulator.run(manager);
+	CHECK_EQUAL(again.ticks, result.ticks);
+
+	AutoManager slow;
+	test::registerCommands(slow);
+	CHECK(slow.loadScript(test::writeScript("simulate_long.csv", "drive,3\ndrive,3\n")));
+	simulator.setTimeLimit(std::chrono::seconds(1));
+	SimulationResult stopped = simulator.run(slow);
+	CHECK(stopped.loaded);
+	CHECK(!stopped.finished);
+	CHECK(stopped.simulatedTime == std::chrono::seconds(1));
+	CHECK_EQUAL(stopped.ticks, (uint64_t)51); // Ticks at 0 to 1000ms
+}
+
+/**
+ * Cases that each run Test.csv with a different first drive. Every fifth case fails its setup.
+ */
+std::vector<SimulationCase> makeCases(){
+	std::vector<SimulationCase> cases;
+	for(int i = 0; i < 40; ++i){
+		SimulationCase simulationCase;
+		simulationCase.name = "drive_" + std::to_string(i);
+		simulationCase.setup = [i](AutoManager &manager){
+			if(i % 5 == 4)
+				return false;
+			test::registerCommands(manager);
+			manager.addCommand("drive", { std::to_string(i / 10.0) });
+			manager.addCommand("move_lifter", { std::to_string(i) });
+			manager.addCommand("rotate", { "0.5" });
+			return true;
+		};
+		cases.push_back(simulationCase);
+	}
+	return cases;
+}
+
+// A batch gives the same results whatever the number of threads. Cases whose setup fails are not loaded.
+void batchIsDeterministic(){
+	std::vector<SimulationCase> cases = makeCases();
+	AutoSimulator simulator;
+	std::vector<SimulationResult> serial = simulator.runBatch(cases, 1);
+	std::vector<SimulationResult> parallel = simulator.runBatch(cases, 4);
+	CHECK_EQUAL(serial.size(), cases.size());
+	CHECK_EQUAL(parallel.size(), cases.size());
+	for(size_t i = 0; i < cases.size() && i < serial.size() && i < parallel.size(); ++i){
+		bool fails = i % 5 == 4;
+		CHECK_EQUAL(serial[i].loaded, !fails);
+		CHECK_EQUAL(parallel[i].loaded, !fails);
+		CHECK_EQUAL(serial[i].finished, !fails);
+		CHECK_EQUAL(parallel[i].finished, serial[i].finished);
+		CHECK_EQUAL(parallel[i].ticks, serial[i].ticks);
+		CHECK(parallel[i].simulatedTime == serial[i].simulatedTime);
+		if(fails)
+			continue;
+
+		AutoManager manager;
+		CHECK(cases[i].setup(manager));
+		CHECK_EQUAL(simulator.run(manager).ticks, serial[i].ticks);
+	}
+}
+
+}
+
+void test::simulatorTests(){
+	runsTestScript();
+	batchIsDeterministic();
+}
@@ -0,0 +1,164 @@
+#include <test.hpp>
+#include <test_commands.hpp>
+
+#include <string>
+#include <thread>
+
+using namespace team2655;
+
+namespace{
+
+std::string events; // "<name>@<tick> " for every process call
+int currentTick = 0;
+
+// nap,<ms>: sleeps for <ms> when started (until woken if 0), then completes the first time it is processed
+class NapCommand : public TypedAutoCommand<int>{
+public:
+	static NapCommand *last; // The most recently started nap
+	bool wakeFirst = false;  // Call wake before sleeping (the sleep must be cancelled)
+
+	void start(std::string_view commandName, const std::tuple<int> &args) override {
+		last = this;
+		if(wakeFirst)
+			wake();
+		if(std::get<0>(args) > 0)
+			sleepFor(std::chrono::milliseconds(std::get<0>(args)));
+		else
+			sleep();
+	}
+	void process() override {
+		events += "nap@" + std::to_string(currentTick) + " ";
+		complete();
+	}
+	void handleComplete() override {  }
+};
+NapCommand *NapCommand::last = nullptr;
+
+// light,<ms>: sleeps for <ms> when given arguments (until woken if 0), then sleeps until woken each time it is processed
+class LightCommand : public TypedBackgroundAutoCommand<int>{
+public:
+	int checks = 0; // shouldProcess calls
+
+	void updateArgs(std::string_view commandName, const std::tuple<int> &args) override {
+		if(std::get<0>(args) > 0)
+			sleepFor(std::chrono::milliseconds(std::get<0>(args)));
+		else
+			sleep();
+	}
+	void process() override {
+		events += "light@" + std::to_string(currentTick) + " ";
+		sleep();
+	}
+	void kill() override {  }
+	bool shouldProcess() override {
+		checks++;
+		return true;
+	}
+};
+
+struct Run{
+	AutoManager manager;
+	FakeAutoClock clock;
+	LightCommand *light = nullptr;
+
+	/**
+	 * @param withLight Register the light (it is processed until the script sleeps it)
+	 */
+	Run(bool withLight = false){
+		manager.setClock(&clock);
+		manager.registerCommand<NapCommand>("nap");
+		manager.registerCommand<test::TickCommand>("drive");
+		if(withLight)
+			light = manager.registerBackgroundInstance<LightCommand>("light");
+		events.clear();
+		currentTick = 0;
+		NapCommand::last = nullptr;
+	}
+
+	/**
+	 * Process one tick
+	 * @return What process returned
+	 */
+	bool tick(){
+		bool result = manager.process();
+		clock.advance(test::Tick);
+		currentTick++;
+		return result;
+	}
+
+	/**
+	 * Process ticks until the script ends
+	 */
+	void toEnd(){
+		while(currentTick < 1000 && tick()){  }
+	}
+};
+
+// A sleeping command is not processed until its deadline
+void foregroundSleepsUntilDeadline(){
+	Run run;
+	CHECK(run.manager.loadScript(test::writeScript("sleep_nap.csv", "nap,100\n")));
+	run.toEnd();
+	CHECK_EQUAL(events, std::string("nap@5 "));
+}
+
+// A command sleeping without a deadline is processed on the tick after another thread wakes it
+void foregroundWakeFromThread(){
+	Run run;
+	CHECK(run.manager.loadScript(test::writeScript("sleep_nap_wake.csv", "nap,0\n")));
+	for(int i = 0; i < 5; ++i){
+		CHECK(run.tick());
+	}
+	CHECK(NapCommand::last != nullptr && NapCommand::last->isSleeping());
+	std::thread waker([](){ NapCommand::last->wake(); });
+	waker.join();
+	run.toEnd();
+	CHECK_EQUAL(events, std::string("nap@5 "));
+}
+
+// A wake before the command sleeps cancels that sleep
+void wakeBeforeSleepIsKept(){
+	Run run;
+	CHECK(run.manager.loadScript(test::writeScript("sleep_nap_early.csv", "nap,0\n")));
+	run.tick(); // Creates the command
+	CHECK(NapCommand::last != nullptr);
+	run.manager.restartScript();
+	events.clear();
+	NapCommand::last->wakeFirst = true; // Restarting reuses the command from the pool
+	run.toEnd();
+	CHECK_EQUAL(events, std::string("nap@1 "));
+}
+
+// A sleeping background command is neither checked nor processed until its deadline
+void backgroundSleepsUntilDeadline(){
+	Run run(true);
+	CHECK(run.manager.loadScript(test::writeScript("sleep_light.csv", "light,100\ndrive,1\n")));
+	run.toEnd();
+	CHECK_EQUAL(events, std::string("light@5 "));
+	CHECK_EQUAL(run.light->checks, 1);
+}
+
+// A background command sleeping without a deadline is processed on the tick after another thread wakes it
+void backgroundWakeFromThread(){
+	Run run(true);
+	CHECK(run.manager.loadScript(test::writeScript("sleep_light_wake.csv", "light,0\ndrive,1\n")));
+	for(int i = 0; i < 3; ++i){
+		CHECK(run.tick());
+	}
+	CHECK(run.light->isSleeping());
+	std::thread waker([&run](){ run.light->wake(); });
+	waker.join();
+	run.toEnd();
+	CHECK_EQUAL(events, std::string("light@3 "));
+	CHECK_EQUAL(run.light->checks, 1);
+}
+
+}
+
+void test::sleepTests(){
+	foregroundSleepsUntilDeadline();
+	foregroundWakeFromThread();
+	wakeBeforeSleepIsKept();
+	backgroundSleepsUntilDeadline();
+	backgroundWakeFromThread();
+}
@@ -0,0 +1,184 @@
+#include <test.hpp>
+#include <test_commands.hpp>
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+
+using namespace team2655;
+
+namespace{
+
+// A robot process: a manager with the commands registered and a script loaded
+struct Robot{
+	AutoManager manager;
+	FakeAutoClock clock;
+	test::IntakeCommand *intake;
+	test::LifterCommand *lifter;
+
+	Robot(const std::string &scriptPath){
+		manager.setClock(&clock);
+		manager.registerCommand<test::DriveCommand>("drive");
+		manager.registerCommand<test::TickCommand>("count"); // Counts its ticks itself (saved in snapshots)
+		intake = manager.registerBackgroundInstance<test::IntakeCommand>("intake_in");
+		lifter = manager.registerBackgroundInstance<test::LifterCommand>("move_lifter");
+		CHECK(manager.loadScript(scriptPath));
+	}
+
+	/**
+	 * Process one tick
+	 * @return What process returned
+	 */
+	bool tick(){
+		bool result = manager.process();
+		clock.advance(test::Tick);
+		return result;
+	}
+};
+
+const char *linearScript = "MOVE_LIFTER,10\nDRIVE,1\nINTAKE_IN\nCOUNT,0.7\nMOVE_LIFTER,5\nDRIVE,0.5\n";
+const char *groupScript = "COUNT,0.3\nPARALLEL_BEGIN\nCOUNT,0.4\nDRIVE,0.3\nMOVE_LIFTER,8\nPARALLEL_END\n"
+		"RACE_BEGIN\nCOUNT,0.9\nINTAKE_IN\nDRIVE,0.1\nRACE_END\nDRIVE,0.2\n";
+const char *graphScript = "DRIVE,0.4,id=a\nCOUNT,0.6,id=b\nMOVE_LIFTER,3,after=a\nINTAKE_IN,after=b\nCOUNT,0.3,after=a,after=b\nDRIVE,0.2,after=b\n";
+
+/**
+ * Stop a run after every number of ticks, restore the snapshot it saved in a new manager and check the restored run
+ * finishes like a run that was never stopped
+ * @param name The name of the script file
+ * @param text The script
+ */
+void crashAtEveryTick(const std::string &name, const std::string &text){
+	std::string scriptPath = test::writeScript(name, text);
+	std::string snapshotPath = test::tempPath(name + ".snap");
+
+	Robot reference(scriptPath);
+	int total = 0;
+	while(total < 1000 && reference.tick()){
+		total++;
+	}
+
+	for(int k = 0; k <= total; ++k){
+		std::remove(snapshotPath.c_str());
+		{
+			SnapshotBuffer snapshots;
+			CHECK(snapshots.open(snapshotPath, 4096));
+			Robot crashed(scriptPath);
+			crashed.manager.setSnapshotBuffer(&snapshots);
+			for(int i = 0; i < k; ++i){
+				crashed.tick();
+			}
+		}
+
+		// A new process with a clock that started at a different time
+		SnapshotBuffer snapshots;
+		CHECK(snapshots.open(snapshotPath, 4096));
+		Robot restored(scriptPath);
+		restored.clock.set(AutoTime(std::chrono::hours(1)) + test::Tick * k);
+		CHECK_EQUAL(restored.manager.restoreSnapshot(snapshots), k > 0); // Nothing was saved before the first tick
+		int rest = 0;
+		while(rest < 1000 && restored.tick()){
+			rest++;
+		}
+		CHECK_EQUAL(k + rest, total);
+		CHECK_EQUAL(restored.lifter->currentPos, reference.lifter->currentPos);
+		CHECK_EQUAL(restored.intake->ticks, reference.intake->ticks);
+	}
+	std::remove(snapshotPath.c_str());
+}
+
+void linearSnapshots(){
+	crashAtEveryTick("snapshot_linear.csv", linearScript);
+}
+
+void groupSnapshots(){
+	crashAtEveryTick("snapshot_groups.csv", groupScript);
+}
+
+void graphSnapshots(){
+	crashAtEveryTick("snapshot_graph.csv", graphScript);
+}
+
+// Snapshots of another script and damaged snapshots are not restored (the script runs from the start)
+void badSnapshotsRejected(){
+	std::string linearPath = test::writeScript("snapshot_bad_linear.csv", linearScript);
+	std::string graphPath = test::writeScript("snapshot_bad_graph.csv", graphScript);
+	std::string snapshotPath = test::tempPath("snapshot_bad.snap");
+	std::remove(snapshotPath.c_str());
+
+	SnapshotBuffer snapshots;
+	CHECK(snapshots.open(snapshotPath, 4096));
+	Robot saved(linearPath);
+	saved.manager.setSnapshotBuffer(&snapshots);
+	for(int i = 0; i < 30; ++i){
+		saved.tick();
+	}
+	saved.manager.setSnapshotBuffer(nullptr);
+
+	Robot other(graphPath);
+	CHECK(!other.manager.restoreSnapshot(snapshots));
+
+	const uint8_t *data = nullptr;
+	size_t size = 0;
+	CHECK(snapshots.latest(data, size));
+	std::vector<uint8_t> copy(data, data + size);
+	size_t accepted = 0;
+	for(size_t cut = 0; cut < size; ++cut){
+		Robot truncated(linearPath);
+		accepted += truncated.manager.restoreSnapshot(copy.data(), cut);
+	}
+	CHECK_EQUAL(accepted, (size_t)0);
+
+	Robot whole(linearPath);
+	CHECK(whole.manager.restoreSnapshot(copy.data(), copy.size()));
+	CHECK_EQUAL(saved.manager.saveSnapshot(copy.data(), 16), (size_t)0); // Too small
+	std::remove(snapshotPath.c_str());
+}
+
+// A graph snapshot that does not have every row's dependency count is rejected, unless the run was killed
+void partialGraphRejected(){
+	std::string graphPath = test::writeScript("snapshot_partial_graph.csv", graphScript);
+	Robot saved(graphPath);
+	for(int i = 0; i < 3; ++i){
+		saved.tick();
+	}
+	std::vector<uint8_t> snapshot(4096);
+	snapshot.resize(saved.manager.saveSnapshot(snapshot.data(), snapshot.size()));
+	CHECK(snapshot.size() > 0);
+
+	// Header, started flag, count then the counts. Keep the first two counts.
+	size_t countAt = sizeof(SnapshotHeader) + sizeof(uint8_t);
+	uint32_t count = 0;
+	std::memcpy(&count, snapshot.data() + countAt, sizeof(count));
+	CHECK_EQUAL(count, (uint32_t)6);
+	std::vector<uint8_t> partial(snapshot.begin(), snapshot.begin() + countAt);
+	uint32_t kept = 2;
+	partial.insert(partial.end(), (const uint8_t*)&kept, (const uint8_t*)&kept + sizeof(kept));
+	size_t countsAt = countAt + sizeof(uint32_t);
+	partial.insert(partial.end(), snapshot.begin() + countsAt, snapshot.begin() + countsAt + kept * sizeof(uint32_t));
+	partial.insert(partial.end(), snapshot.begin() + countsAt + count * sizeof(uint32_t), snapshot.end());
+
+	Robot restored(graphPath);
+	CHECK(!restored.manager.restoreSnapshot(partial.data(), partial.size()));
+	CHECK_EQUAL(test::runToEnd(restored.manager, restored.clock), (size_t)(test::runToEnd(saved.manager, saved.clock) + 3));
+
+	// A killed run has nothing left to wait for. It stays ended when restored.
+	Robot killed(graphPath);
+	killed.tick();
+	killed.manager.killAuto();
+	snapshot.resize(4096);
+	snapshot.resize(killed.manager.saveSnapshot(snapshot.data(), snapshot.size()));
+	Robot restoredKilled(graphPath);
+	CHECK(restoredKilled.manager.restoreSnapshot(snapshot.data(), snapshot.size()));
+	CHECK(!restoredKilled.tick());
+}
+
+}
+
+void test::snapshotTests(){
+	linearSnapshots();
+	groupSnapshots();
+	graphSnapshots();
+	badSnapshotsRejected();
+	partialGraphRejected();
+}
@@ -0,0 +1,86 @@
+#include <test.hpp>
+#include <test_commands.hpp>
+
+#include <autostatic.hpp>
+
+#include <string>
+
+using namespace team2655;
+
+namespace{
+
+typedef quiet::StaticQuietManager StaticManager;
+
+// Names are resolved at compile time
+static_assert(StaticManager::nameCount() == 6, "every name of every command");
+static_assert(StaticManager::resolveName("rotate").kind == AutoOpcode::Command, "rotate is the tick command");
+static_assert(StaticManager::resolveName("rotate").index == 0, "rotate is the tick command");
+static_assert(StaticManager::resolveName("intake_stop").kind == AutoOpcode::Background, "intake is a background command");
+static_assert(StaticManager::resolveName("move_lifter").index == 2, "the lifter is the third type");
+static_assert(StaticManager::resolveName("fly").kind == AutoOpcode::Unknown, "no command is named fly");
+
+/**
+ * Run a script with a StaticAutoManager and an AutoManager and check they take the same ticks and end the same way
+ * @param path The script
+ */
+void sameAsAutoManager(const std::string &path){
+	StaticManager staticManager;
+	FakeAutoClock staticClock;
+	staticManager.setClock(&staticClock);
+	CHECK(staticManager.loadScript(path));
+	size_t staticTicks = 0;
+	while(staticTicks < 10000 && staticManager.process()){
+		staticClock.advance(test::Tick);
+		staticTicks++;
+	}
+
+	AutoManager manager;
+	FakeAutoClock clock;
+	manager.setClock(&clock);
+	manager.registerCommand<test::TickCommand>("drive");
+	manager.registerCommand<test::TickCommand>("rotate");
+	manager.registerBackgroundCommand<test::IntakeCommand>({"intake_in", "intake_out", "intake_stop"});
+	test::LifterCommand *lifter = manager.registerBackgroundInstance<test::LifterCommand>("move_lifter");
+	CHECK(manager.loadScript(path));
+	size_t ticks = test::runToEnd(manager, clock);
+
+	CHECK_EQUAL(staticTicks, ticks);
+	CHECK(lifter != nullptr);
+	if(lifter != nullptr)
+		CHECK_EQUAL(staticManager.command<test::LifterCommand>().currentPos, lifter->currentPos);
+
+	// Runs the same again after a restart
+	staticManager.restartScript();
+	size_t again = 0;
+	while(again < 10000 && staticManager.process()){
+		staticClock.advance(test::Tick);
+		again++;
+	}
+	CHECK_EQUAL(again, staticTicks);
+}
+
+void testScript(){
+	sameAsAutoManager(test::sourcePath("Test.csv"));
+	sameAsAutoManager(test::writeScript("static_mixed.csv", "rotate,0.3\nmove_lifter,4\nintake_out\ndrive,0.7\nmove_lifter,-3\nintake_stop\nrotate,1.2\n"));
+}
+
+// Scripts a StaticAutoManager cannot run fail to load (instead of skipping rows while running)
+void unsupportedRowsRejected(){
+	StaticManager manager;
+	CHECK(!manager.loadScript(test::writeScript("static_unknown.csv", "drive,1\nfly,2\n")));
+	CHECK_EQUAL(manager.loadedCommandCount(), (size_t)0);
+	CHECK(!manager.process());
+	CHECK(!manager.loadScript(test::writeScript("static_group.csv", "PARALLEL_BEGIN\ndrive,1\nrotate,1\nPARALLEL_END\n")));
+	CHECK(!manager.loadScript(test::writeScript("static_graph.csv", "drive,1,id=a\nrotate,1,after=a\n")));
+	CHECK(!manager.loadScript(test::writeScript("static_bad_args.csv", "drive,fast\n")));
+	CHECK_EQUAL(manager.loadedCommandCount(), (size_t)0);
+	CHECK(manager.loadScript(test::writeScript("static_good.csv", "drive,1\nrotate,1\n")));
+	CHECK_EQUAL(manager.loadedCommandCount(), (size_t)2);
+}
+
+}
+
+void test::staticTests(){
+	testScript();
+	unsupportedRowsRejected();
+}
@@ -0,0 +1,154 @@
+#include <test.hpp>
+#include <test_commands.hpp>
+
+#include <autotelemetry.hpp>
+
+#include <string>
+#include <vector>
+#include <set>
+#include <cstdio>
+
+using namespace team2655;
+
+namespace{
+
+/**
+ * Count the records of a type
+ */
+size_t countOf(const std::vector<TelemetryRecord> &records, uint16_t type){
+	size_t count = 0;
+	for(const TelemetryRecord &record : records){
+		count += record.event.type == type;
+	}
+	return count;
+}
+
+// Events and names read back as they were recorded. A name is saved before the events recorded after it.
+void roundTrip(){
+	std::string path = test::tempPath("telemetry_round_trip.bin");
+	TelemetryLog log;
+	CHECK(log.open(path, 64));
+	CHECK(log.isOpen());
+	log.setName(0, "drive");      // Padded to 8 bytes
+	log.setName(1, "intake_o");   // Exactly 8 bytes
+	for(uint32_t i = 0; i < 20; ++i){
+		log.record(TelemetryEvent::CommandStart, i, i + 1, i % 2, AutoTime(i * 1000));
+	}
+	log.setName(2, "move_lifter");
+	log.record(TelemetryEvent::BackgroundUpdate, 7, 30, 2, AutoTime(-5));
+	log.close();
+	CHECK(!log.isOpen());
+	CHECK_EQUAL(log.droppedEvents(), (uint64_t)0);
+
+	std::vector<TelemetryRecord> records;
+	CHECK(readTelemetry(path, records));
+	CHECK_EQUAL(records.size(), (size_t)24);
+	CHECK_EQUAL(countOf(records, TelemetryEvent::Name), (size_t)3);
+	CHECK_EQUAL(countOf(records, TelemetryEvent::Dropped), (size_t)0);
+
+	uint32_t nextStart = 0;
+	bool sawLifterName = false;
+	for(const TelemetryRecord &record : records){
+		const TelemetryEvent &event = record.event;
+		if(event.type == TelemetryEvent::Name){
+			const char *expected[] = { "drive", "intake_o", "move_lifter" };
+			CHECK(event.index < 3 && record.name == expected[event.index]);
+			sawLifterName = sawLifterName || event.index == 2;
+		}else if(event.type == TelemetryEvent::CommandStart){
+			CHECK_EQUAL(event.index, nextStart);
+			CHECK_EQUAL(event.row, nextStart + 1);
+			CHECK_EQUAL(event.nameId, nextStart % 2);
+			CHECK_EQUAL(event.time, (int64_t)nextStart * 1000);
+			nextStart++;
+		}else{
+			CHECK_EQUAL(event.type, (uint16_t)TelemetryEvent::BackgroundUpdate);
+			CHECK(sawLifterName);
+			CHECK_EQUAL(event.index, (uint32_t)7);
+			CHECK_EQUAL(event.row, (uint32_t)30);
+			CHECK_EQUAL(event.time, (int64_t)-5);
+		}
+	}
+	CHECK_EQUAL(nextStart, (uint32_t)20);
+
+	// Not a log, or cut off in a name
+	std::string bad = test::writeScript("telemetry_bad.bin", "not a telemetry log at all");
+	CHECK(!readTelemetry(bad, records));
+	std::FILE *file = std::fopen(path.c_str(), "rb");
+	std::vector<char> bytes(sizeof(TelemetryHeader) + sizeof(TelemetryEvent) + 4);
+	CHECK(file != nullptr && std::fread(bytes.data(), 1, bytes.size(), file) == bytes.size());
+	if(file != nullptr)
+		std::fclose(file);
+	CHECK(!readTelemetry(test::writeScript("telemetry_cut.bin", std::string(bytes.begin(), bytes.end())), records));
+	std::remove(path.c_str());
+	std::remove(bad.c_str());
+}
+
+// Events that do not fit in the ring are counted and the count is saved in a Dropped record
+void smallRingDrops(){
+	std::string path = test::tempPath("telemetry_dropped.bin");
+	const uint64_t recorded = 10000;
+	TelemetryLog log;
+	CHECK(log.open(path, 4));
+	for(uint64_t i = 0; i < recorded; ++i){
+		log.record(TelemetryEvent::Tick, 0, 0, 0, AutoTime(i));
+	}
+	uint64_t dropped = log.droppedEvents();
+	log.close();
+	CHECK(dropped > 0);
+
+	std::vector<TelemetryRecord> records;
+	CHECK(readTelemetry(path, records));
+	CHECK(!records.empty() && records.back().event.type == TelemetryEvent::Dropped);
+	CHECK(!records.empty() && records.back().event.nameId == (uint32_t)dropped);
+	CHECK_EQUAL(countOf(records, TelemetryEvent::Tick) + dropped, recorded);
+
+	// Saved events keep their order
+	int64_t last = -1;
+	for(const TelemetryRecord &record : records){
+		if(record.event.type != TelemetryEvent::Tick)
+			continue;
+		CHECK(record.event.time > last);
+		last = record.event.time;
+	}
+	std::remove(path.c_str());
+}
+
+// A run of Test.csv logs every tick, start and background update, with the names of its rows
+void logOfRun(){
+	std::string path = test::tempPath("telemetry_run.bin");
+	TelemetryLog log;
+	CHECK(log.open(path));
+	AutoManager manager;
+	FakeAutoClock clock;
+	manager.setClock(&clock);
+	manager.setTelemetry(&log);
+	test::registerCommands(manager);
+	CHECK(manager.loadScript(test::sourcePath("Test.csv")));
+	size_t processCalls = test::runToEnd(manager, clock) + 1;
+	manager.setTelemetry(nullptr);
+	log.close();
+
+	std::vector<TelemetryRecord> records;
+	CHECK(readTelemetry(path, records));
+	CHECK_EQUAL(countOf(records, TelemetryEvent::Tick), processCalls);
+	CHECK_EQUAL(countOf(records, TelemetryEvent::CommandStart), (size_t)3);
+	CHECK_EQUAL(countOf(records, TelemetryEvent::CommandComplete), (size_t)3);
+	CHECK_EQUAL(countOf(records, TelemetryEvent::BackgroundUpdate), (size_t)4);
+	std::set<uint32_t> named;
+	for(const TelemetryRecord &record : records){
+		const TelemetryEvent &event = record.event;
+		if(event.type == TelemetryEvent::Name)
+			named.insert(event.index);
+		else if(event.type == TelemetryEvent::CommandStart || event.type == TelemetryEvent::BackgroundUpdate)
+			CHECK(named.count(event.nameId) == 1);
+	}
+	std::remove(path.c_str());
+}
+
+}
+
+void test::telemetryTests(){
+	roundTrip();
+	smallRingDrops();
+	logOfRun();
+}
@@ -0,0 +1,137 @@
+#include <test.hpp>
+#include <test_commands.hpp>
+
+#include <autothreads.hpp>
+
+#include <atomic>
+#include <vector>
+#include <functional>
+#include <string>
+
+using namespace team2655;
+
+namespace{
+
+// Every task submitted from outside the pool runs once and wait returns after the last one
+void runsEveryTask(){
+	WorkStealingPool pool(4);
+	std::atomic<int> count{0};
+	auto task = [&count](){ count++; };
+	for(int round = 0; round < 100; ++round){
+		TaskGroup group;
+		for(int i = 0; i < 50; ++i){
+			pool.submit(group, task);
+		}
+		pool.wait(group);
+		CHECK_EQUAL(count.load(), (round + 1) * 50);
+	}
+}
+
+// Tasks that submit more tasks to the same group (and wait on them from a worker)
+void runsNestedTasks(){
+	WorkStealingPool pool(3);
+	std::atomic<int> count{0};
+	auto leaf = [&count](){ count++; };
+	TaskGroup outer;
+	std::vector<std::function<void()>> parents;
+	for(int i = 0; i < 20; ++i){
+		parents.push_back([&pool, &leaf](){
+			TaskGroup inner;
+			for(int j = 0; j < 10; ++j){
+				pool.submit(inner, leaf);
+			}
+			pool.wait(inner);
+		});
+	}
+	for(std::function<void()> &parent : parents){
+		pool.submit(outer, parent);
+	}
+	pool.wait(outer);
+	CHECK_EQUAL(count.load(), 200);
+}
+
+std::atomic<int> sequence{0}; // Incremented by each StepCommand processed
+
+// Background command that records the order it was processed in. Runs after the commands in after.
+class StepCommand : public BackgroundAutoCommand{
+public:
+	std::vector<std::string> after;
+	bool parallel = true;
+	int order = -1; // Position in the tick it was last processed in
+	void updateArgs(std::string_view commandName, const ArgList &args) override {  }
+	void process() override {
+		order = sequence++;
+	}
+	void kill() override {  }
+	bool shouldProcess() override { return true; }
+	bool isParallelSafe() override { return parallel; }
+	std::vector<std::string> runAfter() override { return after; }
+};
+
+struct StepRun{
+	WorkStealingPool pool{3};
+	AutoManager manager;
+	FakeAutoClock clock;
+
+	StepRun(){
+		manager.setClock(&clock);
+		manager.setThreadPool(&pool);
+		manager.registerCommand<test::TickCommand>("drive");
+	}
+
+	/**
+	 * Process one tick (the order of the StepCommands starts from 0 each tick)
+	 */
+	void tick(){
+		sequence = 0;
+		manager.process();
+		clock.advance(test::Tick);
+	}
+};
+
+// Background commands are processed after the commands they run after (registered in any order, some on the pool)
+void stagesFollowDependencies(){
+	StepRun run;
+	StepCommand *output = run.manager.registerBackgroundInstance<StepCommand>("output");
+	StepCommand *filter = run.manager.registerBackgroundInstance<StepCommand>("filter");
+	StepCommand *logger = run.manager.registerBackgroundInstance<StepCommand>("logger");
+	StepCommand *sensor = run.manager.registerBackgroundInstance<StepCommand>("sensor");
+	StepCommand *other = run.manager.registerBackgroundInstance<StepCommand>("other");
+	output->after = { "filter", "logger" };
+	filter->after = { "SENSOR" };
+	logger->parallel = false;
+	CHECK(run.manager.loadScript(test::writeScript("stages.csv", "drive,1\n")));
+	for(int i = 0; i < 20; ++i){
+		run.tick();
+		CHECK(sensor->order < filter->order);
+		CHECK(filter->order < output->order);
+		CHECK(logger->order < output->order);
+		CHECK(other->order >= 0);
+	}
+}
+
+// Dependencies with a cycle are ignored. Every command is processed on the calling thread in registration order.
+void cycleUsesRegistrationOrder(){
+	StepRun run;
+	StepCommand *a = run.manager.registerBackgroundInstance<StepCommand>("a");
+	StepCommand *b = run.manager.registerBackgroundInstance<StepCommand>("b");
+	StepCommand *c = run.manager.registerBackgroundInstance<StepCommand>("c");
+	a->after = { "b" };
+	b->after = { "a" };
+	CHECK(run.manager.loadScript(test::writeScript("stages_cycle.csv", "drive,1\n")));
+	for(int i = 0; i < 20; ++i){
+		run.tick();
+		CHECK_EQUAL(a->order, 0);
+		CHECK_EQUAL(b->order, 1);
+		CHECK_EQUAL(c->order, 2);
+	}
+}
+
+}
+
+void test::threadTests(){
+	runsEveryTask();
+	runsNestedTasks();
+	stagesFollowDependencies();
+	cycleUsesRegistrationOrder();
+}
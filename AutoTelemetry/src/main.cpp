@@ -0,0 +1,72 @@
+/**
+ * AutoTelemetry
+ * Prints a telemetry log written by TelemetryLog (AutoManager::setTelemetry) as text.
+ * Usage: AutoTelemetry log.bin            (one line per event, times in ms since the first event)
+ *        AutoTelemetry --csv log.bin      (CSV: time_ms,event,row,command,index)
+ *
+ * Copyright (c) 2018 FRC Team 2655 - The Flying Platypi
+ * See LICENSE file for details
+ */
+
+#include <autotelemetry.hpp>
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdio>
+
+using namespace team2655;
+
+int main(int argc, char *argv[]){
+	bool csv = argc == 3 && std::string(argv[1]) == "--csv";
+	if(argc != 2 && !csv){
+		std::cerr << "Usage: " << argv[0] << " log.bin" << std::endl;
+		std::cerr << "       " << argv[0] << " --csv log.bin" << std::endl;
+		return 2;
+	}
+
+	std::vector<TelemetryRecord> records;
+	if(!readTelemetry(argv[argc - 1], records))
+		return 1;
+
+	std::unordered_map<uint32_t, std::string> names;
+	uint64_t ticks = 0;
+	uint64_t dropped = 0;
+	int64_t start = -1; // Times are printed relative to the first event
+	if(csv)
+		std::printf("time_ms,event,row,command,index\n");
+	for(const TelemetryRecord &record : records){
+		const TelemetryEvent &event = record.event;
+		if(event.type == TelemetryEvent::Name){
+			names[event.index] = record.name;
+			continue;
+		}
+		if(event.type == TelemetryEvent::Dropped){
+			dropped = event.nameId;
+			if(!csv)
+				std::printf("%llu events dropped (ring buffer full)\n", (unsigned long long)dropped);
+			continue;
+		}
+
+		if(start < 0)
+			start = event.time;
+		double ms = (event.time - start) / 1e6;
+		const char *type = telemetryTypeName(event.type);
+		if(event.type == TelemetryEvent::Tick){
+			ticks++;
+			if(csv)
+				std::printf("%.3f,%s,,,\n", ms, type);
+			continue; // Ticks are only counted in the text output
+		}
+		auto name = names.find(event.nameId);
+		const char *command = (name == names.end()) ? "?" : name->second.c_str();
+		if(csv)
+			std::printf("%.3f,%s,%u,%s,%u\n", ms, type, event.row + 1, command, event.index);
+		else
+			std::printf("%12.3f ms  %-10s row %-5u %s\n", ms, type, event.row + 1, command);
+	}
+	if(!csv)
+		std::printf("%llu ticks, %llu dropped events\n", (unsigned long long)ticks, (unsigned long long)dropped);
+	return 0;
+}
@@ -0,0 +1,86 @@
+/**
+ * autoanalysis.hpp
+ * Checking a script when it is loaded instead of while it runs: every row must have a registered command
+ * and valid arguments, and the longest the script can run for is computed from the commands' timeouts.
+ *
+ * Copyright (c) 2018 FRC Team 2655 - The Flying Platypi
+ * See LICENSE file for details
+ */
+
+#pragma once
+
+#include "autoscript.hpp"
+#include "autoargs.hpp"
+#include "autoclock.hpp"
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <type_traits>
+#include <cstdint>
+
+namespace team2655{
+
+/**
+ * Gives the longest a command can run for a script row's arguments (AutoTime::max() if there is no limit)
+ */
+typedef AutoTime (*CmdTimeoutBound)(const ArgList &args);
+
+/**
+ * Get the timeout bound for a command type.
+ * Typed commands declare one with a static function taking the parsed arguments:
+ *   static AutoTime timeoutFor(const std::tuple<double> &args){
+ *       return std::chrono::duration_cast<AutoTime>(std::chrono::duration<double>(std::get<0>(args)));
+ *   }
+ * The AutoManager uses it as the command's timeout (unless start sets a shorter one) so the command never runs longer.
+ * Commands without one have no bound (nullptr).
+ */
+template<class T, class = void>
+struct TimeoutBoundFor{
+	static constexpr CmdTimeoutBound value = nullptr;
+};
+
+template<class T>
+struct TimeoutBoundFor<T, std::void_t<decltype(T::timeoutFor(std::declval<const typename T::Arguments::Tuple&>()))>>{
+	static AutoTime bound(const ArgList &args){
+		if(args.parsed() == nullptr)
+			return AutoTime::max();
+		return T::timeoutFor(*static_cast<const typename T::Arguments::Tuple*>(args.parsed()));
+	}
+	static constexpr CmdTimeoutBound value = &bound;
+};
+
+/**
+ * What analyzeScript found out about a script
+ */
+struct ScriptAnalysis{
+	bool valid = true;           // Every row has a registered command (or is part of the language) and valid arguments
+	bool bounded = true;         // Every command the script waits for has a timeout bound
+	size_t unboundedRow = 0;     // First row the script may wait on forever (when not bounded)
+	uint64_t worstCaseTicks = 0; // Most ticks process() can return true for (when bounded)
+	AutoTime worstCase{0};       // worstCaseTicks ticks
+};
+
+/**
+ * Analyze a resolved script (see resolveScriptRows). Rows with no registered command are reported.
+ * A command started on a tick that times out after d finishes ceil(d / period) ticks later and the next row starts
+ * on the tick after that. Groups take as long as their longest (PARALLEL), shortest (RACE) or first (DEADLINE) command
+ * and graph scripts as long as their longest chain of dependencies. Background rows take no time.
+ * @param script The script
+ * @param commandTimeouts Timeout bound of each command creator (nullptr entries for commands without one)
+ * @param period The time between ticks
+ * @return The analysis
+ */
+ScriptAnalysis analyzeScript(const AutoScript &script, const std::vector<CmdTimeoutBound> &commandTimeouts, AutoTime period);
+
+/**
+ * Check the analysis of a script against a duration limit. Reports why the script is rejected.
+ * @param analysis The analysis of the script
+ * @param script The script
+ * @param fileName The file the script was loaded from (for messages)
+ * @param durationLimit The longest the script may run for (0 to only check that the script is valid)
+ * @return false if the script is not valid, may run forever or may run longer than the limit
+ */
+bool checkScriptAnalysis(const ScriptAnalysis &analysis, const AutoScript &script, const std::string &fileName, AutoTime durationLimit);
+
+}
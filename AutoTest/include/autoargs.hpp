@@ -0,0 +1,193 @@
+/**
+ * autoargs.hpp
+ * Typed argument schemas for autonomous commands.
+ * Commands declare the types of their arguments and the AutoManager parses and validates
+ * each row once when the script is loaded instead of every time the command starts.
+ *
+ * Copyright (c) 2018 FRC Team 2655 - The Flying Platypi
+ * See LICENSE file for details
+ */
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <deque>
+#include <memory>
+#include <charconv>
+#include <type_traits>
+#include <utility>
+
+#include "autoscript.hpp"
+
+namespace team2655{
+
+/**
+ * The argument types of a command. Supported types are int, double, bool and std::string_view
+ * (string_view arguments are views into the script).
+ */
+template<class... Ts>
+struct Args{
+	typedef std::tuple<Ts...> Tuple;
+};
+
+// Parsing of individual arguments
+
+inline bool parseArg(std::string_view text, int &value){
+	auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+	return result.ec == std::errc() && result.ptr == text.data() + text.size();
+}
+
+inline bool parseArg(std::string_view text, double &value){
+	// from_chars does not accept a leading '+'
+	if(!text.empty() && text[0] == '+')
+		text.remove_prefix(1);
+	auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+	return result.ec == std::errc() && result.ptr == text.data() + text.size();
+}
+
+inline bool parseArg(std::string_view text, bool &value){
+	if(text == "1" || text == "true" || text == "TRUE" || text == "True"){
+		value = true;
+		return true;
+	}
+	if(text == "0" || text == "false" || text == "FALSE" || text == "False"){
+		value = false;
+		return true;
+	}
+	return false;
+}
+
+inline bool parseArg(std::string_view text, std::string_view &value){
+	value = text;
+	return true;
+}
+
+template<class T> struct ArgTypeName;
+template<> struct ArgTypeName<int>{ static const char *name(){ return "int"; } };
+template<> struct ArgTypeName<double>{ static const char *name(){ return "double"; } };
+template<> struct ArgTypeName<bool>{ static const char *name(){ return "bool"; } };
+template<> struct ArgTypeName<std::string_view>{ static const char *name(){ return "string"; } };
+
+/**
+ * Parses and stores the arguments of every script row for one command (or background command).
+ */
+class ArgSchema{
+public:
+	/**
+	 * Parse and store the arguments of a row
+	 * @param args The arguments from the script
+	 * @param parsed Set to the parsed values (valid until clear is called)
+	 * @param error Set to a description of the problem if the arguments are not valid
+	 * @return true if the arguments are valid for this schema
+	 */
+	virtual bool parse(const ArgList &args, const void *&parsed, std::string &error) = 0;
+
+	/**
+	 * Release all parsed values
+	 */
+	virtual void clear() = 0;
+
+	/**
+	 * Get the number of arguments the schema expects
+	 */
+	virtual size_t argumentCount() const = 0;
+
+	/**
+	 * Get a readable description of the argument types (ex "double, int")
+	 */
+	virtual std::string signature() const = 0;
+
+	/**
+	 * Create an empty schema of the same type (used to parse a script on another thread)
+	 */
+	virtual std::unique_ptr<ArgSchema> clone() const = 0;
+
+	virtual ~ArgSchema(){}
+};
+
+typedef std::unique_ptr<ArgSchema> ArgSchemaPointer;
+
+/**
+ * Schema for a fixed list of argument types. Parsed rows are stored as tuples.
+ */
+template<class... Ts>
+class TypedArgSchema : public ArgSchema{
+private:
+	typedef std::tuple<Ts...> Tuple;
+
+	std::deque<Tuple> values; // deque so stored tuples never move as more rows are parsed
+
+	template<size_t... Is>
+	static bool parseAll(const ArgList &args, Tuple &tuple, std::string &error, std::index_sequence<Is...>){
+		size_t failed = sizeof...(Ts);
+		bool ok = true;
+		// Parse in order, remembering the first argument that failed
+		((ok = ok && (parseArg(args[Is], std::get<Is>(tuple)) || ((failed = Is), false))), ...);
+		if(!ok){
+			const char *types[] = { ArgTypeName<Ts>::name()..., "" };
+			error = "argument " + std::to_string(failed + 1) + " (\"" + std::string(args[failed]) + "\") is not a valid " + types[failed];
+		}
+		return ok;
+	}
+
+public:
+	bool parse(const ArgList &args, const void *&parsed, std::string &error) override {
+		if(args.size() != sizeof...(Ts)){
+			error = "expected " + std::to_string(sizeof...(Ts)) + " argument(s) (" + signature() + ") but got " + std::to_string(args.size());
+			return false;
+		}
+		Tuple tuple;
+		if(!parseAll(args, tuple, error, std::index_sequence_for<Ts...>()))
+			return false;
+		values.push_back(tuple);
+		parsed = &values.back();
+		return true;
+	}
+
+	void clear() override {
+		values.clear();
+	}
+
+	size_t argumentCount() const override {
+		return sizeof...(Ts);
+	}
+
+	std::string signature() const override {
+		std::string result;
+		const char *types[] = { ArgTypeName<Ts>::name()..., "" };
+		for(size_t i = 0; i < sizeof...(Ts); ++i){
+			if(i > 0)
+				result += ", ";
+			result += types[i];
+		}
+		return result;
+	}
+
+	ArgSchemaPointer clone() const override {
+		return ArgSchemaPointer(new TypedArgSchema<Ts...>());
+	}
+};
+
+/**
+ * Create the schema for a command type.
+ * Commands with an Arguments typedef (TypedAutoCommand, TypedBackgroundAutoCommand) get a TypedArgSchema.
+ * Other commands receive the raw text arguments and have no schema (nullptr).
+ */
+template<class T, class = void>
+struct ArgSchemaFor{
+	static ArgSchemaPointer make(){ return ArgSchemaPointer(nullptr); }
+};
+
+template<class... Ts>
+ArgSchemaPointer makeArgSchema(Args<Ts...>){
+	return ArgSchemaPointer(new TypedArgSchema<Ts...>());
+}
+
+template<class T>
+struct ArgSchemaFor<T, std::void_t<typename T::Arguments>>{
+	static ArgSchemaPointer make(){ return makeArgSchema(typename T::Arguments()); }
+};
+
+}
@@ -0,0 +1,278 @@
+/**
+ * autobatch.hpp
+ * Runs one script for many instances at once, each with its own arguments (ex to compare DRIVE distances
+ * or MOVE_LIFTER targets when planning paths or choosing an auto).
+ * Arguments and command state are stored as arrays with one value per instance (structure of arrays)
+ * so a command processes every instance in one loop the compiler can vectorize.
+ *
+ * Copyright (c) 2018 FRC Team 2655 - The Flying Platypi
+ * See LICENSE file for details
+ */
+
+#pragma once
+
+#include "autoscript.hpp"
+#include "autoclock.hpp"
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <typeindex>
+#include <type_traits>
+#include <cstdint>
+
+namespace team2655{
+
+/**
+ * Arguments of one script row for every instance. Each argument is a column with one value per instance.
+ */
+class BatchArgs{
+private:
+	const double *const *columns = nullptr;
+	size_t count = 0;
+
+public:
+	BatchArgs(){}
+	BatchArgs(const double *const *columns, size_t count) : columns(columns), count(count){}
+
+	size_t size() const { return count; }
+
+	/**
+	 * Get the values of an argument
+	 * @param arg The argument
+	 * @return One value per instance
+	 */
+	const double *operator[](size_t arg) const { return columns[arg]; }
+};
+
+/**
+ * A command that runs for every instance of an AutoBatch at once.
+ * State is kept in arrays with one element per instance. Masks have one byte per instance (1 if selected, else 0)
+ * so loops can go over every instance without branching instead of skipping around.
+ */
+class BatchAutoCommand{
+public:
+	/**
+	 * Get the number of arguments the command takes (all arguments are numbers)
+	 */
+	virtual size_t argumentCount() const = 0;
+
+	/**
+	 * Set up state for a run
+	 * @param count The number of instances
+	 * @param period The simulated time of one tick
+	 */
+	virtual void resize(size_t count, AutoTime period) = 0;
+
+	/**
+	 * Start the command for some instances
+	 * @param commandName The name the command was run with
+	 * @param args The arguments of the row for every instance
+	 * @param starting Mask of the instances starting the command
+	 */
+	virtual void start(std::string_view commandName, const BatchArgs &args, const uint8_t *starting) = 0;
+
+	/**
+	 * Process every instance running the command
+	 * @param running Mask of the instances running the command
+	 * @param finished Or 1 into this for each running instance that finished (do not clear other instances)
+	 */
+	virtual void process(const uint8_t *running, uint8_t *finished) = 0;
+
+	virtual ~BatchAutoCommand(){}
+};
+
+/**
+ * A background command that runs for every instance of an AutoBatch at once (see BatchAutoCommand)
+ */
+class BatchBackgroundCommand{
+public:
+	/**
+	 * Get the number of arguments the command takes (all arguments are numbers)
+	 */
+	virtual size_t argumentCount() const = 0;
+
+	/**
+	 * Set up state for a run
+	 * @param count The number of instances
+	 * @param period The simulated time of one tick
+	 */
+	virtual void resize(size_t count, AutoTime period) = 0;
+
+	/**
+	 * Give some instances the arguments of a script row
+	 * @param commandName The name the command was run with
+	 * @param args The arguments of the row for every instance
+	 * @param updating Mask of the instances that reached the row
+	 */
+	virtual void update(std::string_view commandName, const BatchArgs &args, const uint8_t *updating) = 0;
+
+	/**
+	 * Process every instance (called every tick)
+	 */
+	virtual void process() = 0;
+
+	virtual ~BatchBackgroundCommand(){}
+};
+
+/**
+ * One script run by many instances. Each instance runs the script top to bottom like an AutoManager
+ * driven by an AutoSimulator, but every tick processes all instances command by command.
+ *   batch.registerCommand<BatchDrive>("drive");
+ *   batch.loadScript("auto.csv");
+ *   batch.setInstances(1000);
+ *   double *distance = batch.argument(1, 0); // First argument of the second row
+ *   for(size_t i = 0; i < 1000; ++i) distance[i] = ...;
+ *   batch.run(750);
+ */
+class AutoBatch{
+private:
+	struct BatchRow{
+		bool background;
+		uint32_t command;      // Index into commands or bgCommands
+		uint32_t firstColumn;  // First argument in columns
+		uint32_t argCount;
+	};
+
+	struct Registration{
+		bool background;
+		uint32_t command;
+	};
+
+	static constexpr uint32_t NotFinished = (uint32_t)-1;
+
+	AutoTime period;
+	AutoScript script;
+	std::vector<BatchRow> rows;
+
+	std::vector<std::unique_ptr<BatchAutoCommand>> commands;
+	std::vector<std::unique_ptr<BatchBackgroundCommand>> bgCommands;
+	std::unordered_map<std::string, Registration> registrations;
+	std::unordered_map<std::type_index, uint32_t> commandTypes;   // One command object per type (shared by its names)
+	std::unordered_map<std::type_index, uint32_t> bgCommandTypes;
+
+	// Arguments. One column per argument of every row, one value per instance.
+	size_t instances = 0;
+	std::vector<double> scriptValues;            // Value of each column in the script
+	std::vector<std::vector<double>> columns;
+	std::vector<const double*> columnPointers;
+
+	// Per instance state
+	std::vector<uint32_t> nextRow;        // Next row to run
+	std::vector<uint32_t> runningCommand; // Command running (valid while the instance runs a command)
+	std::vector<uint8_t> advance;         // Move to the next row at the start of the tick
+	std::vector<uint8_t> finished;        // Set by commands that finished this tick
+	std::vector<uint32_t> finishTicks;
+	std::vector<std::vector<uint8_t>> runningMasks; // Per command: instances running it
+	std::vector<size_t> runningCounts;              // Per command: number of instances running it
+	std::vector<uint8_t> mask;                      // Instances starting or updating a row
+	std::vector<std::pair<uint32_t, uint32_t>> reached; // (row, instance) reached this tick
+
+	/**
+	 * Lowercase a name and check it can be registered (reports why not)
+	 */
+	bool checkRegisterName(std::string &name) const;
+
+	/**
+	 * Start / update every row reached this tick (in row order so each instance sees its rows in script order)
+	 */
+	void startReachedRows();
+
+public:
+	/**
+	 * @param period The simulated time of one tick
+	 */
+	AutoBatch(AutoTime period = std::chrono::milliseconds(20)) : period(period){}
+	AutoBatch(const AutoBatch&) = delete;
+	AutoBatch &operator=(const AutoBatch&) = delete;
+
+	/**
+	 * Register a command. Registering a type again adds a name for the same command.
+	 * @param name The name to register the command with
+	 * @return The command (nullptr if the name cannot be used)
+	 */
+	template<class T>
+	T *registerCommand(std::string name){
+		static_assert(std::is_base_of<BatchAutoCommand, T>::value, "Cannot register batch command. Given type is not a valid BatchAutoCommand.");
+		if(!checkRegisterName(name))
+			return nullptr;
+		auto it = commandTypes.find(std::type_index(typeid(T)));
+		uint32_t index;
+		if(it == commandTypes.end()){
+			index = (uint32_t)commands.size();
+			commands.emplace_back(new T());
+			commandTypes[std::type_index(typeid(T))] = index;
+		}else{
+			index = it->second;
+		}
+		registrations[name] = { false, index };
+		return static_cast<T*>(commands[index].get());
+	}
+
+	/**
+	 * Register a background command. Registering a type again adds a name for the same command.
+	 * @param name The name to register the command with
+	 * @return The command (nullptr if the name cannot be used)
+	 */
+	template<class T>
+	T *registerBackgroundCommand(std::string name){
+		static_assert(std::is_base_of<BatchBackgroundCommand, T>::value, "Cannot register batch command. Given type is not a valid BatchBackgroundCommand.");
+		if(!checkRegisterName(name))
+			return nullptr;
+		auto it = bgCommandTypes.find(std::type_index(typeid(T)));
+		uint32_t index;
+		if(it == bgCommandTypes.end()){
+			index = (uint32_t)bgCommands.size();
+			bgCommands.emplace_back(new T());
+			bgCommandTypes[std::type_index(typeid(T))] = index;
+		}else{
+			index = it->second;
+		}
+		registrations[name] = { true, index };
+		return static_cast<T*>(bgCommands[index].get());
+	}
+
+	/**
+	 * Load the script every instance runs (CSV or compiled). Register commands first.
+	 * @param fileName The full path to the script
+	 * @return false if the file cannot be read, a row has no registered command or its arguments are not numbers
+	 */
+	bool loadScript(const std::string &fileName);
+
+	/**
+	 * Set the number of instances. Every argument of every instance is set to the value in the script.
+	 */
+	void setInstances(size_t count);
+
+	size_t instanceCount() const { return instances; }
+	size_t rowCount() const { return rows.size(); }
+
+	/**
+	 * Get the values of an argument for every instance (to change them before a run)
+	 * @param row The script row (0 for the first)
+	 * @param arg The argument of the row
+	 * @return One value per instance (nullptr if the row does not have the argument). Valid until setInstances or loadScript.
+	 */
+	double *argument(size_t row, size_t arg);
+
+	/**
+	 * Run every instance from the first row until all have finished the script
+	 * @param maxTicks Stop after this many ticks even if instances have not finished
+	 * @return The number of ticks run
+	 */
+	size_t run(size_t maxTicks);
+
+	/**
+	 * Did an instance finish the script in the last run
+	 */
+	bool isFinished(size_t instance) const { return finishTicks[instance] != NotFinished; }
+
+	/**
+	 * Get the tick an instance finished the script at in the last run (the number of ticks it had commands left)
+	 */
+	uint32_t finishTick(size_t instance) const { return finishTicks[instance]; }
+};
+
+}
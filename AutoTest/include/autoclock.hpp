@@ -0,0 +1,83 @@
+/**
+ * autoclock.hpp
+ * Time sources for the AutoManager.
+ * The manager samples its clock once per process() call and every command sees that time,
+ * so a tick is consistent and tests can substitute a fake clock.
+ *
+ * Copyright (c) 2018 FRC Team 2655 - The Flying Platypi
+ * See LICENSE file for details
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+namespace team2655{
+
+/**
+ * Time used by the AutoManager and commands (nanoseconds since an arbitrary, clock specific epoch)
+ */
+typedef std::chrono::nanoseconds AutoTime;
+
+class AutoClock{
+public:
+	/**
+	 * Get the current time. Must never go backwards.
+	 * @return The time since the clock's epoch
+	 */
+	virtual AutoTime now() = 0;
+
+	virtual ~AutoClock(){}
+};
+
+/**
+ * Monotonic clock backed by std::chrono::steady_clock. Not affected by changes to the wall clock.
+ */
+class SteadyAutoClock : public AutoClock{
+public:
+	AutoTime now() override {
+		return std::chrono::duration_cast<AutoTime>(std::chrono::steady_clock::now().time_since_epoch());
+	}
+
+	/**
+	 * Get a shared instance (the default clock of every AutoManager)
+	 */
+	static SteadyAutoClock &instance(){
+		static SteadyAutoClock clock;
+		return clock;
+	}
+};
+
+/**
+ * Clock that only moves when told to. For deterministic tests and simulation.
+ */
+class FakeAutoClock : public AutoClock{
+private:
+	AutoTime current;
+
+public:
+	FakeAutoClock(AutoTime start = AutoTime(0)) : current(start){}
+
+	AutoTime now() override {
+		return current;
+	}
+
+	/**
+	 * Move the clock forward
+	 * @param amount How far to move the clock
+	 */
+	void advance(AutoTime amount){
+		current += amount;
+	}
+
+	/**
+	 * Set the clock to a time
+	 * @param time The new time
+	 */
+	void set(AutoTime time){
+		current = time;
+	}
+};
+
+}
@@ -0,0 +1,286 @@
+/**
+ * autocoroutine.hpp
+ * Commands written as C++20 coroutines. Only available when compiling as C++20 (the library itself is C++17).
+ *
+ * A CoroutineAutoCommand implements run() instead of start / process. The AutoManager resumes the coroutine
+ * each tick it is not waiting and completes the command when run() returns:
+ *
+ *   class DriveCommand : public CoroutineAutoCommand<double>{
+ *       AutoTask run(double seconds) override {
+ *           setTimeout(AutoTime(std::chrono::seconds(5)));
+ *           co_await until([this](){ return gyroReady(); });
+ *           co_await sleepFor(std::chrono::duration_cast<AutoTime>(std::chrono::duration<double>(seconds)));
+ *           co_await turn(90);   // Another AutoTask (a sub-command)
+ *       }
+ *   };
+ *
+ * Coroutine frames come from the FramePool of the AutoManager running the command, so once a command
+ * has run a few times starting and resuming it does not allocate.
+ *
+ * Copyright (c) 2018 FRC Team 2655 - The Flying Platypi
+ * See LICENSE file for details
+ */
+
+#pragma once
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+
+#define AUTOHELPER_HAS_COROUTINES 1
+
+#include "autonomous.hpp"
+#include "autoframes.hpp"
+
+#include <coroutine>
+#include <exception>
+#include <utility>
+#include <tuple>
+
+namespace team2655{
+
+class CoroutineCommandBase;
+class SleepAwaiter;
+template<class Condition> class UntilAwaiter;
+
+/**
+ * Coroutine returned by CoroutineAutoCommand::run and by the sub-commands it awaits.
+ * Starts suspended. Destroys its frame when destroyed.
+ */
+class AutoTask{
+public:
+	struct promise_type;
+	typedef std::coroutine_handle<promise_type> Handle;
+
+	struct FinalAwaiter{
+		bool await_ready() noexcept { return false; }
+		std::coroutine_handle<> await_suspend(Handle handle) noexcept;
+		void await_resume() noexcept {  }
+	};
+
+	struct promise_type{
+		CoroutineCommandBase *command = nullptr; // The command running the task
+		std::coroutine_handle<> continuation;    // Task awaiting this one (none for run())
+
+		AutoTask get_return_object(){ return AutoTask(Handle::from_promise(*this)); }
+		std::suspend_always initial_suspend() noexcept { return {}; }
+		FinalAwaiter final_suspend() noexcept { return {}; }
+		void return_void() {  }
+		void unhandled_exception() { std::terminate(); }
+
+		static void *operator new(size_t size){ return FramePool::allocateFrame(size); }
+		static void operator delete(void *frame){ FramePool::deallocateFrame(frame); }
+	};
+
+private:
+	Handle handle;
+
+public:
+	AutoTask(){}
+	explicit AutoTask(Handle handle) : handle(handle){}
+	AutoTask(AutoTask &&other) noexcept : handle(std::exchange(other.handle, nullptr)){}
+	AutoTask &operator=(AutoTask &&other) noexcept {
+		if(this != &other){
+			reset();
+			handle = std::exchange(other.handle, nullptr);
+		}
+		return *this;
+	}
+	AutoTask(const AutoTask&) = delete;
+	AutoTask &operator=(const AutoTask&) = delete;
+	~AutoTask(){ reset(); }
+
+	/**
+	 * Destroy the coroutine (if any) wherever it is suspended
+	 */
+	void reset(){
+		if(handle){
+			handle.destroy();
+			handle = nullptr;
+		}
+	}
+
+	bool valid() const { return (bool)handle; }
+	bool done() const { return !handle || handle.done(); }
+	Handle getHandle() const { return handle; }
+
+	// Awaiting a task runs it as a sub-command until it returns
+	bool await_ready() const noexcept { return done(); }
+	template<class Promise>
+	std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> parent) noexcept;
+	void await_resume() const noexcept {  }
+};
+
+/**
+ * Condition an awaiting task is waiting for (checked once per tick)
+ */
+class AutoCondition{
+public:
+	virtual bool ready() = 0;
+protected:
+	~AutoCondition(){}
+};
+
+/**
+ * Part of CoroutineAutoCommand that does not depend on the argument types
+ */
+class CoroutineCommandBase : public AutoCommand{
+private:
+	friend class AutoTask;
+	template<class> friend class UntilAwaiter;
+	friend class SleepAwaiter;
+
+	AutoTask task;                              // The run() coroutine
+	std::coroutine_handle<> current;            // Innermost suspended task (run() or a sub-command it awaits)
+	AutoCondition *waitingOn = nullptr;         // Condition the current task waits for (lives in its frame)
+
+	void resumeTask(){
+		current.resume();
+		if(task.done() && !isComplete())
+			complete();
+	}
+
+protected:
+	/**
+	 * Set the coroutine to run (called by CoroutineAutoCommand::start)
+	 */
+	void beginTask(AutoTask newTask){
+		task = std::move(newTask);
+		task.getHandle().promise().command = this;
+		current = task.getHandle();
+		waitingOn = nullptr;
+	}
+
+	/**
+	 * Awaitable that suspends the task until the tick at or after a time (or a wake() or the timeout).
+	 * The AutoManager does not process the command at all while it sleeps.
+	 */
+	SleepAwaiter sleepUntil(AutoTime deadline);
+
+	/**
+	 * Awaitable that suspends the task for a while (see sleepUntil)
+	 */
+	SleepAwaiter sleepFor(AutoTime duration);
+
+	/**
+	 * Awaitable that suspends the task until wake() is called (or the command times out)
+	 */
+	SleepAwaiter sleep();
+
+	/**
+	 * Awaitable that suspends the task until the next tick
+	 */
+	std::suspend_always nextTick(){ return {}; }
+
+	/**
+	 * Awaitable that suspends the task until a condition is true. The condition is checked once per tick.
+	 * @param condition Callable returning bool
+	 */
+	template<class Condition>
+	UntilAwaiter<Condition> until(Condition condition);
+
+public:
+	void process() override {
+		if(waitingOn != nullptr){
+			if(!waitingOn->ready())
+				return;
+			waitingOn = nullptr;
+		}
+		if(current && !task.done())
+			resumeTask();
+	}
+
+	void handleComplete() override {  }
+
+	/**
+	 * Destroys the coroutine (running the destructors of its locals). Commands overriding this must call it.
+	 */
+	void reset() override {
+		waitingOn = nullptr;
+		current = nullptr;
+		task.reset();
+	}
+};
+
+class SleepAwaiter{
+private:
+	AutoTime deadline;
+public:
+	explicit SleepAwaiter(AutoTime deadline) : deadline(deadline){}
+	bool await_ready() const noexcept { return false; }
+	template<class Promise>
+	bool await_suspend(std::coroutine_handle<Promise> handle){
+		CoroutineCommandBase *command = handle.promise().command;
+		command->AutoCommand::sleepUntil(deadline);
+		return command->isSleeping(); // A pending wake() continues right away
+	}
+	void await_resume() const noexcept {  }
+};
+
+template<class Condition>
+class UntilAwaiter : public AutoCondition{
+private:
+	Condition condition;
+public:
+	explicit UntilAwaiter(Condition condition) : condition(std::move(condition)){}
+	bool ready() override { return (bool)condition(); }
+	bool await_ready(){ return ready(); }
+	template<class Promise>
+	void await_suspend(std::coroutine_handle<Promise> handle){ handle.promise().command->waitingOn = this; }
+	void await_resume() const noexcept {  }
+};
+
+inline SleepAwaiter CoroutineCommandBase::sleepUntil(AutoTime deadline){ return SleepAwaiter(deadline); }
+inline SleepAwaiter CoroutineCommandBase::sleepFor(AutoTime duration){ return SleepAwaiter(now() + duration); }
+inline SleepAwaiter CoroutineCommandBase::sleep(){ return SleepAwaiter(AutoTime::max()); }
+
+template<class Condition>
+UntilAwaiter<Condition> CoroutineCommandBase::until(Condition condition){
+	return UntilAwaiter<Condition>(std::move(condition));
+}
+
+inline std::coroutine_handle<> AutoTask::FinalAwaiter::await_suspend(Handle handle) noexcept {
+	promise_type &promise = handle.promise();
+	if(!promise.continuation)
+		return std::noop_coroutine(); // run() finished. CoroutineCommandBase completes the command.
+	promise.command->current = promise.continuation;
+	return promise.continuation;
+}
+
+template<class Promise>
+std::coroutine_handle<> AutoTask::await_suspend(std::coroutine_handle<Promise> parent) noexcept {
+	promise_type &promise = handle.promise();
+	promise.command = parent.promise().command;
+	promise.continuation = parent;
+	promise.command->current = handle;
+	return handle; // Run the sub-command now, in the same tick
+}
+
+/**
+ * An AutoCommand written as a coroutine with typed arguments (see TypedAutoCommand).
+ * Timeouts and killAuto complete the command without resuming it. Its frame is destroyed when the command is reset.
+ * Register with AutoManager::registerCommand<T>.
+ */
+template<class... Ts>
+class CoroutineAutoCommand : public CoroutineCommandBase{
+public:
+	typedef Args<Ts...> Arguments;
+
+	/**
+	 * The command. Runs until the first co_await when the command starts.
+	 * The arguments are copied into the coroutine so they can be used after suspending.
+	 */
+	virtual AutoTask run(Ts... args) = 0;
+
+	void start(std::string_view commandName, const ArgList &args) override final {
+		if(args.parsed() == nullptr){
+			std::cerr << "WARNING: Command \"" << commandName << "\" has no parsed arguments. Register it with registerCommand<T>." << std::endl;
+			complete();
+			return;
+		}
+		beginTask(std::apply([this](const Ts&... values){ return run(values...); },
+				*static_cast<const std::tuple<Ts...>*>(args.parsed())));
+	}
+};
+
+}
+
+#endif
@@ -0,0 +1,102 @@
+/**
+ * autoexecutor.hpp
+ * Runs many AutoManagers in parallel on a work stealing thread pool
+ *
+ * Copyright (c) 2018 FRC Team 2655 - The Flying Platypi
+ * See LICENSE file for details
+ */
+
+#pragma once
+
+#include "autonomous.hpp"
+#include "autothreads.hpp"
+
+#include <vector>
+#include <memory>
+
+namespace team2655{
+
+/**
+ * Owns a set of AutoManagers and processes them on a thread pool.
+ * A manager is only ever processed by one thread at a time and its ticks always run in order.
+ */
+class AutoExecutor{
+private:
+	// One manager and the state of its self scheduling task (free running mode)
+	struct Slot{
+		AutoExecutor *executor;
+		AutoManager *manager;
+		bool running;
+		void operator()();
+	};
+
+	// A batch of managers processed by one task (barrier mode)
+	struct Batch{
+		AutoExecutor *executor;
+		size_t first;
+		size_t last;
+		void operator()();
+	};
+
+	WorkStealingPool pool;
+	std::vector<std::unique_ptr<AutoManager>> managers;
+	std::vector<Slot> slots;
+	std::vector<Batch> batches;
+	std::vector<char> stillRunning; // Result of each manager's last process() (barrier mode)
+	AutoClock *clock = &SteadyAutoClock::instance();
+	AutoTime tickTime{0};
+	TaskGroup freeRunning;
+
+	void buildBatches();
+
+public:
+	/**
+	 * @param threadCount Number of worker threads (0 for one per hardware thread)
+	 */
+	AutoExecutor(size_t threadCount = 0);
+
+	/**
+	 * Add a manager to the executor. Managers cannot be added while running.
+	 * @param manager The manager (the executor takes ownership)
+	 * @return The added manager
+	 */
+	AutoManager &add(std::unique_ptr<AutoManager> manager);
+
+	/**
+	 * Get a manager
+	 * @param index The index of the manager (in the order they were added)
+	 */
+	AutoManager &get(size_t index){ return *managers[index]; }
+
+	/**
+	 * Get the number of managers
+	 */
+	size_t size() const { return managers.size(); }
+
+	/**
+	 * Set the clock sampled once per tick in barrier mode (steady_clock by default)
+	 * @param clock The clock. Must outlive the executor. nullptr restores the default clock.
+	 */
+	void setClock(AutoClock *clock);
+
+	/**
+	 * Barrier mode. Process every manager once with the same tick time and wait for all of them.
+	 * @return The number of managers that still have commands to run
+	 */
+	size_t tick();
+
+	/**
+	 * Barrier mode. Process every manager once at the given time and wait for all of them.
+	 * @param now The time every manager observes for this tick
+	 * @return The number of managers that still have commands to run
+	 */
+	size_t tick(AutoTime now);
+
+	/**
+	 * Free running mode. Each manager is processed over and over (using its own clock) as fast as the
+	 * pool allows, independent of the others, until its script is done. Blocks until all managers are done.
+	 */
+	void runFreeRunning();
+};
+
+}
@@ -0,0 +1,128 @@
+/**
+ * autoframes.hpp
+ * Pool for coroutine frames of CoroutineAutoCommands (see autocoroutine.hpp)
+ *
+ * Copyright (c) 2018 FRC Team 2655 - The Flying Platypi
+ * See LICENSE file for details
+ */
+
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <new>
+
+namespace team2655{
+
+/**
+ * Free lists of fixed size classes carved from large chunks. Freed frames are kept for the next frame of
+ * (about) the same size so starting the same commands again does not allocate.
+ * Each AutoManager owns one and makes it current while it starts and processes commands.
+ * Not thread safe (only the thread processing the manager uses it).
+ */
+class FramePool{
+private:
+	static constexpr size_t Granularity = 64;
+	static constexpr size_t MaxPooledSize = 4096; // Larger frames come from operator new
+	static constexpr size_t ClassCount = MaxPooledSize / Granularity;
+	static constexpr size_t ChunkSize = 16384;
+
+	// Stored in front of every frame so it can be freed without knowing the current pool
+	struct alignas(alignof(std::max_align_t)) Header{
+		FramePool *pool;
+		size_t sizeClass;
+	};
+
+	struct FreeFrame{
+		FreeFrame *next;
+	};
+
+	FreeFrame *freeLists[ClassCount] = {};
+	std::vector<std::unique_ptr<char[]>> chunks;
+	char *chunkPos = nullptr;
+	char *chunkEnd = nullptr;
+
+	static FramePool *&current(){
+		static thread_local FramePool *pool = nullptr;
+		return pool;
+	}
+
+	void *take(size_t sizeClass){
+		FreeFrame *frame = freeLists[sizeClass];
+		if(frame != nullptr){
+			freeLists[sizeClass] = frame->next;
+			return frame;
+		}
+		size_t bytes = (sizeClass + 1) * Granularity;
+		if(chunkPos == nullptr || (size_t)(chunkEnd - chunkPos) < bytes){
+			chunks.emplace_back(new char[ChunkSize]); // new[] is aligned for any fundamental type
+			chunkPos = chunks.back().get();
+			chunkEnd = chunkPos + ChunkSize;
+		}
+		void *memory = chunkPos;
+		chunkPos += bytes;
+		return memory;
+	}
+
+public:
+	FramePool(){}
+	FramePool(const FramePool&) = delete;
+	FramePool &operator=(const FramePool&) = delete;
+
+	/**
+	 * Makes a pool current on this thread while it exists
+	 */
+	class Scope{
+	private:
+		FramePool *previous;
+	public:
+		explicit Scope(FramePool &pool) : previous(current()){ current() = &pool; }
+		~Scope(){ current() = previous; }
+		Scope(const Scope&) = delete;
+		Scope &operator=(const Scope&) = delete;
+	};
+
+	/**
+	 * Allocate a coroutine frame from the current pool (or operator new if there is none or the frame is large)
+	 */
+	static void *allocateFrame(size_t size){
+		FramePool *pool = current();
+		size_t total = size + sizeof(Header);
+		Header *header;
+		if(pool != nullptr && total <= MaxPooledSize){
+			size_t sizeClass = (total - 1) / Granularity;
+			header = static_cast<Header*>(pool->take(sizeClass));
+			header->pool = pool;
+			header->sizeClass = sizeClass;
+		}else{
+			header = static_cast<Header*>(::operator new(total));
+			header->pool = nullptr;
+			header->sizeClass = 0;
+		}
+		return header + 1;
+	}
+
+	/**
+	 * Free a frame from allocateFrame (returns it to the pool it came from)
+	 */
+	static void deallocateFrame(void *frame){
+		Header *header = static_cast<Header*>(frame) - 1;
+		FramePool *pool = header->pool;
+		if(pool == nullptr){
+			::operator delete(header);
+			return;
+		}
+		FreeFrame *free = reinterpret_cast<FreeFrame*>(header);
+		size_t sizeClass = header->sizeClass;
+		free->next = pool->freeLists[sizeClass];
+		pool->freeLists[sizeClass] = free;
+	}
+
+	/**
+	 * Get the number of bytes held by the pool
+	 */
+	size_t capacity() const { return chunks.size() * ChunkSize; }
+};
+
+}
@@ -0,0 +1,245 @@
+/**
+ * autoloader.hpp
+ * Loading scripts on a background thread so they can be switched to without the control loop touching the disk
+ *
+ * Copyright (c) 2018 FRC Team 2655 - The Flying Platypi
+ * See LICENSE file for details
+ */
+
+#pragma once
+
+#include "autoscript.hpp"
+#include "autoargs.hpp"
+#include "autoanalysis.hpp"
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <cstdint>
+
+namespace team2655{
+
+/**
+ * Is a field an id= or after= annotation (any case)
+ */
+bool isRowAnnotation(std::string_view field);
+
+/**
+ * Move the id= / after= fields at the end of a row's arguments out of its arguments
+ * (restoring any that were split off by an earlier resolve first)
+ * @return true if the row has annotations
+ */
+bool splitRowAnnotations(ScriptRow &row);
+
+/**
+ * Build the dependency graph of a script from its id= / after= annotations (call after splitRowAnnotations).
+ * Duplicate ids, unknown dependencies, groups and cycles are reported and their rows marked Invalid.
+ * @param script The script (its graph is replaced)
+ * @return false if the graph is not valid
+ */
+bool buildScriptGraph(AutoScript &script);
+
+/**
+ * Resolve the opcode of every row of a script and parse the arguments of rows whose command has a schema.
+ * The schemas are cleared first. Rows with invalid arguments and group markers that are nested, unmatched
+ * or never closed are reported and marked Invalid. Scripts with id= / after= annotations get a dependency graph.
+ * @param script The script to resolve
+ * @param lookup Callable giving the AutoOpcode for a (lowercase) command name
+ * @param commandSchemas Schema for each command creator (nullptr entries for raw text arguments)
+ * @param bgCommandSchemas Schema for each background command (nullptr entries for raw text arguments)
+ * @return false if any row has invalid arguments
+ */
+template<class Lookup>
+bool resolveScriptRows(AutoScript &script, const Lookup &lookup,
+		std::vector<ArgSchemaPointer> &commandSchemas, std::vector<ArgSchemaPointer> &bgCommandSchemas){
+	// Typed arguments are parsed again from scratch
+	for(auto &schema : commandSchemas){
+		if(schema)
+			schema->clear();
+	}
+	for(auto &schema : bgCommandSchemas){
+		if(schema)
+			schema->clear();
+	}
+
+	bool annotated = false;
+	for(size_t i = 0; i < script.size(); ++i){
+		annotated = splitRowAnnotations(script.row(i)) || annotated;
+	}
+
+	// Resolve each distinct name once then give each row the opcode of its name
+	std::vector<AutoOpcode> nameOpcodes(script.nameCount());
+	for(size_t i = 0; i < script.nameCount(); ++i){
+		nameOpcodes[i] = AutoOpcode::builtin(script.name((uint32_t)i));
+		if(nameOpcodes[i].kind == AutoOpcode::Unknown)
+			nameOpcodes[i] = lookup(script.name((uint32_t)i));
+	}
+
+	bool valid = true;
+	std::string error;
+	size_t openGroup = script.size(); // Row of the group being read (script.size() if none)
+	for(size_t i = 0; i < script.size(); ++i){
+		ScriptRow &row = script.row(i);
+		row.opcode = nameOpcodes[row.nameId];
+		row.parsed = nullptr;
+
+		if(row.opcode.kind == AutoOpcode::GroupBegin || row.opcode.kind == AutoOpcode::GroupEnd){
+			const char *problem = nullptr;
+			if(row.opcode.kind == AutoOpcode::GroupBegin && openGroup != script.size())
+				problem = "groups cannot be nested";
+			else if(row.opcode.kind == AutoOpcode::GroupEnd && openGroup == script.size())
+				problem = "no group to end";
+			else if(row.opcode.kind == AutoOpcode::GroupEnd && script.row(openGroup).opcode.index != row.opcode.index)
+				problem = "does not match the group it ends";
+
+			if(problem != nullptr){
+				std::cerr << "Script row " << (i + 1) << " (\"" << script.name(row.nameId) << "\"): " << problem << std::endl;
+				row.opcode.kind = AutoOpcode::Invalid;
+				valid = false;
+			}else{
+				openGroup = (row.opcode.kind == AutoOpcode::GroupBegin) ? i : script.size();
+			}
+			continue;
+		}
+
+		ArgSchema *schema = nullptr;
+		if(row.opcode.kind == AutoOpcode::Command)
+			schema = commandSchemas[row.opcode.index].get();
+		else if(row.opcode.kind == AutoOpcode::Background)
+			schema = bgCommandSchemas[row.opcode.index].get();
+
+		if(schema != nullptr && !schema->parse(row.arguments(), row.parsed, error)){
+			std::cerr << "Script row " << (i + 1) << " (\"" << script.name(row.nameId) << "\"): " << error << std::endl;
+			row.opcode.kind = AutoOpcode::Invalid;
+			valid = false;
+		}
+	}
+
+	if(openGroup != script.size()){
+		ScriptRow &row = script.row(openGroup);
+		std::cerr << "Script row " << (openGroup + 1) << " (\"" << script.name(row.nameId) << "\"): group is never ended" << std::endl;
+		row.opcode.kind = AutoOpcode::Invalid;
+		valid = false;
+	}
+
+	script.graph().clear();
+	if(annotated)
+		valid = buildScriptGraph(script) && valid;
+	return valid;
+}
+
+/**
+ * Copy of an AutoManager's registrations taken on the control thread.
+ * Background loads resolve against this so they never read the manager.
+ */
+struct ScriptResolver{
+	std::unordered_map<std::string, AutoOpcode> opcodes;
+	std::vector<ArgSchemaPointer> commandSchemas;    // Empty clones of the manager's schemas
+	std::vector<ArgSchemaPointer> bgCommandSchemas;
+	std::vector<CmdTimeoutBound> commandTimeouts;
+	AutoTime durationLimit{0};  // See AutoManager::setDurationLimit
+	AutoTime tickPeriod{0};
+	uint64_t registrationVersion = 0;
+
+	AutoOpcode operator()(std::string_view name) const;
+};
+
+/**
+ * A script loaded and resolved off the control thread.
+ * Owns the schemas holding its parsed arguments. Not changed once it is done loading.
+ */
+struct PreparedScript{
+	std::string fileName;
+	AutoScript script;
+	std::vector<ArgSchemaPointer> commandSchemas;
+	std::vector<ArgSchemaPointer> bgCommandSchemas;
+	uint64_t registrationVersion = 0; // Registrations the rows were resolved against
+	bool valid = false;               // Loaded, every row can run and the script is within the duration limit
+};
+
+typedef std::shared_ptr<PreparedScript> PreparedScriptPointer;
+
+/**
+ * Loads scripts on its own thread. Also destroys scripts that were replaced so freeing them
+ * (and unmapping compiled scripts) does not happen on the control thread either.
+ */
+class ScriptLoader{
+public:
+	enum class Status{
+		NotRequested,
+		Loading,
+		Ready,
+		Failed
+	};
+
+private:
+	struct Job{
+		std::string fileName;                            // Script to load (empty for retire jobs)
+		std::shared_ptr<const ScriptResolver> resolver;
+		PreparedScriptPointer retired;                   // Script to destroy
+	};
+
+	// Scripts replaced by a tick wait here for the loader thread (see retireFromTick).
+	// The control thread only writes retireHead and the loader only writes retireTail.
+	static constexpr size_t RetireSlots = 4;
+	static constexpr std::chrono::milliseconds RetireCheckPeriod{100}; // A wake can be missed without the mutex
+	PreparedScriptPointer retiredSlots[RetireSlots];
+	std::atomic<size_t> retireHead{0};
+	std::atomic<size_t> retireTail{0};
+
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::deque<Job> jobs;
+	std::unordered_map<std::string, PreparedScriptPointer> scripts; // Finished loads
+	std::unordered_map<std::string, size_t> loading;                // Requested loads not finished yet
+	bool stopping = false;
+	std::thread worker;
+
+	void run();
+	bool retiredPending();
+	void drainRetired();
+	PreparedScriptPointer prepare(const std::string &fileName, const ScriptResolver &resolver);
+
+public:
+	ScriptLoader();
+	~ScriptLoader();
+
+	/**
+	 * Queue a script to be loaded and resolved. Replaces an earlier load of the same file once it finishes.
+	 * @param fileName The full path to the script (CSV or compiled)
+	 * @param resolver Registrations to resolve the script against
+	 */
+	void load(const std::string &fileName, std::shared_ptr<const ScriptResolver> resolver);
+
+	/**
+	 * Get the state of a script. Never waits for a load.
+	 */
+	Status status(const std::string &fileName);
+
+	/**
+	 * Take a finished script (it is removed from the loader). Never waits for a load.
+	 * @return The script (nullptr if it is not Ready)
+	 */
+	PreparedScriptPointer take(const std::string &fileName);
+
+	/**
+	 * Destroy a script on the loader thread
+	 */
+	void retire(PreparedScriptPointer script);
+
+	/**
+	 * Destroy a script on the loader thread without locking or allocating (for the thread calling AutoManager::process).
+	 * Only one thread may call this. Falls back to retire if the loader is several scripts behind.
+	 */
+	void retireFromTick(PreparedScriptPointer script);
+};
+
+}
@@ -14,29 +14,89 @@
 
 #include <iostream>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <memory>
 #include <unordered_map>
 #include <functional>
 #include <algorithm>
+#include <cstdint>
+#include <atomic>
+#include <typeindex>
+#include <new>
+
+#include "autoscript.hpp"
+#include "autoargs.hpp"
+#include "autoclock.hpp"
+#include "autothreads.hpp"
+#include "autoprofiler.hpp"
+#include "autoloader.hpp"
+#include "autoanalysis.hpp"
+#include "autoframes.hpp"
+#include "autoqueue.hpp"
+#include "autotelemetry.hpp"
+#include "autosnapshot.hpp"
 
 namespace team2655{
 
+template<class... Commands>
+class StaticAutoManager;
+
+template<class T>
+class TypedBgCommandStore;
 
 class AutoCommand{
+private:
+	friend class AutoManager;
+	template<class... Commands> friend class StaticAutoManager;
+
+	// Sleep state. The AutoManager does not process a sleeping command until wakeTime, its timeout or wake().
+	bool sleeping = false;
+	AutoTime wakeTime = AutoTime::max();
+	std::atomic<bool> wakeRequested{false};
+
+	// State changes of doStart and doReset (without calling start / reset)
+	void setStarted(std::string_view commandName, const ArgList &args, AutoTime now);
+	void clearState();
+
 protected:
 	bool _hasStarted = false;
 	bool _isComplete = false;
-	int timeout = 0;
-	int64_t startTime = 0;
-	std::string commandName;
-	std::vector<std::string> arguments;
+	AutoTime timeout{0};
+	AutoTime startTime{0};
+	AutoTime tickTime{0}; // Time of the current tick (sampled once per tick by the AutoManager)
+	std::string_view commandName;
+	ArgList arguments;
+
+	/**
+	 * Stop processing this command until a time or until wake is called. The timeout still completes the command.
+	 * Does nothing if wake was called since the command last slept (so a wake is never lost).
+	 * @param deadline The time (see now()) to wake at
+	 */
+	void sleepUntil(AutoTime deadline);
+
+	/**
+	 * Stop processing this command for a while (see sleepUntil)
+	 * @param duration How long to sleep for
+	 */
+	void sleepFor(AutoTime duration){ sleepUntil(tickTime + duration); }
+
+	/**
+	 * Stop processing this command until wake is called (or it times out)
+	 */
+	void sleep(){ sleepUntil(AutoTime::max()); }
 
 	/**
-	 * Get the current time as milliseconds from the epoch
-	 * @return Number of milliseconds since the epoch
+	 * Get the time of the current tick. All commands processed in a tick see the same time.
+	 * @return The time from the AutoManager's clock
 	 */
-	static int64_t currentTimeMillis();
+	AutoTime now() const { return tickTime; }
+
+	/**
+	 * Get how long the command has been running
+	 * @return The time since the command started
+	 */
+	AutoTime elapsed() const { return tickTime - startTime; }
 
 	/**
 	 * Check if the command has timed out
@@ -48,20 +108,38 @@ public:
 
 	/**
 	 * Start the command
+	 * @param commandName The name the command was run with (lowercase, whatever case the script wrote it in)
 	 * @param args THe arguments provided for the command
+	 * @param now The time of the current tick
 	 */
-	void doStart(std::string commandName, std::vector<std::string> args);
+	void doStart(std::string_view commandName, const ArgList &args, AutoTime now);
 
 	/**
 	 * Periodic actions for the command
+	 * @param now The time of the current tick
 	 */
-	void doProcess();
+	void doProcess(AutoTime now);
+
+	/**
+	 * Reset the command so it can be started again. The AutoManager resets finished commands and reuses them.
+	 */
+	void doReset();
 
 	/**
 	 * Complete / finish the command
 	 */
 	void complete();
 
+	/**
+	 * Process the command again from the next tick. Can be called from any thread.
+	 */
+	void wake();
+
+	/**
+	 * Is the command sleeping (see sleepUntil)
+	 */
+	bool isSleeping() const { return sleeping; }
+
 	/**
 	 * Has the command been started (init called)
 	 * @return true if started, false if not
@@ -80,17 +158,30 @@ public:
 	 */
 	void setTimeout(int timeoutMs);
 
+	/**
+	 * Set the timeout for this command
+	 * @param timeout The timeout (0 for no timeout)
+	 */
+	void setTimeout(AutoTime timeout);
+
 	/**
 	 * Get the timeout for this command
 	 * @return The timeout for this command in milliseconds
 	 */
 	int getTimeout();
 
+	/**
+	 * Get the timeout for this command
+	 * @return The timeout for this command (0 for no timeout)
+	 */
+	AutoTime getTimeoutDuration();
+
 	/**
 	 * Handle when the command starts
+	 * @param commandName The name the command was run with (lowercase, whatever case the script wrote it in)
 	 * @param args The arguments provided for the command
 	 */
-	virtual void start(std::string commandName, std::vector<std::string> args) = 0;
+	virtual void start(std::string_view commandName, const ArgList &args) = 0;
 
 	/**
 	 * Handle periodic functions for the command
@@ -102,30 +193,244 @@ public:
 	 */
 	virtual void handleComplete() = 0;
 
+	/**
+	 * Handle the command being reset for reuse. Commands that keep their own state between start and complete should clear it here.
+	 */
+	virtual void reset() {  }
+
+	/**
+	 * Save state the command keeps itself (ex the distance driven so far) in a snapshot (see AutoManager::saveSnapshot).
+	 * The manager already saves the command's row, elapsed time, timeout and sleep state. Called every tick when
+	 * snapshots are saved so it should not allocate.
+	 * @param out Where to write the state
+	 */
+	virtual void saveState(SnapshotWriter &/*out*/) {  }
+
+	/**
+	 * Restore state written by saveState when a snapshot is restored. Called after start (with the row's arguments).
+	 * @param in The state written by saveState
+	 * @return false if the state cannot be used (the snapshot is not restored)
+	 */
+	virtual bool restoreState(SnapshotReader &/*in*/) { return true; }
+
 	virtual ~AutoCommand() {  }
 };
 
 class BackgroundAutoCommand{
+private:
+	friend class AutoManager;
+	template<class... Commands> friend class StaticAutoManager;
+	template<class T> friend class TypedBgCommandStore;
+
+	// Sleep state. A sleeping command is not checked or processed at all until wakeTime, wake() or new arguments.
+	bool sleeping = false;
+	AutoTime wakeTime = AutoTime::max();
+	uint32_t sleepGeneration = 0; // Changes on every wake so the AutoManager can ignore deadlines from older sleeps
+	std::atomic<bool> wakeRequested{false};
+	std::atomic<bool> *wakeSignal = nullptr; // Set by the AutoManager so a wake from another thread is noticed
+
+protected:
+	AutoTime tickTime{0}; // Time of the current tick (sampled once per tick by the AutoManager)
+
+	/**
+	 * Get the time of the current tick. All commands processed in a tick see the same time.
+	 * @return The time from the AutoManager's clock
+	 */
+	AutoTime now() const { return tickTime; }
+
+	/**
+	 * Stop checking and processing this command until a time, until wake is called or until the script updates its arguments.
+	 * Idle commands should sleep so they cost nothing per tick.
+	 * Does nothing if wake was called since the command last slept (so a wake is never lost).
+	 * @param deadline The time (see now()) to wake at
+	 */
+	void sleepUntil(AutoTime deadline);
+
+	/**
+	 * Stop processing this command for a while (see sleepUntil)
+	 * @param duration How long to sleep for
+	 */
+	void sleepFor(AutoTime duration){ sleepUntil(tickTime + duration); }
+
+	/**
+	 * Stop processing this command until wake is called or the script updates its arguments
+	 */
+	void sleep(){ sleepUntil(AutoTime::max()); }
+
 public:
-	void doUpdateArgs(std::string commandName, std::vector<std::string> args);
-	virtual void updateArgs(std::string commandName, std::vector<std::string> args) = 0;
+	/**
+	 * Process the command again from the next tick. Can be called from any thread.
+	 */
+	void wake();
+
+	/**
+	 * Is the command sleeping (see sleepUntil)
+	 */
+	bool isSleeping() const { return sleeping; }
+
+	void doUpdateArgs(std::string_view commandName, const ArgList &args, AutoTime now);
+	void doProcess(AutoTime now);
+	virtual void updateArgs(std::string_view commandName, const ArgList &args) = 0;
 	virtual void process() = 0;
 	virtual void kill() = 0;
 	virtual bool shouldProcess() = 0;
 
+	/**
+	 * Can this command be processed on another thread at the same time as other background commands.
+	 * Only used if the AutoManager has a thread pool.
+	 * @return true if shouldProcess and process do not touch state shared with other commands
+	 */
+	virtual bool isParallelSafe() { return false; }
+
+	/**
+	 * Background commands that must be processed before this one each tick
+	 * @return Registered names of the commands (any name the command is registered with)
+	 */
+	virtual std::vector<std::string> runAfter() { return {}; }
+
+	/**
+	 * Save state the command keeps itself in a snapshot (see AutoCommand::saveState).
+	 * The manager already saves the row the arguments came from and the sleep state.
+	 * @param out Where to write the state
+	 */
+	virtual void saveState(SnapshotWriter &/*out*/) {  }
+
+	/**
+	 * Restore state written by saveState when a snapshot is restored. Called after updateArgs (with the arguments it last had).
+	 * @param in The state written by saveState
+	 * @return false if the state cannot be used (the snapshot is not restored)
+	 */
+	virtual bool restoreState(SnapshotReader &/*in*/) { return true; }
+
 	virtual ~BackgroundAutoCommand(){}
 };
 
+/**
+ * An AutoCommand with typed arguments.
+ * The arguments are parsed and validated when the script is loaded (rows with invalid arguments fail the load)
+ * so start receives the values instead of text. Register with AutoManager::registerCommand<T>.
+ */
+template<class... Ts>
+class TypedAutoCommand : public AutoCommand{
+public:
+	typedef Args<Ts...> Arguments;
+
+	/**
+	 * Handle when the command starts
+	 * @param commandName The name the command was run with (lowercase, whatever case the script wrote it in)
+	 * @param args The parsed arguments. Only valid during the call.
+	 */
+	virtual void start(std::string_view commandName, const std::tuple<Ts...> &args) = 0;
+
+	void start(std::string_view commandName, const ArgList &args) override final {
+		if(args.parsed() == nullptr){
+			std::cerr << "WARNING: Command \"" << commandName << "\" has no parsed arguments. Register it with registerCommand<T>." << std::endl;
+			complete();
+			return;
+		}
+		start(commandName, *static_cast<const std::tuple<Ts...>*>(args.parsed()));
+	}
+};
+
+/**
+ * A BackgroundAutoCommand with typed arguments (see TypedAutoCommand).
+ * Register with AutoManager::registerBackgroundCommand<T>.
+ */
+template<class... Ts>
+class TypedBackgroundAutoCommand : public BackgroundAutoCommand{
+public:
+	typedef Args<Ts...> Arguments;
+
+	/**
+	 * Handle new arguments from the script
+	 * @param commandName The name the command was run with (lowercase, whatever case the script wrote it in)
+	 * @param args The parsed arguments. Only valid during the call.
+	 */
+	virtual void updateArgs(std::string_view commandName, const std::tuple<Ts...> &args) = 0;
+
+	void updateArgs(std::string_view commandName, const ArgList &args) override final {
+		if(args.parsed() == nullptr){
+			std::cerr << "WARNING: Background command \"" << commandName << "\" has no parsed arguments." << std::endl;
+			return;
+		}
+		updateArgs(commandName, *static_cast<const std::tuple<Ts...>*>(args.parsed()));
+	}
+};
+
+/**
+ * Storage for the background commands of one type. The commands are stored together in blocks that never move
+ * and the AutoManager processes each run of awake commands of the type (registered one after another) with one
+ * virtual call instead of two per command.
+ */
+class BgCommandStore{
+public:
+	/**
+	 * Construct a new command in the store
+	 * @return The command (valid until the store is destroyed)
+	 */
+	virtual BackgroundAutoCommand &add() = 0;
+
+	/**
+	 * Process commands of this store. Each one is only processed if it is awake and shouldProcess returns true.
+	 * @param commands The commands (all from this store)
+	 * @param count The number of commands
+	 * @param now The time of the current tick
+	 */
+	virtual void processBatch(BackgroundAutoCommand *const *commands, size_t count, AutoTime now) = 0;
+
+	virtual ~BgCommandStore(){}
+};
+
+template<class T>
+class TypedBgCommandStore : public BgCommandStore{
+private:
+	static constexpr size_t BlockSize = 16;
+	typedef typename std::aligned_storage<sizeof(T), alignof(T)>::type Slot;
+
+	std::vector<std::unique_ptr<Slot[]>> blocks;
+	size_t count = 0;
+
+	T &at(size_t i){ return *std::launder(reinterpret_cast<T*>(&blocks[i / BlockSize][i % BlockSize])); }
+
+public:
+	TypedBgCommandStore(){}
+	TypedBgCommandStore(const TypedBgCommandStore&) = delete;
+	TypedBgCommandStore &operator=(const TypedBgCommandStore&) = delete;
+
+	BackgroundAutoCommand &add() override {
+		if(count % BlockSize == 0)
+			blocks.emplace_back(new Slot[BlockSize]);
+		T *command = new(&blocks.back()[count % BlockSize]) T();
+		count++;
+		return *command;
+	}
+
+	void processBatch(BackgroundAutoCommand *const *commands, size_t count, AutoTime now) override {
+		for(size_t i = 0; i < count; ++i){
+			// The type is known so shouldProcess and process are called directly
+			T &command = static_cast<T&>(*commands[i]);
+			BackgroundAutoCommand &state = command;
+			if(state.sleeping || !command.T::shouldProcess())
+				continue;
+			state.tickTime = now;
+			command.T::process();
+		}
+	}
+
+	~TypedBgCommandStore(){
+		for(size_t i = count; i > 0; --i){
+			at(i - 1).~T();
+		}
+	}
+};
+
 typedef std::unique_ptr<AutoCommand> CmdPointer;
 typedef std::function<CmdPointer()> CmdCreator;
-typedef std::unique_ptr<BackgroundAutoCommand> BgCmdPointer;
+typedef std::unique_ptr<BgCommandStore> BgStorePointer;
 
 template<class T>
 CmdPointer CommandCreator(){
-	if(!std::is_base_of<AutoCommand, T>::value){
-		std::cerr << "WARNING: Creator cannot create command. Given type is not a valid AutoCommand." << std::endl;
-		return CmdPointer(nullptr);
-	}
+	static_assert(std::is_base_of<AutoCommand, T>::value, "Creator cannot create command. Given type is not a valid AutoCommand.");
 	return CmdPointer(new T());
 }
 
@@ -134,17 +439,100 @@ CmdPointer CommandCreator(){
  */
 class AutoManager{
 protected:
+	// Frames of coroutine commands (see autocoroutine.hpp). Declared first so it outlives every command.
+	FramePool framePool;
+
 	// Data for the current script
-	std::vector<std::string> loadedCommands;
-	std::vector<std::vector<std::string>> loadedArguments;
+	AutoScript script;
 	size_t currentCommandIndex = -1;
 	CmdPointer currentCommand{nullptr};
+	AutoClock *clock = &SteadyAutoClock::instance();
+	AutoTime tickTime{0}; // Time sampled at the start of the current process() call
+	uint32_t currentCommandCreator = 0; // Index of the creator that made currentCommand
+
+	// Commands running at the same time in a PARALLEL / RACE / DEADLINE group. currentCommand is not used while a group runs.
+	struct ActiveCommand{
+		CmdPointer command;
+		uint32_t creator;   // Index of the creator that made the command
+		size_t row;         // Script row the command was started from
+	};
+	std::vector<ActiveCommand> groupCommands;
+	bool groupActive = false;
+	uint32_t groupKind = AutoOpcode::Parallel;
+
+	// Running a script with id= / after= annotations as a dependency graph (see ScriptGraph)
+	std::vector<uint32_t> graphWaiting;       // Per row: dependencies that have not finished
+	std::vector<uint32_t> graphReady;         // Rows to start this tick
+	std::vector<ActiveCommand> graphRunning;  // Commands started and not finished
+	bool graphStarted = false;                // False until the first tick of a run sets up graphWaiting and graphReady
+	std::vector<uint8_t> graphFinished;       // Per row: finished (only used while rows are inserted into a running graph)
+	bool scriptResolved = true; // False when every row needs to be resolved again (ex after unregisterAll)
+	AutoTime durationLimit{0};  // Longest a loaded script may run for (0 for no limit)
+	AutoTime tickPeriod = std::chrono::milliseconds(20); // Time between ticks assumed by the script analysis
+	uint64_t registrationVersion = 0; // Changed by every registration so preloaded scripts can tell if they are stale
+
+	// Scripts loaded in the background and the one waiting to be switched to at the next tick
+	std::unique_ptr<ScriptLoader> scriptLoader;
+	PreparedScriptPointer pendingScript; // Only accessed with std::atomic_load / std::atomic_exchange
+	std::atomic<bool> scriptSwapPending{false};
+
+	// Commands pushed by other threads, appended to the script at the start of a tick (see enableCommandInjection)
+	std::unique_ptr<MpscRing<InjectedCommand>> injectedCommands;
 
 	// Registered commands. Used to get a command from a command name (string)
-	std::unordered_map<std::string, CmdCreator> registeredCommands;
+	std::unordered_map<std::string, uint32_t> registeredCommands; // This handles mapping from string to index in commandCreators
+	std::vector<CmdCreator> commandCreators;
+	std::vector<ArgSchemaPointer> commandSchemas; // Argument schema for each creator (nullptr for raw text arguments)
+	std::vector<CmdTimeoutBound> commandTimeouts; // Timeout bound for each creator (nullptr for commands without one)
+	std::vector<std::vector<CmdPointer>> commandPools; // Finished commands for each creator. Reused instead of creating new commands.
 	std::unordered_map<std::string, size_t> backgroundCommands; // This handles mapping from string to index in uniqueBgCommands
-	std::vector<BgCmdPointer> uniqueBgCommands; // Only one per registered type so if registered with 5 names will not be run 5 times
-	std::vector<std::string> bgCommandTypes;
+	std::vector<BackgroundAutoCommand*> uniqueBgCommands; // Only one per registered type (unless registered as instances) so if registered with 5 names will not be run 5 times
+	std::vector<ArgSchemaPointer> bgCommandSchemas; // Argument schema for each background command (nullptr for raw text arguments)
+	std::vector<std::string> bgCommandTypes; // Type name of each background command
+	std::vector<uint32_t> bgCommandStoreIndices; // Store holding each background command
+	std::vector<BgStorePointer> bgCommandStores; // One per type. Owns the background commands.
+	std::unordered_map<std::type_index, uint32_t> bgStoreTypes; // Type -> index in bgCommandStores
+	std::unordered_map<std::type_index, size_t> bgSharedCommands; // Type -> the command registerBackgroundCommand gives every name of the type
+	std::vector<BackgroundAutoCommand*> bgBatch; // Reused each tick to hand a run of same type commands to their store
+
+	// Order background commands are processed in. Each stage only depends on earlier stages so
+	// the parallel safe commands in a stage can be processed at the same time.
+	struct BgTask{
+		AutoManager *manager;
+		size_t index;
+		uint32_t stage = 0;          // Stage of the schedule the command is processed in
+		uint32_t rank = 0;           // Position of the command in the schedule
+		uint32_t store = 0;          // Store (type) of the command
+		bool parallel = false;       // Processed on the thread pool
+		bool awake = false;          // In bgAwake
+		AutoTime profileStart{0};    // Only measured when a profiler is attached
+		AutoTime profileDuration{-1}; // Negative if the command was not processed this tick
+		void operator()();
+	};
+	std::vector<BgTask> bgTasks;
+	bool bgScheduleValid = false;
+
+	// Only awake background commands are looked at each tick. Sleeping ones with a deadline wait in a min-heap.
+	struct BgWakeup{
+		AutoTime deadline;
+		size_t index;
+		uint32_t generation; // Ignored if the command has woken since this was queued
+		bool operator>(const BgWakeup &other) const { return deadline > other.deadline; }
+	};
+	std::vector<size_t> bgAwake;      // Indices of awake commands
+	bool bgAwakeSorted = true;        // bgAwake is in schedule order
+	std::vector<BgWakeup> bgWakeups;  // Heap ordered by deadline (std::push_heap with std::greater)
+	std::atomic<bool> bgWakePending{false}; // A background command was woken from another thread
+	WorkStealingPool *threadPool = nullptr;
+	AutoProfiler *profiler = nullptr; // Every measurement is skipped when null
+	TelemetryLog *telemetry = nullptr; // Every event is skipped when null
+	uint32_t telemetryNames = 0;       // Script names already given to the telemetry log
+
+	// Snapshots of the execution state (see saveSnapshot)
+	SnapshotBuffer *snapshotBuffer = nullptr;   // A snapshot is saved at the end of every tick when set
+	std::vector<uint32_t> bgLastRows;          // Per background command: row it last got arguments from (SnapshotBackground::NoRow if none)
+	uint64_t scriptFingerprint = 0;            // Hash of the script's rows (valid if fingerprintValid)
+	bool fingerprintValid = false;
 
 	/**
 	 * Split a string by a character delimiter
@@ -154,6 +542,236 @@ protected:
 	 */
 	std::vector<std::string> split(const std::string& s, char delimiter);
 
+	/**
+	 * Lowercase a name and check it can be registered (reports why not)
+	 * @param name The name (lowercased)
+	 * @return false if the name is part of the script language or already registered
+	 */
+	bool checkRegisterName(std::string &name) const;
+
+	/**
+	 * Construct a background command in the store for its type
+	 * @return The index of the command in uniqueBgCommands
+	 */
+	template<class T>
+	size_t addBgCommand(){
+		std::type_index type(typeid(T));
+		auto it = bgStoreTypes.find(type);
+		uint32_t store;
+		if(it == bgStoreTypes.end()){
+			store = (uint32_t)bgCommandStores.size();
+			bgCommandStores.emplace_back(new TypedBgCommandStore<T>());
+			bgStoreTypes[type] = store;
+		}else{
+			store = it->second;
+		}
+		BackgroundAutoCommand &command = bgCommandStores[store]->add();
+		command.wakeSignal = &bgWakePending;
+		uniqueBgCommands.push_back(&command);
+		bgCommandStoreIndices.push_back(store);
+		bgLastRows.push_back(SnapshotBackground::NoRow);
+		bgCommandSchemas.push_back(ArgSchemaFor<T>::make());
+		bgCommandTypes.push_back(type.name());
+		bgScheduleValid = false;
+		registrationVersion++;
+		return uniqueBgCommands.size() - 1;
+	}
+
+	/**
+	 * Resolve a (lowercase) command name against the registered commands
+	 * @param name The command name
+	 * @return The opcode for the name (Unknown if nothing is registered with the name)
+	 */
+	AutoOpcode resolveName(std::string_view name) const;
+
+	/**
+	 * Resolve the opcode of every loaded row if rows or registrations have changed since the last resolve.
+	 * Each distinct name is only looked up once. Arguments of commands with a schema are parsed here.
+	 * Rows with invalid arguments are reported and marked Invalid.
+	 * @return false if any row has invalid arguments
+	 */
+	bool resolveScript();
+
+	/**
+	 * Copy the registrations needed to resolve a script on another thread
+	 */
+	std::shared_ptr<const ScriptResolver> snapshotRegistrations() const;
+
+	/**
+	 * Replace the script with a preloaded one. Ends the current command and all background commands first.
+	 */
+	void installScript(PreparedScriptPointer prepared);
+
+	/**
+	 * Append every command injected since the last tick to the script. Never waits for the threads pushing them.
+	 */
+	void drainInjectedCommands();
+
+	/**
+	 * Resolve one row's opcode and parse its arguments (its annotations must already be split off)
+	 * @param rowIndex The row
+	 * @param error Reused for the parse error
+	 */
+	void resolveRow(size_t rowIndex, std::string &error);
+
+	/**
+	 * Resolve rows inserted into an already resolved script (without parsing the other rows again)
+	 * @param firstRow The first inserted row
+	 * @param lastRow One past the last inserted row
+	 * @return false if the rows need the whole script resolved (annotations or group markers)
+	 */
+	bool resolveRows(size_t firstRow, size_t lastRow);
+
+	/**
+	 * Resolve rows inserted by addCommand(s) or injected when they are added instead of on the next tick
+	 * @param firstRow The first inserted row
+	 * @param count The number of inserted rows
+	 */
+	void resolveInsertedRows(size_t firstRow, size_t count);
+
+	/**
+	 * Carry a running graph on after rows were inserted. Rows after the inserted ones are moved down and every row
+	 * waits for its dependencies in the new graph that have not finished yet.
+	 * @param firstRow The first inserted row
+	 * @param count The number of inserted rows
+	 */
+	void remapGraphRun(size_t firstRow, size_t count);
+
+	/**
+	 * Resolve the rows using a name that was just registered (other rows keep their opcodes and parsed arguments)
+	 * @param name The registered name (lowercase)
+	 */
+	void resolveRegisteredName(const std::string &name);
+
+	/**
+	 * Get a command from a creator's pool (only creating a new command if the pool is empty)
+	 * @param creatorIndex The index of the creator
+	 * @return The command (reset and ready to start)
+	 */
+	CmdPointer acquireCommand(uint32_t creatorIndex);
+
+	/**
+	 * Return a command (if any) to its creator's pool
+	 * @param command The command (null after this)
+	 * @param creator The index of the creator that made it
+	 */
+	void recycleCommand(CmdPointer &command, uint32_t creator);
+
+	/**
+	 * Return the current command (if any) to its creator's pool
+	 */
+	void recycleCurrentCommand();
+
+	/**
+	 * Run one tick of a script from top to bottom (the current command or group)
+	 * @return True if there are commands that have not finished
+	 */
+	bool processLinear();
+
+	/**
+	 * Run one tick of a script with a dependency graph. Starts every ready row and processes every running command.
+	 * Costs time for the ready and running rows only, not the whole script.
+	 * @return True if there are commands that have not finished
+	 */
+	bool processGraph();
+
+	/**
+	 * Mark a graph row finished and queue the dependents that have nothing left to wait for
+	 */
+	void releaseGraphRow(size_t rowIndex);
+
+	/**
+	 * Make a command time out by its timeout bound (keeping a shorter timeout set by start)
+	 * @param command The command (just started)
+	 * @param bound The command's timeout bound for its arguments
+	 */
+	static void limitTimeout(AutoCommand &command, AutoTime bound);
+
+	/**
+	 * Start (or process if already started) a foreground command
+	 * @param command The command
+	 * @param creator The index of the creator that made it
+	 * @param rowIndex The script row it runs
+	 */
+	void runCommand(AutoCommand &command, uint32_t creator, size_t rowIndex);
+
+	/**
+	 * Get the commands of the group starting at the current row. Moves to the group's end row.
+	 */
+	void startGroup();
+
+	/**
+	 * Process every unfinished command of the running group.
+	 * Completes the remaining commands once a race or deadline group has finished.
+	 */
+	void processGroup();
+
+	/**
+	 * Has the running group finished (see AutoOpcode::GroupKind)
+	 */
+	bool groupFinished() const;
+
+	/**
+	 * Return the commands of the group (if any) to their creators' pools
+	 */
+	void recycleGroup();
+
+	/**
+	 * Build the stages background commands are processed in from their runAfter dependencies
+	 */
+	void buildBgSchedule();
+
+	/**
+	 * Process every awake background command that should be processed (in dependency order)
+	 */
+	void processBgCommands();
+
+	/**
+	 * Wake a background command and add it to the awake commands (nothing if it is not sleeping)
+	 */
+	void wakeBgCommand(size_t index);
+
+	/**
+	 * Give a background command the arguments of a script row (waking it)
+	 */
+	void updateBgCommand(size_t rowIndex);
+
+	/**
+	 * Report a row that has no registered command or invalid arguments
+	 */
+	void skipRow(size_t rowIndex);
+
+	/**
+	 * Record a telemetry event for a script row (only call with a telemetry log attached)
+	 */
+	void logEvent(TelemetryEvent::Type type, uint32_t index, size_t rowIndex);
+
+	/**
+	 * Record how a command ended (completed, timed out or cancelled)
+	 */
+	void logCommandEnd(const AutoCommand &command, uint32_t creator, size_t rowIndex, bool cancelled);
+
+	/**
+	 * Get the hash of the script's rows (computed again only after the rows change)
+	 */
+	uint64_t getScriptFingerprint();
+
+	/**
+	 * Write a foreground command to a snapshot
+	 */
+	void saveCommand(SnapshotWriter &out, AutoCommand &command, uint32_t creator, size_t rowIndex);
+
+	/**
+	 * Recreate a foreground command from a snapshot (started again with its row's arguments)
+	 * @return false if the snapshot does not match the script or the command rejected its state
+	 */
+	bool restoreCommand(SnapshotReader &in, ActiveCommand &active);
+
+	/**
+	 * Get the readable name of a profiler measurement
+	 */
+	std::string profileName(AutoProfiler::Kind kind, uint32_t index) const;
+
 	/**
 	 * If the next command is a background command update its values.
 	 * This will happen for *all* consectutive background commands.
@@ -166,8 +784,10 @@ public:
 	 * Register a command with the AutoManager
 	 * @param creator The CommandCreator for the command (use CommandCreator<T>)
 	 * @param name The name to register the command with
+	 * @param schema The argument schema for the command (nullptr if the command takes raw text arguments)
+	 * @param timeoutBound The longest the command runs for its arguments (nullptr if there is no limit, see TimeoutBoundFor)
 	 */
-	void registerCommand(CmdCreator creator, std::string name);
+	void registerCommand(CmdCreator creator, std::string name, ArgSchemaPointer schema = nullptr, CmdTimeoutBound timeoutBound = nullptr);
 
 	/**
 	 * Register a command with the AutoManager
@@ -176,35 +796,52 @@ public:
 	 */
 	void registerCommand(CmdCreator creator, std::vector<std::string> names);
 
+	/**
+	 * Register a command with the AutoManager.
+	 * If the command is a TypedAutoCommand its arguments are parsed and validated when the script is loaded.
+	 * If it declares timeoutFor (see TimeoutBoundFor) that is its timeout and scripts using it can be bounded.
+	 * @param name The name to register the command with
+	 */
+	template<class T>
+	void registerCommand(std::string name){
+		registerCommand(CommandCreator<T>, name, ArgSchemaFor<T>::make(), TimeoutBoundFor<T>::value);
+	}
+
+	/**
+	 * Register a command with the AutoManager
+	 * @param names A set of names to register the command with
+	 */
+	template<class T>
+	void registerCommand(std::vector<std::string> names){
+		for(size_t i = 0; i < names.size(); ++i){
+			registerCommand<T>(names[i]);
+		}
+	}
+
 	/**
 	 * Register a background command with the auto manager
 	 * @param name The name to register the command with
 	 */
 	template<class T>
 	void registerBackgroundCommand(std::string name){
-		if(!std::is_base_of<BackgroundAutoCommand, T>::value){
-			std::cerr << "WARNING: Cannot register background command. Given type is not a valid BackgroundAutoCommand." << std::endl;
+		static_assert(std::is_base_of<BackgroundAutoCommand, T>::value, "Cannot register background command. Given type is not a valid BackgroundAutoCommand.");
+
+		if(!checkRegisterName(name))
 			return;
-		}
 
-		std::transform(name.begin(), name.end(), name.begin(), ::tolower);
-
-		// Only one command *or* background command can have a key.
-		if(backgroundCommands.find(name) == backgroundCommands.end() && registeredCommands.find(name) == registeredCommands.end()){
-			const std::type_info &t = typeid(T); // Type of command
-			auto it = std::find(bgCommandTypes.begin(), bgCommandTypes.end(), t.name()); // Is this type already added
-			if(it == bgCommandTypes.end()){
-				// First one of this type registered. Add to uniqueCmds vector and register mapping to index
-				bgCommandTypes.push_back(t.name());
-				uniqueBgCommands.push_back(BgCmdPointer(new T()));
-				backgroundCommands[name] = uniqueBgCommands.size() - 1;
-			}else{
-				// This type already registered
-				backgroundCommands[name] = it - bgCommandTypes.begin(); // Map new name key to existing command in uniqueCmds vector
-			}
+		auto it = bgSharedCommands.find(std::type_index(typeid(T))); // Is this type already added
+		if(it == bgSharedCommands.end()){
+			// First one of this type registered
+			size_t index = addBgCommand<T>();
+			bgSharedCommands[std::type_index(typeid(T))] = index;
+			backgroundCommands[name] = index;
 		}else{
-			std::cerr << "Cannot register command with name \"" << name << "\". A command is already registered with that name." << std::endl;
+			// This type already registered. Map new name key to the existing command.
+			backgroundCommands[name] = it->second;
+			bgScheduleValid = false;
+			registrationVersion++;
 		}
+		resolveRegisteredName(name);
 	}
 
 	/**
@@ -213,30 +850,94 @@ public:
 	 */
 	template<class T>
 	void registerBackgroundCommand(std::vector<std::string> names){
-		if(!std::is_base_of<BackgroundAutoCommand, T>::value){
-			std::cerr << "WARNING: Cannot register background command. Given type is not a valid BackgroundAutoCommand." << std::endl;
-			return;
-		}
-
 		for(size_t i = 0; i < names.size(); ++i){
 			registerBackgroundCommand<T>(names[i]);
 		}
 	}
 
 	/**
-	 * Unregister all commands and background commands
+	 * Register a separate instance of a background command type (unlike registerBackgroundCommand, which
+	 * gives every name of a type the same command). Use for many commands of one type with their own state
+	 * (ex one per light or motor). Instances of a type are stored together. Instances registered one after another
+	 * are processed with one virtual call per tick.
+	 * @param name The name to register the command with
+	 * @return The new command (nullptr if the name cannot be registered)
+	 */
+	template<class T>
+	T *registerBackgroundInstance(std::string name){
+		static_assert(std::is_base_of<BackgroundAutoCommand, T>::value, "Cannot register background command. Given type is not a valid BackgroundAutoCommand.");
+
+		if(!checkRegisterName(name))
+			return nullptr;
+		size_t index = addBgCommand<T>();
+		backgroundCommands[name] = index;
+		resolveRegisteredName(name);
+		return static_cast<T*>(uniqueBgCommands[index]);
+	}
+
+	/**
+	 * Unregister all commands and background commands.
+	 * The running script is ended first (as with killAuto) since its commands are destroyed. Restart it after registering again.
 	 */
 	void unregisterAll();
 
 	/**
-	 * Load an autonomous CSV script from the script path
+	 * Load an autonomous script (CSV or compiled with AutoCompile) from the script path.
+	 * Register commands before loading. Every row is resolved and checked here (see analyzeScript)
+	 * so a bad script fails to load instead of being found out while it runs.
 	 * @param fileName The full path to the script to load
-	 * @return Was the script successfully loaded
+	 * @return Was the script successfully loaded (false if the file cannot be read, a row has no registered command
+	 *         or invalid arguments or the script may run longer than the duration limit)
 	 */
 	bool loadScript(std::string fileName);
 
 	/**
-	 * Add a command to autonomous
+	 * Reject scripts that may run longer than a limit (ex the 15s autonomous period) when they are loaded or preloaded.
+	 * The worst case comes from the commands' timeout bounds (see TimeoutBoundFor). Scripts that wait on a command
+	 * without one may run forever and are rejected too.
+	 * @param limit The longest a script may run for (0 for no limit, the default)
+	 * @param period The time between ticks (commands take whole ticks)
+	 */
+	void setDurationLimit(AutoTime limit, AutoTime period = std::chrono::milliseconds(20));
+
+	/**
+	 * Check the loaded (and added) rows and compute how long the script can run for
+	 * Rows without a registered command are reported.
+	 * @return The analysis (see ScriptAnalysis)
+	 */
+	ScriptAnalysis analyzeScript();
+
+	/**
+	 * Start loading a script on a background thread. Loading never blocks the caller.
+	 * The script is resolved against the commands registered when this is called (register commands first).
+	 * Call from the thread that registers commands.
+	 * @param fileName The full path to the script (CSV or compiled)
+	 */
+	void preloadScript(const std::string &fileName);
+
+	/**
+	 * Start loading several scripts on a background thread
+	 * @param fileNames The full paths to the scripts
+	 */
+	void preloadScripts(const std::vector<std::string> &fileNames);
+
+	/**
+	 * Get the state of a preloaded script. Never waits for the load.
+	 */
+	ScriptLoader::Status getPreloadStatus(const std::string &fileName);
+
+	/**
+	 * Switch to a preloaded script at the start of the next tick (ending the current command and background commands).
+	 * The preloaded script is used up. Preload it again to switch to it a second time.
+	 * Never waits for the load. Can be called from any thread.
+	 * @param fileName The full path the script was preloaded with
+	 * @return false if the script is still loading, failed to load or was never preloaded
+	 */
+	bool useScript(const std::string &fileName);
+
+	/**
+	 * Add a command to autonomous.
+	 * Added to a running dependency graph the command starts once the rows it runs after= have finished.
 	 * @param command The command
 	 * @param arguments The arguments for the command
 	 * @param pos The position to insert the command at (-1 for the end of the loaded script).
@@ -251,24 +952,142 @@ public:
 	 */
 	void addCommands(std::vector<std::string> commands, std::vector<std::vector<std::string>> arguments, int pos = -1);
 
+	/**
+	 * Allow other threads to add commands with injectCommand. Call before any thread injects commands.
+	 * @param capacity The number of commands that can be waiting for the next tick
+	 */
+	void enableCommandInjection(size_t capacity = 64);
+
+	/**
+	 * Add a command to the end of the script from any thread. Lock-free: the command is queued and
+	 * appended at the start of the next tick. A script that already finished runs injected commands when they arrive.
+	 * Never allocates (the name and arguments are copied into the queue).
+	 * @param command The command name
+	 * @param args The arguments for the command
+	 * @param argCount The number of arguments (at most InjectedCommand::MaxArgs)
+	 * @return false if injection is not enabled, the queue is full or the command is too long (InjectedCommand::MaxText)
+	 */
+	bool injectCommand(std::string_view command, const std::string_view *args, size_t argCount);
+
+	/**
+	 * Add a command to the end of the script from any thread (see above)
+	 */
+	bool injectCommand(std::string_view command, std::initializer_list<std::string_view> arguments = {}){
+		return injectCommand(command, arguments.begin(), arguments.size());
+	}
+
 	/**
 	 * Remove all loaded commands
 	 */
 	void clearCommands();
 
+	/**
+	 * Run the loaded script again from the first command.
+	 * Ends the current command and all background commands first.
+	 */
+	void restartScript();
+
 	/**
 	 * Get the number of loaded (and added) commands
 	 * @return The number of commands loaded from a script (and added manually)
 	 */
 	size_t loadedCommandCount();
 
+	/**
+	 * Set a thread pool used to process parallel safe background commands at the same time.
+	 * process() still waits for all of them to finish before returning.
+	 * @param pool The pool (must outlive the manager). nullptr processes everything on the calling thread.
+	 */
+	void setThreadPool(WorkStealingPool *pool);
+
+	/**
+	 * Set the clock used for command timing (steady_clock by default)
+	 * @param clock The clock. Must outlive the manager. nullptr restores the default clock.
+	 */
+	void setClock(AutoClock *clock);
+
+	/**
+	 * Get the clock used for command timing
+	 */
+	AutoClock &getClock();
+
+	/**
+	 * Attach a profiler that measures ticks, command creation, starts, processing and background commands.
+	 * Without a profiler each measurement point costs one null check.
+	 * @param profiler The profiler (must outlive the manager). nullptr stops profiling.
+	 */
+	void setProfiler(AutoProfiler *profiler);
+
+	/**
+	 * Attach a telemetry log that records ticks, command starts and ends and background updates.
+	 * Recording never blocks (the log saves events on its own thread).
+	 * @param log The log (must outlive the manager and only be used by this manager). nullptr stops logging.
+	 */
+	void setTelemetry(TelemetryLog *log);
+
+	/**
+	 * Save a snapshot to a buffer at the end of every tick (see saveSnapshot)
+	 * @param buffer The buffer (must outlive the manager or be detached first). nullptr stops saving snapshots.
+	 */
+	void setSnapshotBuffer(SnapshotBuffer *buffer);
+
+	/**
+	 * Write the execution state to a buffer: the position in the script, the running commands (with their elapsed time,
+	 * timeout and sleep state), the row each background command got its arguments from and its sleep state,
+	 * plus whatever the commands save with saveState. Call between ticks. Never allocates.
+	 * @param data Where to write the snapshot
+	 * @param capacity The size of data
+	 * @return The size of the snapshot (0 if it does not fit)
+	 */
+	size_t saveSnapshot(uint8_t *data, size_t capacity);
+
+	/**
+	 * Continue from a snapshot. The same script must be loaded and the same commands registered.
+	 * Ends the current command and all background commands first. Running commands are started again
+	 * with their row's arguments and given their elapsed time, timeout and saved state, and background commands
+	 * get the arguments they last had. The next tick continues where the snapshot was saved.
+	 * @param data The snapshot
+	 * @param size The size of the snapshot
+	 * @return false if the snapshot is damaged or does not match (the script then runs from the start)
+	 */
+	bool restoreSnapshot(const uint8_t *data, size_t size);
+
+	/**
+	 * Continue from the latest snapshot in a buffer (see above)
+	 * @return false if the buffer has no usable snapshot
+	 */
+	bool restoreSnapshot(const SnapshotBuffer &buffer);
+
+	/**
+	 * Get a summary (p50 / p99 / max) of everything the attached profiler measured, named by command
+	 * @return One entry per measured command and kind (empty without a profiler)
+	 */
+	std::vector<ProfileEntry> getProfile() const;
+
+	/**
+	 * Write the attached profiler's trace events as Chrome trace event JSON (chrome://tracing or Perfetto)
+	 * The profiler must have been given a trace buffer with AutoProfiler::enableTrace.
+	 * @param out The stream to write to
+	 * @return false if there is no profiler
+	 */
+	bool writeChromeTrace(std::ostream &out) const;
+
 	/**
 	 * Process the autonomous commands.
 	 * Handles the current command, any background commands, and moving between commands.
+	 * The clock is sampled once and every command sees that time.
 	 * @return True if there are any commands (excluding background commands) that have not finished
 	 */
 	bool process();
 
+	/**
+	 * Process the autonomous commands at a given time instead of sampling the clock.
+	 * Used when several managers should observe the same time step.
+	 * @param now The time of this tick
+	 * @return True if there are any commands (excluding background commands) that have not finished
+	 */
+	bool process(AutoTime now);
+
 	/**
 	 * End the current command and all background commands
 	 * Calls complete method so that everything ends properly then move to the end of the script
@@ -0,0 +1,161 @@
+/**
+ * autoprofiler.hpp
+ * Opt in timing of AutoManager ticks and commands.
+ * An AutoManager only measures anything if a profiler is attached (AutoManager::setProfiler).
+ *
+ * Copyright (c) 2018 FRC Team 2655 - The Flying Platypi
+ * See LICENSE file for details
+ */
+
+#pragma once
+
+#include "autoclock.hpp"
+
+#include <vector>
+#include <array>
+#include <string>
+#include <cstdint>
+#include <ostream>
+
+namespace team2655{
+
+/**
+ * Fixed size log-linear histogram (8 buckets per power of two, so values are within 12.5%).
+ * Recording never allocates.
+ */
+class LatencyHistogram{
+private:
+	static constexpr int SubBucketBits = 3;
+	static constexpr int BucketCount = 64 << SubBucketBits;
+
+	std::array<uint64_t, BucketCount> buckets{};
+	uint64_t count = 0;
+	uint64_t total = 0;
+	uint64_t maxValue = 0;
+
+	static int bucketIndex(uint64_t value);
+	static uint64_t bucketUpperBound(int index);
+
+public:
+	void record(uint64_t value);
+
+	/**
+	 * Get a percentile of the recorded values
+	 * @param percentile The percentile (0-100)
+	 * @return The upper bound of the bucket containing the percentile (never more than the max)
+	 */
+	uint64_t percentile(double percentile) const;
+
+	uint64_t getCount() const { return count; }
+	uint64_t getTotal() const { return total; }
+	uint64_t getMax() const { return maxValue; }
+
+	void reset();
+};
+
+class AutoProfiler{
+public:
+	/**
+	 * What a measurement is of
+	 */
+	enum class Kind : uint8_t{
+		Tick,       // A whole AutoManager::process() call
+		Create,     // Getting a command from its pool or creator
+		Start,      // Starting a command (doStart and its first process)
+		Process,    // Processing a running command
+		Background  // Processing a background command
+	};
+	static constexpr int KindCount = 5;
+
+	/**
+	 * A finished measurement kept for the trace
+	 */
+	struct TraceEvent{
+		Kind kind;
+		uint32_t index;   // Creator index (Create, Start, Process) or background command index
+		AutoTime start;
+		AutoTime duration;
+	};
+
+private:
+	std::vector<LatencyHistogram> histograms[KindCount]; // By kind then creator / background command index
+	LatencyHistogram allocationsPerTick;
+	uint64_t (*allocationCounter)() = nullptr;
+
+	std::vector<TraceEvent> trace; // Ring buffer of the newest events
+	size_t traceNext = 0;
+	bool traceWrapped = false;
+
+public:
+	/**
+	 * Get the current time used for measurements (steady_clock, independent of the AutoManager's clock)
+	 */
+	static AutoTime now(){ return SteadyAutoClock::instance().now(); }
+
+	/**
+	 * Record a measurement
+	 * @param kind What was measured
+	 * @param index The creator or background command index (0 for Tick)
+	 * @param start When the measured work started
+	 * @param duration How long it took
+	 */
+	void record(Kind kind, uint32_t index, AutoTime start, AutoTime duration);
+
+	/**
+	 * Set a function returning the total number of allocations made by the program so far
+	 * (for example a counter in a replaced operator new). Allocations per tick are only recorded if set.
+	 */
+	void setAllocationCounter(uint64_t (*counter)()){ allocationCounter = counter; }
+
+	/**
+	 * Get the current value of the allocation counter (0 if there is none)
+	 */
+	uint64_t allocations() const { return allocationCounter ? allocationCounter() : 0; }
+
+	/**
+	 * Record the number of allocations made during a tick
+	 */
+	void recordAllocations(uint64_t count){ if(allocationCounter) allocationsPerTick.record(count); }
+
+	/**
+	 * Keep the newest events for writeChromeTrace
+	 * @param maxEvents The number of events to keep (0 disables the trace)
+	 */
+	void enableTrace(size_t maxEvents);
+
+	/**
+	 * Get a histogram of measurements (empty if nothing was recorded for it)
+	 */
+	const LatencyHistogram &histogram(Kind kind, uint32_t index) const;
+
+	/**
+	 * Get the number of indices with measurements of a kind
+	 */
+	size_t indexCount(Kind kind) const { return histograms[(int)kind].size(); }
+
+	const LatencyHistogram &getAllocationsPerTick() const { return allocationsPerTick; }
+
+	/**
+	 * Get the kept trace events, oldest first
+	 */
+	std::vector<TraceEvent> traceEvents() const;
+
+	/**
+	 * Clear all measurements and trace events
+	 */
+	void reset();
+};
+
+/**
+ * Summary of one histogram with a readable name
+ */
+struct ProfileEntry{
+	std::string name;     // ex "drive.start", "move_lifter.process", "tick"
+	uint64_t count;
+	AutoTime p50;
+	AutoTime p99;
+	AutoTime max;
+	AutoTime total;
+};
+
+}
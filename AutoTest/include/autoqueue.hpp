@@ -0,0 +1,162 @@
+/**
+ * autoqueue.hpp
+ * Lock-free queue used to hand commands from other threads to an AutoManager
+ *
+ * Copyright (c) 2018 FRC Team 2655 - The Flying Platypi
+ * See LICENSE file for details
+ */
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string_view>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+
+namespace team2655{
+
+/**
+ * Bounded multi producer single consumer ring buffer (Vyukov's bounded queue).
+ * Each cell has a sequence number telling producers and the consumer whose turn it is, so push and pop
+ * never block, never allocate and a full queue makes push fail instead of waiting.
+ * Values are written and read in place.
+ */
+template<class T>
+class MpscRing{
+private:
+	struct Cell{
+		std::atomic<size_t> sequence;
+		T value;
+	};
+
+	std::unique_ptr<Cell[]> cells;
+	size_t mask;
+	alignas(64) std::atomic<size_t> enqueuePos{0}; // Shared by producers
+	alignas(64) size_t dequeuePos = 0;             // Only used by the consumer
+
+public:
+	/**
+	 * @param capacity Maximum number of queued values (rounded up to a power of two)
+	 */
+	explicit MpscRing(size_t capacity){
+		size_t size = 1;
+		while(size < capacity)
+			size <<= 1;
+		cells.reset(new Cell[size]);
+		mask = size - 1;
+		for(size_t i = 0; i < size; ++i){
+			cells[i].sequence.store(i, std::memory_order_relaxed);
+		}
+	}
+
+	MpscRing(const MpscRing&) = delete;
+	MpscRing &operator=(const MpscRing&) = delete;
+
+	size_t capacity() const { return mask + 1; }
+
+	/**
+	 * Claim a cell and fill it. Can be called from any thread.
+	 * @param fill Called with the cell's value to write
+	 * @return false if the queue is full
+	 */
+	template<class F>
+	bool tryPush(F &&fill){
+		size_t pos = enqueuePos.load(std::memory_order_relaxed);
+		Cell *cell;
+		while(true){
+			cell = &cells[pos & mask];
+			size_t sequence = cell->sequence.load(std::memory_order_acquire);
+			intptr_t difference = (intptr_t)sequence - (intptr_t)pos;
+			if(difference == 0){
+				if(enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+					break;
+			}else if(difference < 0){
+				return false; // Full
+			}else{
+				pos = enqueuePos.load(std::memory_order_relaxed);
+			}
+		}
+		fill(cell->value);
+		cell->sequence.store(pos + 1, std::memory_order_release);
+		return true;
+	}
+
+	/**
+	 * Take the oldest value. Only call from the consumer thread.
+	 * @param consume Called with the value before its cell is reused
+	 * @return false if the queue is empty (or the oldest value is still being written)
+	 */
+	template<class F>
+	bool tryPop(F &&consume){
+		Cell *cell = &cells[dequeuePos & mask];
+		size_t sequence = cell->sequence.load(std::memory_order_acquire);
+		if((intptr_t)sequence - (intptr_t)(dequeuePos + 1) < 0)
+			return false;
+		consume(cell->value);
+		cell->sequence.store(dequeuePos + mask + 1, std::memory_order_release);
+		dequeuePos++;
+		return true;
+	}
+};
+
+/**
+ * A command and its arguments stored inline (no allocation) so it can sit in an MpscRing
+ */
+struct InjectedCommand{
+	static constexpr size_t MaxText = 256;
+	static constexpr size_t MaxArgs = 16;
+
+	uint8_t argCount = 0;
+	uint16_t nameLength = 0;
+	uint16_t argLengths[MaxArgs];
+	char text[MaxText]; // Name followed by each argument (not null terminated)
+
+	/**
+	 * Can a command be stored (not too many arguments or too much text)
+	 */
+	static bool fits(std::string_view name, const std::string_view *args, size_t count){
+		if(count > MaxArgs)
+			return false;
+		size_t total = name.size();
+		for(size_t i = 0; i < count; ++i){
+			total += args[i].size();
+		}
+		return total <= MaxText;
+	}
+
+	/**
+	 * Store a command (check fits first)
+	 */
+	void set(std::string_view name, const std::string_view *args, size_t count){
+		char *out = text;
+		std::memcpy(out, name.data(), name.size());
+		out += name.size();
+		nameLength = (uint16_t)name.size();
+		for(size_t i = 0; i < count; ++i){
+			std::memcpy(out, args[i].data(), args[i].size());
+			out += args[i].size();
+			argLengths[i] = (uint16_t)args[i].size();
+		}
+		argCount = (uint8_t)count;
+	}
+
+	std::string_view name() const { return std::string_view(text, nameLength); }
+
+	/**
+	 * Get views of the arguments (into this command's text)
+	 * @param args Array of at least MaxArgs views
+	 * @return The number of arguments
+	 */
+	size_t arguments(std::string_view *args) const {
+		const char *in = text + nameLength;
+		for(size_t i = 0; i < argCount; ++i){
+			args[i] = std::string_view(in, argLengths[i]);
+			in += argLengths[i];
+		}
+		return argCount;
+	}
+};
+
+}
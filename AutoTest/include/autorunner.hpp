@@ -0,0 +1,119 @@
+/**
+ * autorunner.hpp
+ * Fixed rate loop for running an AutoManager in real time
+ *
+ * Copyright (c) 2018 FRC Team 2655 - The Flying Platypi
+ * See LICENSE file for details
+ */
+
+#pragma once
+
+#include "autonomous.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <cstdint>
+
+namespace team2655{
+
+/**
+ * Calls AutoManager::process() at a fixed rate.
+ * Ticks are scheduled against absolute deadlines (start + n * period) so the time spent in a tick does not
+ * make the loop drift. Wake up jitter and overruns (a tick finishing after the next deadline) are tracked.
+ */
+class PeriodicRunner{
+public:
+	/**
+	 * What to do when a tick runs past one or more deadlines
+	 */
+	enum class OverrunPolicy{
+		CatchUp, // Run the missed ticks back to back until the loop is on schedule again
+		Skip     // Drop the missed ticks and continue at the next deadline in the future
+	};
+
+	struct Stats{
+		uint64_t ticks = 0;         // Ticks run
+		uint64_t overruns = 0;      // Ticks that finished after the next deadline
+		uint64_t skippedTicks = 0;  // Deadlines dropped by the Skip policy
+		AutoTime maxJitter{0};      // Largest delay between a deadline and the tick starting
+		AutoTime totalJitter{0};    // Sum of all delays (divide by ticks for the mean)
+		AutoTime maxTickTime{0};    // Longest time spent in process()
+	};
+
+private:
+	AutoManager &manager;
+	AutoTime period;
+	OverrunPolicy policy = OverrunPolicy::CatchUp;
+	std::atomic<bool> stopRequested{false};
+	Stats stats;                           // Only touched by the thread in run()
+	Stats publishedStats;                  // Copy of stats for other threads (statsMutex)
+	mutable std::mutex statsMutex;
+	std::atomic<bool> resetRequested{false}; // resetStats was called. run() clears stats before its next tick.
+
+	void sleepUntil(AutoTime deadline);
+
+	/**
+	 * Copy stats for getStats. Skipped (until the next tick) instead of waiting if a reader holds the lock, unless wait is set.
+	 */
+	void publishStats(bool wait);
+
+public:
+	/**
+	 * @param manager The manager to run
+	 * @param rateHz How many times per second to process the manager
+	 */
+	PeriodicRunner(AutoManager &manager, double rateHz = 50);
+
+	/**
+	 * Set how many times per second the manager is processed
+	 */
+	void setRate(double rateHz);
+
+	/**
+	 * Set the time between ticks
+	 */
+	void setPeriod(AutoTime period);
+
+	AutoTime getPeriod() const { return period; }
+
+	void setOverrunPolicy(OverrunPolicy policy);
+
+	/**
+	 * Pin the calling thread to a CPU (Linux only). Call from the thread that will call run().
+	 * @param cpu The index of the CPU
+	 * @return true if the thread was pinned
+	 */
+	static bool pinCurrentThread(int cpu);
+
+	/**
+	 * Give the calling thread SCHED_FIFO real time priority (Linux only, usually needs CAP_SYS_NICE).
+	 * Call from the thread that will call run().
+	 * @param priority The SCHED_FIFO priority (1-99)
+	 * @return true if the scheduling policy was changed
+	 */
+	static bool setRealtimePriority(int priority);
+
+	/**
+	 * Process the manager at the configured rate until its script is done or stop() is called
+	 */
+	void run();
+
+	/**
+	 * Make run() return after the current tick. Can be called from any thread.
+	 * If run() has not been called yet the next call returns without running a tick.
+	 */
+	void stop();
+
+	/**
+	 * Get timing statistics for the ticks run so far. Can be called from any thread while run() runs
+	 * (the copy is at most one tick old).
+	 */
+	Stats getStats() const;
+
+	/**
+	 * Clear the statistics. Can be called from any thread.
+	 */
+	void resetStats();
+};
+
+}
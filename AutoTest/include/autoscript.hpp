@@ -0,0 +1,493 @@
+/**
+ * autoscript.hpp
+ * Storage and parsing for Team 2655's CSV autonomous scripts
+ *
+ * Copyright (c) 2018 FRC Team 2655 - The Flying Platypi
+ * See LICENSE file for details
+ */
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+
+namespace team2655{
+
+/**
+ * Arguments for a command. These are views into the loaded script and are valid until the script is cleared.
+ * If the command has an argument schema the values parsed by the schema are also available.
+ */
+class ArgList{
+private:
+	const std::string_view *first = nullptr;
+	size_t count = 0;
+	const void *parsedValues = nullptr;
+
+public:
+	ArgList(){}
+	ArgList(const std::string_view *first, size_t count, const void *parsedValues = nullptr) :
+		first(first), count(count), parsedValues(parsedValues){}
+
+	/**
+	 * Get the values parsed by the command's ArgSchema (nullptr if the command has no schema).
+	 * For a TypedArgSchema<Ts...> this is a std::tuple<Ts...>.
+	 */
+	const void *parsed() const { return parsedValues; }
+
+	size_t size() const { return count; }
+	bool empty() const { return count == 0; }
+	const std::string_view &operator[](size_t i) const { return first[i]; }
+	const std::string_view *begin() const { return first; }
+	const std::string_view *end() const { return first + count; }
+};
+
+/**
+ * What a script row runs. The command name is resolved to this once (when the script is
+ * loaded or registrations change) so processing never has to look names up.
+ */
+struct AutoOpcode{
+	enum Kind : uint8_t {
+		Unknown,
+		Command,
+		Background,
+		Invalid,     // The arguments do not match the command's schema (or a group is not closed properly)
+		GroupBegin,  // PARALLEL_BEGIN, RACE_BEGIN or DEADLINE_BEGIN
+		GroupEnd     // PARALLEL_END, RACE_END or DEADLINE_END
+	};
+
+	/**
+	 * How a group of commands that run at the same time finishes
+	 */
+	enum GroupKind : uint32_t {
+		Parallel, // When every command has finished
+		Race,     // When any command finishes (the others are completed)
+		Deadline  // When the first command finishes (the others are completed)
+	};
+
+	Kind kind = Unknown;
+	uint32_t index = 0; // Index into the command creators (Command), background commands (Background) or the GroupKind (GroupBegin, GroupEnd)
+
+	struct Builtin{
+		std::string_view name;
+		Kind kind;
+		GroupKind group;
+	};
+
+	// Names built into the script language (commands cannot be registered with them)
+	static constexpr Builtin builtins[] = {
+		{ "parallel_begin", GroupBegin, Parallel },
+		{ "parallel_end", GroupEnd, Parallel },
+		{ "race_begin", GroupBegin, Race },
+		{ "race_end", GroupEnd, Race },
+		{ "deadline_begin", GroupBegin, Deadline },
+		{ "deadline_end", GroupEnd, Deadline }
+	};
+
+	/**
+	 * Is a (lowercase) name built into the script language. Usable at compile time.
+	 */
+	static constexpr bool isBuiltin(std::string_view name){
+		for(const Builtin &builtin : builtins){
+			if(name == builtin.name)
+				return true;
+		}
+		return false;
+	}
+
+	/**
+	 * Get the opcode of a name built into the script language (group markers)
+	 * @param name The (lowercase) command name
+	 * @return The opcode (Unknown if the name is not built in)
+	 */
+	static AutoOpcode builtin(std::string_view name);
+};
+
+/**
+ * Append-only text storage for a loaded script.
+ * Text is stored in blocks that never move, so string_views into the arena stay valid until it is cleared.
+ */
+class ScriptArena{
+private:
+	struct Block{
+		std::unique_ptr<char[]> data;
+		size_t size;
+		size_t used;
+	};
+
+	static constexpr size_t BlockSize = 4096;
+
+	std::vector<Block> blocks;
+
+public:
+	/**
+	 * Allocate uninitialized space in the arena
+	 * @param size The number of bytes to allocate
+	 * @param alignment The required alignment of the space (power of two, at most alignof(std::max_align_t))
+	 * @return Pointer to the space (valid until clear is called)
+	 */
+	char *allocate(size_t size, size_t alignment = 1);
+
+	/**
+	 * Copy text into the arena
+	 * @param text The text to copy
+	 * @return A view of the copy stored in the arena
+	 */
+	std::string_view store(std::string_view text);
+
+	/**
+	 * Allocate uninitialized, correctly aligned space for an array in the arena. Only for trivial types.
+	 * @param count The number of elements
+	 * @return Pointer to the first element (valid until clear is called)
+	 */
+	template<class T>
+	T *allocateArray(size_t count){
+		return reinterpret_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+	}
+
+	/**
+	 * Release all text in the arena. Any views into the arena are invalid after this.
+	 */
+	void clear();
+
+	/**
+	 * Get the number of bytes allocated for the arena
+	 * @return The total size of all blocks
+	 */
+	size_t capacity() const;
+};
+
+/**
+ * A vector with a movable gap so repeated inserts at (or near) the same position only move the
+ * elements between the old and new insert position instead of everything after it. Only for trivial types.
+ */
+template<class T>
+class GapBuffer{
+private:
+	std::vector<T> data;
+	size_t gapStart = 0;
+	size_t gapEnd = 0;
+
+	void moveGap(size_t pos){
+		if(gapStart == gapEnd){
+			gapStart = gapEnd = pos;
+			return;
+		}
+		if(pos < gapStart){
+			std::copy_backward(data.begin() + pos, data.begin() + gapStart, data.begin() + gapEnd);
+		}else if(pos > gapStart){
+			std::copy(data.begin() + gapEnd, data.begin() + gapEnd + (pos - gapStart), data.begin() + gapStart);
+		}
+		gapEnd = pos + (gapEnd - gapStart);
+		gapStart = pos;
+	}
+
+	void growGap(size_t needed){
+		if(gapEnd - gapStart >= needed)
+			return;
+		size_t tail = data.size() - gapEnd;
+		size_t newSize = std::max(data.size() * 2, size() + needed + 16);
+		data.resize(newSize);
+		std::copy_backward(data.begin() + gapEnd, data.begin() + gapEnd + tail, data.end());
+		gapEnd = newSize - tail;
+	}
+
+public:
+	size_t size() const { return data.size() - (gapEnd - gapStart); }
+	bool empty() const { return size() == 0; }
+
+	T &operator[](size_t i){ return (i < gapStart) ? data[i] : data[i + (gapEnd - gapStart)]; }
+	const T &operator[](size_t i) const { return (i < gapStart) ? data[i] : data[i + (gapEnd - gapStart)]; }
+
+	/**
+	 * Insert elements at a position
+	 * @param pos The index to insert at (size() for the end)
+	 * @param first The first element to insert
+	 * @param count The number of elements to insert
+	 */
+	void insert(size_t pos, const T *first, size_t count){
+		moveGap(pos);
+		growGap(count);
+		std::copy(first, first + count, data.begin() + gapStart);
+		gapStart += count;
+	}
+
+	void push_back(const T &value){
+		insert(size(), &value, 1);
+	}
+
+	void reserve(size_t count){
+		if(count > size()){
+			moveGap(size());
+			growGap(count - size());
+		}
+	}
+
+	void clear(){
+		data.clear();
+		gapStart = gapEnd = 0;
+	}
+};
+
+/**
+ * Single pass CSV parser for autonomous scripts.
+ * Handles \r\n, \r and \n line endings, quoted fields ("a, b" with "" as an escaped quote)
+ * and trims whitespace around unquoted fields. Blank lines and trailing empty fields are skipped.
+ * Fields are views into the parsed text. Quoted fields are unescaped in place so the text must be writable.
+ */
+class ScriptCsvParser{
+private:
+	char *pos;
+	char *end;
+
+public:
+	/**
+	 * @param data The script text. Must outlive any fields returned by the parser.
+	 * @param size The size of the text in bytes
+	 */
+	ScriptCsvParser(char *data, size_t size);
+
+	/**
+	 * Parse the next non-blank row
+	 * @param fields Set to the fields of the row (the command followed by its arguments)
+	 * @return false if there are no more rows
+	 */
+	bool nextRow(std::vector<std::string_view> &fields);
+};
+
+/**
+ * A read only view of a whole file. The file is memory mapped where supported (otherwise it is read into memory).
+ */
+class MappedFile{
+private:
+	const char *fileData = nullptr;
+	size_t fileSize = 0;
+	std::unique_ptr<char[]> buffer; // Used instead of a mapping on platforms without mmap
+
+public:
+	MappedFile(){}
+	MappedFile(MappedFile &&other);
+	MappedFile &operator=(MappedFile &&other);
+	MappedFile(const MappedFile&) = delete;
+	MappedFile &operator=(const MappedFile&) = delete;
+	~MappedFile();
+
+	/**
+	 * Map a file
+	 * @param fileName The full path to the file
+	 * @return Was the file mapped
+	 */
+	bool open(const std::string &fileName);
+
+	/**
+	 * Unmap the file. Any pointers into it are invalid after this.
+	 */
+	void close();
+
+	const char *data() const { return fileData; }
+	size_t size() const { return fileSize; }
+};
+
+/**
+ * Precompiled script format (written by AutoScript::saveBinary and the AutoCompile tool).
+ * All values are in the byte order of the machine that compiled the script and every section is 4 byte aligned:
+ *   BinaryScriptHeader
+ *   BinaryScriptName[nameCount]   Interned (lowercase) command names
+ *   BinaryScriptRow[rowCount]     Rows referencing a name and a span of the argument pool
+ *   BinaryScriptArg[argCount]     Argument pool. Each argument is a span of the text (parsed by the command's schema
+ *                                 when the script is resolved, like CSV arguments).
+ *   char[textSize]                Text of the names and arguments (identical arguments share their text)
+ */
+struct BinaryScriptHeader{
+	static constexpr uint32_t Magic = 0x42534841;     // "AHSB"
+	static constexpr uint32_t ByteOrderMark = 0x01020304;
+	static constexpr uint32_t CurrentVersion = 2; // 2: arguments no longer store a type
+
+	uint32_t magic;
+	uint32_t byteOrder;
+	uint32_t version;
+	uint32_t nameCount;
+	uint32_t rowCount;
+	uint32_t argCount;
+	uint32_t textSize;
+	uint32_t namesOffset;
+	uint32_t rowsOffset;
+	uint32_t argsOffset;
+	uint32_t textOffset;
+	uint32_t fileSize;
+};
+
+struct BinaryScriptName{
+	uint32_t textOffset;
+	uint32_t length;
+};
+
+struct BinaryScriptRow{
+	uint32_t nameId;
+	uint32_t firstArg;
+	uint32_t argCount;
+};
+
+struct BinaryScriptArg{
+	uint32_t textOffset;
+	uint32_t length;
+};
+
+/**
+ * A row of a loaded script
+ */
+struct ScriptRow{
+	uint32_t nameId;                // Index of the (lowercase) command name in the script's name table
+	uint32_t argCount;              // Number of arguments
+	uint32_t annotationCount;       // Number of id= / after= fields stored after the arguments (set when resolving)
+	const std::string_view *args;   // Arguments (stored in the script's arena)
+	AutoOpcode opcode;              // What the row runs (set by the AutoManager)
+	const void *parsed;             // Arguments parsed by the command's schema (set by the AutoManager)
+
+	ArgList arguments() const { return ArgList(args, argCount, parsed); }
+};
+
+/**
+ * Dependencies between the rows of a script that uses id= / after= annotations.
+ * Stored as offsets into one array of dependents so releasing a row only touches its own dependents.
+ */
+struct ScriptGraph{
+	bool enabled = false;                 // The script has annotations and runs as a graph instead of top to bottom
+	std::vector<uint32_t> dependencyCount; // Per row: number of rows it runs after
+	std::vector<uint32_t> dependentStart;  // Per row (plus one): first index of the row's dependents
+	std::vector<uint32_t> dependents;      // Rows that run after each row
+	std::vector<uint32_t> roots;           // Rows that do not run after anything (in script order)
+
+	void clear(){
+		enabled = false;
+		dependencyCount.clear();
+		dependentStart.clear();
+		dependents.clear();
+		roots.clear();
+	}
+};
+
+/**
+ * A loaded autonomous script.
+ * All text and argument lists live in one arena and rows are small fixed size records
+ * (name id + argument span) so loading costs a handful of allocations regardless of the number of rows
+ * and inserting rows never moves any text.
+ */
+class AutoScript{
+private:
+	ScriptArena arena;
+	GapBuffer<ScriptRow> rows;
+	std::vector<MappedFile> mappedFiles; // Binary scripts. Arguments of their rows point into the mapped text.
+	ScriptGraph scriptGraph;             // Built when the script is resolved
+
+	// Interned (lowercase) command names used by the script. Each distinct name is stored once (in the arena).
+	std::vector<std::string_view> names;
+	std::unordered_map<std::string_view, uint32_t> nameIds;
+	std::string internScratch; // Reused buffer for lowercasing names being interned
+
+	ScriptRow makeRow(std::string_view name, const std::string_view *args, size_t argCount, bool copyArgs);
+
+public:
+	/**
+	 * Load CSV script text, appending its rows to this script
+	 * @param fileName The full path to the script
+	 * @return Was the script successfully loaded
+	 */
+	bool loadCsv(const std::string &fileName);
+
+	/**
+	 * Load a precompiled binary script, appending its rows to this script.
+	 * The file is mapped and arguments are used directly from the mapped text.
+	 * @param fileName The full path to the script
+	 * @return Was the script successfully loaded (false if the file is missing, corrupt or from a different version)
+	 */
+	bool loadBinary(const std::string &fileName);
+
+	/**
+	 * Load a script, appending its rows to this script. Binary scripts are detected by their header.
+	 * @param fileName The full path to the script (CSV or binary)
+	 * @return Was the script successfully loaded
+	 */
+	bool load(const std::string &fileName);
+
+	/**
+	 * Write this script in the precompiled binary format
+	 * @param fileName Where to write the script
+	 * @return Was the script successfully written
+	 */
+	bool saveBinary(const std::string &fileName) const;
+
+	/**
+	 * Insert a row
+	 * @param pos The position to insert the row at
+	 * @param name The command name
+	 * @param arguments The arguments for the command (copied into the script)
+	 */
+	void insert(size_t pos, std::string_view name, const std::vector<std::string> &arguments);
+
+	/**
+	 * Insert a row
+	 * @param pos The position to insert the row at
+	 * @param name The command name
+	 * @param args The arguments for the command (copied into the script)
+	 * @param argCount The number of arguments
+	 */
+	void insert(size_t pos, std::string_view name, const std::string_view *args, size_t argCount);
+
+	/**
+	 * Insert a set of rows
+	 * @param pos The position to insert the rows at
+	 * @param names The command names
+	 * @param arguments The arguments for each command (copied into the script)
+	 */
+	void insert(size_t pos, const std::vector<std::string> &names, const std::vector<std::vector<std::string>> &arguments);
+
+	/**
+	 * Get the interned id for a command name (adding it if this is a new name)
+	 * @param name The command name (any case)
+	 * @return The id of the lowercase name
+	 */
+	uint32_t internName(std::string_view name);
+
+	/**
+	 * Find the id of a command name without adding it
+	 * @param name The command name (lowercase)
+	 * @param id Set to the id of the name
+	 * @return false if no row uses the name
+	 */
+	bool findName(std::string_view name, uint32_t &id) const;
+
+	/**
+	 * Get an interned name
+	 * @param id The id of the name
+	 * @return The (lowercase) name. Valid until the script is cleared.
+	 */
+	std::string_view name(uint32_t id) const { return names[id]; }
+
+	/**
+	 * Get the number of distinct command names in the script
+	 */
+	size_t nameCount() const { return names.size(); }
+
+	ScriptRow &row(size_t i){ return rows[i]; }
+	const ScriptRow &row(size_t i) const { return rows[i]; }
+	size_t size() const { return rows.size(); }
+
+	/**
+	 * Get the dependency graph of the script (only enabled if the script uses id= / after= annotations)
+	 */
+	ScriptGraph &graph(){ return scriptGraph; }
+	const ScriptGraph &graph() const { return scriptGraph; }
+
+	/**
+	 * Remove all rows and release all text
+	 */
+	void clear();
+};
+
+}
@@ -0,0 +1,82 @@
+/**
+ * autosimulator.hpp
+ * Runs scripts against simulated time as fast as possible (for tests, CI and parameter sweeps)
+ *
+ * Copyright (c) 2018 FRC Team 2655 - The Flying Platypi
+ * See LICENSE file for details
+ */
+
+#pragma once
+
+#include "autonomous.hpp"
+
+#include <vector>
+#include <string>
+#include <functional>
+#include <cstdint>
+
+namespace team2655{
+
+/**
+ * Outcome of one simulated run
+ */
+struct SimulationResult{
+	bool loaded = false;        // The setup function succeeded (ex the script loaded)
+	bool finished = false;      // Every command finished before the time limit
+	uint64_t ticks = 0;         // Ticks processed
+	AutoTime simulatedTime{0};  // Simulated time when the script finished (or the time limit)
+	AutoTime wallTime{0};       // Real time the run took
+};
+
+/**
+ * One script variant of a batch
+ */
+struct SimulationCase{
+	std::string name;
+	/**
+	 * Prepare a new manager for the run (register commands, load or add the script)
+	 * @return false if the case cannot run (the result is not loaded)
+	 */
+	std::function<bool(AutoManager&)> setup;
+};
+
+/**
+ * Steps AutoManagers with a virtual clock at a fixed period. Commands see simulated time (timeouts included)
+ * and ticks run back to back, so a run only depends on the script and its commands, not on the machine.
+ */
+class AutoSimulator{
+private:
+	AutoTime period;
+	AutoTime timeLimit;
+
+public:
+	/**
+	 * @param period Simulated time between ticks (20ms like the robot's control loop by default)
+	 * @param timeLimit Simulated time a script may run for before it is stopped
+	 */
+	AutoSimulator(AutoTime period = std::chrono::milliseconds(20), AutoTime timeLimit = std::chrono::seconds(15));
+
+	void setPeriod(AutoTime period){ this->period = period; }
+	AutoTime getPeriod() const { return period; }
+	void setTimeLimit(AutoTime timeLimit){ this->timeLimit = timeLimit; }
+	AutoTime getTimeLimit() const { return timeLimit; }
+
+	/**
+	 * Run a manager's script from the start until it finishes or reaches the time limit (then killAuto is called).
+	 * The manager uses a simulated clock during the run and its previous clock afterwards.
+	 * @param manager The manager (commands registered and script loaded)
+	 * @return The result (loaded is always true)
+	 */
+	SimulationResult run(AutoManager &manager) const;
+
+	/**
+	 * Run many cases on a thread pool. Each case gets its own manager.
+	 * Results do not depend on the number of threads or the order the cases ran in.
+	 * @param cases The cases to run
+	 * @param threadCount Number of worker threads (0 for one per hardware thread)
+	 * @return One result per case (same order as cases)
+	 */
+	std::vector<SimulationResult> runBatch(const std::vector<SimulationCase> &cases, size_t threadCount = 0) const;
+};
+
+}
@@ -0,0 +1,276 @@
+/**
+ * autosnapshot.hpp
+ * Saving where an AutoManager is in its script so a restarted process (watchdog, brownout) can resume
+ * the script instead of running it from the first row.
+ * Snapshots are small binary records written without allocating, cheap enough to save every tick.
+ *
+ * Copyright (c) 2018 FRC Team 2655 - The Flying Platypi
+ * See LICENSE file for details
+ */
+
+#pragma once
+
+#include <string>
+#include <memory>
+#include <atomic>
+#include <type_traits>
+#include <cstring>
+#include <cstdint>
+
+namespace team2655{
+
+/**
+ * Writes a snapshot into a fixed size buffer. Never allocates. Writes that do not fit are dropped and mark the writer failed.
+ */
+class SnapshotWriter{
+private:
+	uint8_t *data;
+	size_t capacity;
+	size_t used = 0;
+	bool overflowed = false;
+
+public:
+	SnapshotWriter(uint8_t *data, size_t capacity) : data(data), capacity(capacity){}
+
+	void write(const void *bytes, size_t size){
+		if(overflowed || size > capacity - used){
+			overflowed = true;
+			return;
+		}
+		if(size > 0)
+			std::memcpy(data + used, bytes, size);
+		used += size;
+	}
+
+	/**
+	 * Write a value (its bytes in this machine's byte order)
+	 */
+	template<class T>
+	void write(const T &value){
+		static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable values can be written to a snapshot.");
+		write(&value, sizeof(T));
+	}
+
+	/**
+	 * Start a block of data with its length in front (so a reader can skip or bound it)
+	 * @return Where the block starts (pass to endBlock)
+	 */
+	size_t beginBlock(){
+		size_t start = used;
+		write<uint32_t>(0);
+		return start;
+	}
+
+	/**
+	 * Fill in the length of a block started with beginBlock
+	 */
+	void endBlock(size_t start){
+		if(overflowed)
+			return;
+		uint32_t length = (uint32_t)(used - start - sizeof(uint32_t));
+		std::memcpy(data + start, &length, sizeof(length));
+	}
+
+	size_t size() const { return used; }
+
+	/**
+	 * Did a write not fit
+	 */
+	bool failed() const { return overflowed; }
+};
+
+/**
+ * Reads a snapshot written by SnapshotWriter. Reads past the end fail (and mark the reader failed) instead of reading garbage.
+ */
+class SnapshotReader{
+private:
+	const uint8_t *data = nullptr;
+	size_t length = 0;
+	size_t position = 0;
+	bool overflowed = false;
+
+public:
+	SnapshotReader(){}
+	SnapshotReader(const uint8_t *data, size_t length) : data(data), length(length){}
+
+	bool read(void *bytes, size_t size){
+		if(overflowed || size > length - position){
+			overflowed = true;
+			return false;
+		}
+		if(size > 0)
+			std::memcpy(bytes, data + position, size);
+		position += size;
+		return true;
+	}
+
+	/**
+	 * Read a value written with SnapshotWriter::write
+	 */
+	template<class T>
+	bool read(T &value){
+		static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable values can be read from a snapshot.");
+		return read(&value, sizeof(T));
+	}
+
+	/**
+	 * Read a block written with beginBlock / endBlock
+	 * @param block Reader for the block's data only
+	 * @return false if the block does not fit in the snapshot
+	 */
+	bool readBlock(SnapshotReader &block){
+		uint32_t blockLength = 0;
+		if(!read(blockLength) || blockLength > length - position){
+			overflowed = true;
+			return false;
+		}
+		block = SnapshotReader(data + position, blockLength);
+		position += blockLength;
+		return true;
+	}
+
+	size_t remaining() const { return length - position; }
+
+	/**
+	 * Did a read go past the end
+	 */
+	bool failed() const { return overflowed; }
+};
+
+/**
+ * Start of every snapshot. Values are in the byte order of the machine that saved it (snapshots are not meant to be moved).
+ */
+struct SnapshotHeader{
+	static constexpr uint32_t Magic = 0x53534841; // "AHSS"
+	static constexpr uint32_t CurrentVersion = 1;
+
+	enum Mode : uint32_t { Linear, Graph };
+
+	uint32_t magic;
+	uint32_t version;
+	uint64_t scriptFingerprint; // Hash of the script's rows (the same script must be loaded to restore)
+	uint32_t rowCount;
+	uint32_t bgCommandCount;
+	uint32_t mode;
+	uint32_t reserved;
+};
+
+/**
+ * A foreground command in a snapshot (followed by a block with what the command saved itself)
+ */
+struct SnapshotCommand{
+	static constexpr int64_t NoWake = INT64_MAX;
+
+	uint32_t row;
+	uint32_t creator;
+	uint8_t started;
+	uint8_t complete;
+	uint8_t sleeping;
+	uint8_t reserved;
+	uint32_t reserved2;
+	int64_t elapsed;  // Nanoseconds since the command started
+	int64_t timeout;  // Nanoseconds (0 for no timeout)
+	int64_t wakeIn;   // Nanoseconds until a sleeping command wakes (NoWake to wait for wake())
+};
+
+/**
+ * A background command in a snapshot (followed by a block with what the command saved itself)
+ */
+struct SnapshotBackground{
+	static constexpr uint32_t NoRow = UINT32_MAX;
+
+	uint32_t lastRow;   // Row the command last got its arguments from (NoRow if it has not had any)
+	uint8_t sleeping;
+	uint8_t reserved[3];
+	int64_t wakeIn;     // See SnapshotCommand::wakeIn
+};
+
+/**
+ * Double buffered snapshot storage in a memory mapped file (ex under /dev/shm), shared with the next run of the process.
+ * Each snapshot is written to the slot that is not published then published with one atomic store,
+ * so a process that dies while saving leaves the previous snapshot intact.
+ * The file outlives the process but not the machine losing power.
+ */
+class SnapshotBuffer{
+private:
+	struct Header{
+		static constexpr uint32_t Magic = 0x42534841; // "AHSB"
+		uint32_t magic;
+		uint32_t version;
+		uint64_t slotSize;
+		std::atomic<uint64_t> published; // Sequence number of the latest snapshot (0 for none). Its slot is sequence % 2.
+	};
+
+	struct SlotHeader{
+		uint64_t sequence;
+		uint64_t size;
+		uint64_t checksum;
+	};
+
+	uint8_t *mapping = nullptr;
+	size_t mappingSize = 0;
+	size_t slotSize = 0;
+	std::unique_ptr<uint8_t[]> buffer; // Used instead of a mapping on platforms without mmap
+	uint64_t dropped = 0;
+
+	Header *header() const { return reinterpret_cast<Header*>(mapping); }
+	SlotHeader *slotHeader(uint64_t sequence) const;
+
+public:
+	SnapshotBuffer(){}
+	SnapshotBuffer(const SnapshotBuffer&) = delete;
+	SnapshotBuffer &operator=(const SnapshotBuffer&) = delete;
+	~SnapshotBuffer();
+
+	/**
+	 * Map a snapshot file, creating it if needed. A snapshot saved in the file by an earlier run is kept.
+	 * @param fileName The full path to the file
+	 * @param slotSize The largest snapshot that can be saved
+	 * @return Was the file mapped
+	 */
+	bool open(const std::string &fileName, size_t slotSize = 64 * 1024);
+
+	/**
+	 * Unmap the file (the saved snapshot stays in it)
+	 */
+	void close();
+
+	bool isOpen() const { return mapping != nullptr; }
+
+	/**
+	 * Get the slot the next snapshot is written to (never the published one)
+	 * @param capacity Set to the size of the slot
+	 */
+	uint8_t *writeSlot(size_t &capacity);
+
+	/**
+	 * Publish the snapshot written to writeSlot
+	 * @param size The size of the snapshot
+	 */
+	void publish(size_t size);
+
+	/**
+	 * Get the latest published snapshot
+	 * @param data Set to the snapshot (valid until the next publish or close)
+	 * @param size Set to the size of the snapshot
+	 * @return false if there is no snapshot or it is damaged
+	 */
+	bool latest(const uint8_t *&data, size_t &size) const;
+
+	/**
+	 * Forget the published snapshot (ex when the script finished so the next run starts from the beginning)
+	 */
+	void clear();
+
+	/**
+	 * Count a snapshot that did not fit in a slot
+	 */
+	void recordDropped(){ dropped++; }
+
+	/**
+	 * Get the number of snapshots that did not fit in a slot
+	 */
+	uint64_t droppedCount() const { return dropped; }
+};
+
+}
@@ -0,0 +1,534 @@
+/**
+ * autostatic.hpp
+ * An AutoManager whose commands are fixed at compile time.
+ * Command names are looked up with a perfect hash built by the compiler, every command is stored inline
+ * (one instance per type, no allocation) and commands are called directly instead of through virtual functions.
+ *
+ * Copyright (c) 2018 FRC Team 2655 - The Flying Platypi
+ * See LICENSE file for details
+ */
+
+#pragma once
+
+#include "autonomous.hpp"
+
+#include <array>
+#include <tuple>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+
+namespace team2655{
+
+/**
+ * The names a command type is run with in a StaticAutoManager. A command declares either
+ *   static constexpr std::string_view Name = "drive";
+ * or
+ *   static constexpr std::string_view Names[] = { "intake_in", "intake_out", "intake_stop" };
+ * Names must be lowercase (script names are matched in lowercase).
+ */
+template<class T, class = void, class = void>
+struct StaticCommandNames{
+	static_assert(!std::is_same<T, T>::value, "StaticAutoManager commands need a static constexpr std::string_view Name (or Names[]).");
+	static constexpr size_t count = 0;
+	static constexpr std::string_view get(size_t){ return std::string_view(); }
+};
+
+template<class T>
+struct StaticCommandNames<T, std::void_t<decltype(T::Name)>, void>{
+	static constexpr size_t count = 1;
+	static constexpr std::string_view get(size_t){ return T::Name; }
+};
+
+template<class T>
+struct StaticCommandNames<T, void, std::void_t<decltype(T::Names)>>{
+	static constexpr size_t count = std::size(T::Names);
+	static constexpr std::string_view get(size_t i){ return T::Names[i]; }
+};
+
+/**
+ * Is a command a TypedAutoCommand / TypedBackgroundAutoCommand (start / updateArgs receive a tuple)
+ */
+template<class T, class... Ts>
+constexpr bool isTypedCommand(Args<Ts...>){
+	return std::is_base_of<TypedAutoCommand<Ts...>, T>::value || std::is_base_of<TypedBackgroundAutoCommand<Ts...>, T>::value;
+}
+
+template<class T, class = void>
+struct IsTypedCommand : std::false_type{};
+
+template<class T>
+struct IsTypedCommand<T, std::void_t<typename T::Arguments>> : std::bool_constant<isTypedCommand<T>(typename T::Arguments())>{};
+
+/**
+ * FNV-1a with a seed (the seed is searched for until no two names share a slot)
+ */
+constexpr uint32_t staticNameHash(std::string_view name, uint32_t seed){
+	uint32_t hash = 2166136261u ^ (seed * 16777619u);
+	for(char c : name){
+		hash ^= (uint8_t)c;
+		hash *= 16777619u;
+	}
+	return hash ^ (hash >> 16);
+}
+
+/**
+ * Perfect hash table from command names to values, built at compile time.
+ * Slots are a power of two at least 4x the number of names so a seed without collisions is found quickly.
+ * A lookup is one hash of the name, one slot and one string compare.
+ */
+template<size_t N>
+struct StaticNameTable{
+	struct Entry{
+		std::string_view name;
+		uint32_t value;
+	};
+
+	static constexpr size_t slotCount(){
+		size_t size = 1;
+		while(size < N * 4)
+			size <<= 1;
+		return size;
+	}
+	static constexpr size_t SlotCount = slotCount();
+	static constexpr uint32_t MaxSeed = 100000;
+
+	std::array<Entry, N> entries{};
+	std::array<uint32_t, SlotCount> slots{}; // Entry index + 1 (0 for an empty slot)
+	uint32_t seed = 0;
+	bool perfect = false; // A seed was found (never if two names are the same)
+
+	/**
+	 * Find the entry for a name
+	 * @param name The (lowercase) name
+	 * @return The index of the entry (-1 if no entry has the name)
+	 */
+	constexpr int find(std::string_view name) const {
+		uint32_t slot = slots[staticNameHash(name, seed) & (SlotCount - 1)];
+		if(slot == 0 || entries[slot - 1].name != name)
+			return -1;
+		return (int)slot - 1;
+	}
+
+	/**
+	 * Build the table
+	 * @param entries The names and their values
+	 */
+	static constexpr StaticNameTable build(const std::array<Entry, N> &entries){
+		StaticNameTable table;
+		table.entries = entries;
+		for(size_t i = 0; i < N; ++i){
+			for(size_t j = i + 1; j < N; ++j){
+				if(entries[i].name == entries[j].name)
+					return table; // Would collide with every seed
+			}
+		}
+		for(uint32_t seed = 0; seed < MaxSeed && !table.perfect; ++seed){
+			for(size_t i = 0; i < SlotCount; ++i){
+				table.slots[i] = 0;
+			}
+			bool collision = false;
+			for(size_t i = 0; i < N && !collision; ++i){
+				uint32_t &slot = table.slots[staticNameHash(entries[i].name, seed) & (SlotCount - 1)];
+				collision = slot != 0;
+				slot = (uint32_t)i + 1;
+			}
+			table.seed = seed;
+			table.perfect = !collision;
+		}
+		return table;
+	}
+};
+
+/**
+ * Runs scripts with a fixed set of command types (AutoCommand and BackgroundAutoCommand subclasses):
+ *   StaticAutoManager<DriveCommand, RotateCommand, IntakeCommand, LifterCommand> manager;
+ * Mistakes that AutoManager reports while registering (types that are not commands, duplicate or reserved names)
+ * fail to compile. Scripts that use names of no command fail to load instead of being skipped while running.
+ *
+ * Only one instance of each type exists, so scripts run top to bottom (groups and id= / after= annotations
+ * are not supported and fail the load). There is no profiler, telemetry, thread pool or injection.
+ * Calls made by the manager (start, process, handleComplete, reset and the background functions) are not virtual.
+ * Calls commands make themselves (complete()) are the same as with AutoManager.
+ */
+template<class... Commands>
+class StaticAutoManager{
+private:
+	typedef std::tuple<Commands...> CommandTuple;
+	typedef std::index_sequence_for<Commands...> Indices;
+
+	static constexpr uint32_t NoCommand = (uint32_t)-1;
+	static constexpr size_t NameCount = (StaticCommandNames<Commands>::count + ... + 0);
+
+	template<class T>
+	static constexpr bool isBackground = std::is_base_of<BackgroundAutoCommand, T>::value;
+
+	static_assert(sizeof...(Commands) > 0, "StaticAutoManager needs at least one command.");
+	static_assert(((std::is_base_of<AutoCommand, Commands>::value != std::is_base_of<BackgroundAutoCommand, Commands>::value) && ...),
+			"Every StaticAutoManager command must be an AutoCommand or a BackgroundAutoCommand.");
+	static_assert((!std::is_abstract<Commands>::value && ...), "A StaticAutoManager command does not implement every pure virtual function.");
+	static_assert((std::is_default_constructible<Commands>::value && ...), "StaticAutoManager commands must be default constructible.");
+
+	typedef StaticNameTable<NameCount> NameTable;
+
+	template<size_t I>
+	static constexpr void addNames(std::array<typename NameTable::Entry, NameCount> &entries, size_t &count){
+		typedef StaticCommandNames<std::tuple_element_t<I, CommandTuple>> Names;
+		for(size_t i = 0; i < Names::count; ++i){
+			entries[count++] = { Names::get(i), (uint32_t)I };
+		}
+	}
+
+	template<size_t... Is>
+	static constexpr std::array<typename NameTable::Entry, NameCount> collectNames(std::index_sequence<Is...>){
+		std::array<typename NameTable::Entry, NameCount> entries{};
+		size_t count = 0;
+		(addNames<Is>(entries, count), ...);
+		return entries;
+	}
+
+	static constexpr bool validNames(){
+		std::array<typename NameTable::Entry, NameCount> entries = collectNames(Indices());
+		for(size_t i = 0; i < NameCount; ++i){
+			std::string_view name = entries[i].name;
+			if(name.empty() || AutoOpcode::isBuiltin(name))
+				return false;
+			for(char c : name){
+				if((c >= 'A' && c <= 'Z') || c == ',' || c == '"')
+					return false;
+			}
+		}
+		return true;
+	}
+
+	static_assert(validNames(), "StaticAutoManager command names must be lowercase, not empty and not part of the script language.");
+
+	static constexpr NameTable names = NameTable::build(collectNames(Indices()));
+	static_assert(names.perfect, "Two StaticAutoManager commands have the same name (or no perfect hash was found for the names).");
+
+	// Frames of coroutine commands (see autocoroutine.hpp). Declared first so it outlives every command.
+	FramePool framePool;
+
+	CommandTuple commands;
+	std::vector<ArgSchemaPointer> commandSchemas;   // Per command type (nullptr for background commands and raw text arguments)
+	std::vector<ArgSchemaPointer> bgCommandSchemas; // Per command type (nullptr for commands and raw text arguments)
+
+	AutoScript script;
+	size_t currentCommandIndex = -1;
+	uint32_t currentCommand = NoCommand; // Type of the running command
+	AutoClock *clock = &SteadyAutoClock::instance();
+	AutoTime tickTime{0};
+
+	/**
+	 * Call f with the command of a type
+	 * @param index Index of the type in Commands
+	 */
+	template<class F, size_t... Is>
+	void dispatch(uint32_t index, F &&f, std::index_sequence<Is...>){
+		(void)((index == Is && (f(std::get<Is>(commands)), true)) || ...);
+	}
+
+	template<class F>
+	void dispatch(uint32_t index, F &&f){
+		dispatch(index, f, Indices());
+	}
+
+	template<class T>
+	void completeCommand(T &command){
+		static_cast<AutoCommand&>(command)._isComplete = true;
+		command.T::handleComplete();
+	}
+
+	template<class T>
+	void runCommand(T &command){
+		if constexpr(!isBackground<T>){
+			AutoCommand &state = command;
+			if(state.sleeping){
+				// Wake for the deadline, the timeout or an explicit wake
+				AutoTime deadline = state.wakeTime;
+				if(state.timeout > AutoTime(0))
+					deadline = std::min(deadline, state.startTime + state.timeout);
+				if(tickTime < deadline && !(state.wakeRequested.load(std::memory_order_relaxed) && state.wakeRequested.exchange(false)))
+					return;
+				state.sleeping = false;
+			}
+
+			FramePool::Scope frames(framePool);
+			if(!state._hasStarted){
+				const ScriptRow &row = script.row(currentCommandIndex);
+				std::string_view name = script.name(row.nameId);
+				state.setStarted(name, row.arguments(), tickTime);
+				if constexpr(IsTypedCommand<T>::value)
+					command.T::start(name, *static_cast<const typename T::Arguments::Tuple*>(row.parsed));
+				else
+					command.T::start(name, row.arguments());
+				if(!state.sleeping)
+					command.T::process();
+			}else{
+				state.tickTime = tickTime;
+				if(state.hasTimedOut())
+					completeCommand(command);
+				if(state._isComplete)
+					return;
+				command.T::process();
+			}
+		}
+	}
+
+	template<class T>
+	bool isCommandComplete(T &command){
+		if constexpr(!isBackground<T>)
+			return static_cast<AutoCommand&>(command)._isComplete;
+		return true;
+	}
+
+	template<class T>
+	void endCommand(T &command, bool cancel){
+		if constexpr(!isBackground<T>){
+			AutoCommand &state = command;
+			if(cancel && !state._isComplete)
+				completeCommand(command);
+			state.clearState();
+			command.T::reset();
+		}
+	}
+
+	template<class T>
+	void updateBgCommand(T &command, const ScriptRow &row){
+		if constexpr(isBackground<T>){
+			BackgroundAutoCommand &state = command;
+			std::string_view name = script.name(row.nameId);
+			state.sleeping = false; // New arguments always wake the command
+			state.tickTime = tickTime;
+			if constexpr(IsTypedCommand<T>::value)
+				command.T::updateArgs(name, *static_cast<const typename T::Arguments::Tuple*>(row.parsed));
+			else
+				command.T::updateArgs(name, row.arguments());
+		}
+	}
+
+	template<class T>
+	void processBgCommand(T &command){
+		if constexpr(isBackground<T>){
+			BackgroundAutoCommand &state = command;
+			if(state.sleeping){
+				if(tickTime < state.wakeTime && !(state.wakeRequested.load(std::memory_order_relaxed) && state.wakeRequested.exchange(false)))
+					return;
+				state.sleeping = false;
+			}
+			if(!command.T::shouldProcess())
+				return;
+			state.tickTime = tickTime;
+			command.T::process();
+		}
+	}
+
+	template<class T>
+	void killBgCommand(T &command){
+		if constexpr(isBackground<T>)
+			command.T::kill();
+	}
+
+	template<size_t... Is>
+	void processBgCommands(std::index_sequence<Is...>){
+		(processBgCommand(std::get<Is>(commands)), ...);
+	}
+
+	template<size_t... Is>
+	void killBgCommands(std::index_sequence<Is...>){
+		(killBgCommand(std::get<Is>(commands)), ...);
+	}
+
+	void makeSchemas(){
+		(commandSchemas.push_back(isBackground<Commands> ? ArgSchemaPointer() : ArgSchemaFor<Commands>::make()), ...);
+		(bgCommandSchemas.push_back(isBackground<Commands> ? ArgSchemaFor<Commands>::make() : ArgSchemaPointer()), ...);
+	}
+
+	/**
+	 * End the running command (if any) so the next row can use its type
+	 * @param cancel Complete the command first if it has not completed
+	 */
+	void endCurrentCommand(bool cancel){
+		if(currentCommand == NoCommand)
+			return;
+		dispatch(currentCommand, [&](auto &command){ endCommand(command, cancel); });
+		currentCommand = NoCommand;
+	}
+
+	/**
+	 * Update the background commands of the rows at the current row (if any)
+	 */
+	void handleNextBgCommands(){
+		while(currentCommandIndex < script.size() && script.row(currentCommandIndex).opcode.kind == AutoOpcode::Background){
+			const ScriptRow &row = script.row(currentCommandIndex);
+			dispatch(row.opcode.index, [&](auto &command){ updateBgCommand(command, row); });
+			currentCommandIndex++;
+		}
+	}
+
+	/**
+	 * Resolve every row and reject rows this manager cannot run
+	 * @return false if any row has invalid arguments, no command or is a group marker, or the script uses annotations
+	 */
+	bool resolveScript(const std::string &fileName){
+		bool valid = resolveScriptRows(script, [](std::string_view name){ return resolveName(name); }, commandSchemas, bgCommandSchemas);
+		for(size_t i = 0; i < script.size(); ++i){
+			const ScriptRow &row = script.row(i);
+			if(row.opcode.kind == AutoOpcode::Unknown){
+				std::cerr << "Script file: \"" << fileName << "\" row " << (i + 1) << ": no command is named \"" << script.name(row.nameId) << "\"." << std::endl;
+				valid = false;
+			}else if(row.opcode.kind == AutoOpcode::GroupBegin || row.opcode.kind == AutoOpcode::GroupEnd){
+				std::cerr << "Script file: \"" << fileName << "\" row " << (i + 1) << ": groups are not supported by StaticAutoManager." << std::endl;
+				valid = false;
+			}
+		}
+		if(script.graph().enabled){
+			std::cerr << "Script file: \"" << fileName << "\" uses id= / after= annotations (not supported by StaticAutoManager)." << std::endl;
+			valid = false;
+		}
+		return valid;
+	}
+
+public:
+	StaticAutoManager(){
+		makeSchemas();
+	}
+
+	StaticAutoManager(const StaticAutoManager&) = delete;
+	StaticAutoManager &operator=(const StaticAutoManager&) = delete;
+
+	/**
+	 * Get the number of names commands can be run with
+	 */
+	static constexpr size_t nameCount(){ return NameCount; }
+
+	/**
+	 * Resolve a (lowercase) command name. Usable at compile time.
+	 * @param name The command name
+	 * @return The opcode for the name (index is the position of the type in Commands, Unknown for no command)
+	 */
+	static constexpr AutoOpcode resolveName(std::string_view name){
+		AutoOpcode opcode;
+		int entry = names.find(name);
+		if(entry >= 0){
+			bool background[] = { isBackground<Commands>... };
+			opcode.index = names.entries[entry].value;
+			opcode.kind = background[opcode.index] ? AutoOpcode::Background : AutoOpcode::Command;
+		}
+		return opcode;
+	}
+
+	/**
+	 * Get the instance of a command type
+	 */
+	template<class T>
+	T &command(){ return std::get<T>(commands); }
+
+	/**
+	 * Load an autonomous script (CSV or compiled with AutoCompile) from the script path
+	 * @param fileName The full path to the script to load
+	 * @return Was the script successfully loaded (false if the file cannot be read or a row cannot be run)
+	 */
+	bool loadScript(const std::string &fileName){
+		clearCommands();
+		if(!script.load(fileName))
+			return false;
+		if(!resolveScript(fileName)){
+			std::cerr << "Script file: \"" << fileName << "\" cannot be run by this StaticAutoManager." << std::endl;
+			clearCommands();
+			return false;
+		}
+		return true;
+	}
+
+	/**
+	 * Remove all loaded commands
+	 */
+	void clearCommands(){
+		killAuto();
+		script.clear();
+		currentCommandIndex = -1;
+	}
+
+	/**
+	 * Run the loaded script again from the first command.
+	 * Ends the current command and all background commands first.
+	 */
+	void restartScript(){
+		killAuto();
+		currentCommandIndex = -1;
+	}
+
+	/**
+	 * Get the number of loaded commands
+	 */
+	size_t loadedCommandCount() const { return script.size(); }
+
+	/**
+	 * Set the clock used for command timing (steady_clock by default)
+	 * @param clock The clock. Must outlive the manager. nullptr restores the default clock.
+	 */
+	void setClock(AutoClock *clock){
+		this->clock = (clock == nullptr) ? &SteadyAutoClock::instance() : clock;
+	}
+
+	/**
+	 * Get the clock used for command timing
+	 */
+	AutoClock &getClock(){ return *clock; }
+
+	/**
+	 * Process the autonomous commands (see AutoManager::process)
+	 * @return True if there are any commands (excluding background commands) that have not finished
+	 */
+	bool process(){
+		return process(clock->now());
+	}
+
+	/**
+	 * Process the autonomous commands at a given time instead of sampling the clock
+	 * @param now The time of this tick
+	 * @return True if there are any commands (excluding background commands) that have not finished
+	 */
+	bool process(AutoTime now){
+		if(script.size() < 1)
+			return false;
+		tickTime = now;
+
+		bool result = true;
+		bool complete = true;
+		if(currentCommand != NoCommand)
+			dispatch(currentCommand, [&](auto &command){ complete = isCommandComplete(command); });
+		if(complete){
+			// Move on to the next command
+			currentCommandIndex++;
+			endCurrentCommand(false);
+			handleNextBgCommands();
+			if(currentCommandIndex >= script.size()){
+				// Still needs to reach processing of bg commands
+				result = false;
+				currentCommandIndex = script.size();
+			}else{
+				currentCommand = script.row(currentCommandIndex).opcode.index; // Every row was checked to be a command when loading
+			}
+		}
+
+		if(currentCommand != NoCommand)
+			dispatch(currentCommand, [&](auto &command){ runCommand(command); });
+
+		processBgCommands(Indices());
+		return result;
+	}
+
+	/**
+	 * End the current command and all background commands
+	 * Calls complete so that everything ends properly then moves to the end of the script
+	 */
+	void killAuto(){
+		endCurrentCommand(true);
+		currentCommandIndex = script.size();
+		killBgCommands(Indices());
+	}
+};
+
+}
@@ -0,0 +1,160 @@
+/**
+ * autotelemetry.hpp
+ * Binary log of script execution (ticks, command starts and ends, background updates).
+ * The control thread writes events into a ring buffer without locking and a writer thread saves them to a file.
+ * Decode logs with the AutoTelemetry tool.
+ *
+ * Copyright (c) 2018 FRC Team 2655 - The Flying Platypi
+ * See LICENSE file for details
+ */
+
+#pragma once
+
+#include "autoclock.hpp"
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <fstream>
+#include <cstdint>
+
+namespace team2655{
+
+/**
+ * One record of a telemetry log. Files are a TelemetryHeader followed by records.
+ */
+struct TelemetryEvent{
+	enum Type : uint16_t{
+		Tick = 1,          // Start of a tick
+		CommandStart,      // index = creator
+		CommandComplete,   // The command completed itself
+		CommandTimeout,    // The command reached its timeout
+		CommandCancelled,  // Completed by its group ending or killAuto
+		CommandSkipped,    // Row has no registered command or invalid arguments
+		BackgroundUpdate,  // index = background command
+		Name,              // index = name id, nameId = length of the name which follows (padded to 8 bytes)
+		Dropped            // nameId = events dropped so far because the ring buffer was full
+	};
+
+	uint16_t type;
+	uint16_t reserved;
+	uint32_t index;
+	uint32_t row;      // Script row
+	uint32_t nameId;   // Name of the row (see Name records)
+	int64_t time;      // Tick time in nanoseconds (AutoManager clock)
+};
+static_assert(sizeof(TelemetryEvent) == 24, "Telemetry records must have a fixed layout");
+
+struct TelemetryHeader{
+	static constexpr uint32_t Magic = 0x4C544841; // "AHTL" in a little endian file
+	static constexpr uint32_t ByteOrderMark = 0x01020304;
+	static constexpr uint32_t CurrentVersion = 1;
+
+	uint32_t magic;
+	uint32_t byteOrder;
+	uint32_t version;
+	uint32_t eventSize;
+};
+
+/**
+ * Telemetry log for one AutoManager. Only one thread may record events (the thread processing the manager).
+ * Recording never blocks, allocates or touches the file. If the writer falls behind events are dropped and counted.
+ */
+class TelemetryLog{
+private:
+	std::unique_ptr<TelemetryEvent[]> ring;
+	size_t mask = 0;
+	alignas(64) std::atomic<uint64_t> head{0}; // Next event to write (control thread)
+	alignas(64) std::atomic<uint64_t> tail{0}; // Next event to save (writer thread)
+	std::atomic<uint64_t> dropped{0};
+
+	std::mutex namesMutex;
+	std::vector<std::pair<uint32_t, std::string>> pendingNames; // Saved before the events that use them
+
+	std::ofstream file;
+	std::thread writer;
+	std::atomic<bool> stopping{false};
+	uint64_t droppedWritten = 0;
+
+	void run();
+	void save();
+
+public:
+	TelemetryLog(){}
+	~TelemetryLog();
+	TelemetryLog(const TelemetryLog&) = delete;
+	TelemetryLog &operator=(const TelemetryLog&) = delete;
+
+	/**
+	 * Start logging to a file (replacing it)
+	 * @param fileName The file to write
+	 * @param capacity The number of events the ring buffer holds (rounded up to a power of two)
+	 * @return false if the file cannot be opened
+	 */
+	bool open(const std::string &fileName, size_t capacity = 65536);
+
+	/**
+	 * Save every recorded event and close the file
+	 */
+	void close();
+
+	bool isOpen() const { return ring != nullptr; }
+
+	/**
+	 * Record an event (dropped if the ring buffer is full)
+	 */
+	void record(TelemetryEvent::Type type, uint32_t index, uint32_t row, uint32_t nameId, AutoTime time){
+		if(ring == nullptr)
+			return;
+		uint64_t position = head.load(std::memory_order_relaxed);
+		if(position - tail.load(std::memory_order_acquire) > mask){
+			dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		TelemetryEvent &event = ring[position & mask];
+		event.type = type;
+		event.reserved = 0;
+		event.index = index;
+		event.row = row;
+		event.nameId = nameId;
+		event.time = time.count();
+		head.store(position + 1, std::memory_order_release);
+	}
+
+	/**
+	 * Give a name id a name. Saved before any event recorded after this call. Takes a lock (not for every tick).
+	 */
+	void setName(uint32_t nameId, std::string_view name);
+
+	/**
+	 * Get the number of events dropped because the ring buffer was full
+	 */
+	uint64_t droppedEvents() const { return dropped.load(std::memory_order_relaxed); }
+};
+
+/**
+ * A decoded record. name is set for Name records.
+ */
+struct TelemetryRecord{
+	TelemetryEvent event;
+	std::string name;
+};
+
+/**
+ * Read a telemetry log
+ * @param fileName The log file
+ * @param records The records in the order they were saved
+ * @return false if the file cannot be read or is not a telemetry log
+ */
+bool readTelemetry(const std::string &fileName, std::vector<TelemetryRecord> &records);
+
+/**
+ * Get the readable name of an event type
+ */
+const char *telemetryTypeName(uint16_t type);
+
+}
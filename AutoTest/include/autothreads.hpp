@@ -0,0 +1,119 @@
+/**
+ * autothreads.hpp
+ * Work stealing thread pool used to run AutoManagers (and their background commands) in parallel
+ *
+ * Copyright (c) 2018 FRC Team 2655 - The Flying Platypi
+ * See LICENSE file for details
+ */
+
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include <cstddef>
+
+namespace team2655{
+
+/**
+ * Counts outstanding tasks so a thread can wait for a set of tasks to finish
+ */
+class TaskGroup{
+private:
+	friend class WorkStealingPool;
+	std::atomic<size_t> remaining{0};
+
+public:
+	/**
+	 * Are all tasks in the group done
+	 */
+	bool done() const { return remaining.load(std::memory_order_acquire) == 0; }
+};
+
+/**
+ * A fixed set of worker threads, each with its own task queue.
+ * Workers run their own newest task first and steal the oldest task from other workers when they run out.
+ * Submitting and running tasks does not allocate once the queues have grown to their working size.
+ */
+class WorkStealingPool{
+private:
+	struct Task{
+		void (*run)(void *context);
+		void *context;
+		TaskGroup *group;
+	};
+
+	// Growable ring buffer of tasks protected by a mutex
+	struct Worker{
+		std::mutex mutex;
+		std::vector<Task> tasks;
+		size_t head = 0;   // Oldest task (stolen from here)
+		size_t count = 0;
+
+		void push(const Task &task);
+		bool popNewest(Task &task);
+		bool popOldest(Task &task);
+	};
+
+	std::vector<std::unique_ptr<Worker>> workers;
+	std::vector<std::thread> threads;
+	std::atomic<size_t> pending{0};      // Tasks queued but not yet taken
+	std::atomic<size_t> nextWorker{0};   // Round robin target for tasks submitted from outside the pool
+	std::atomic<bool> stopping{false};
+	std::mutex sleepMutex;
+	std::condition_variable sleepCondition;
+	std::mutex doneMutex;                 // Threads outside the pool wait for groups with doneCondition
+	std::condition_variable doneCondition; // Notified when the last task of a group finishes
+
+	void workerLoop(size_t index);
+	bool takeTask(size_t preferred, Task &task);
+	void runTask(const Task &task);
+	void submitTask(const Task &task);
+
+	template<class F>
+	static void invoke(void *context){
+		(*static_cast<F*>(context))();
+	}
+
+public:
+	/**
+	 * @param threadCount Number of worker threads (0 for one per hardware thread)
+	 */
+	WorkStealingPool(size_t threadCount = 0);
+	~WorkStealingPool();
+
+	WorkStealingPool(const WorkStealingPool&) = delete;
+	WorkStealingPool &operator=(const WorkStealingPool&) = delete;
+
+	/**
+	 * Get the number of worker threads
+	 */
+	size_t size() const { return threads.size(); }
+
+	/**
+	 * Run a function on the pool as part of a group.
+	 * The function is referenced, not copied, so it must stay alive until the group is waited on.
+	 * @param group The group the task belongs to
+	 * @param fn The function to run
+	 */
+	template<class F>
+	void submit(TaskGroup &group, F &fn){
+		Task task;
+		task.run = &invoke<F>;
+		task.context = &fn;
+		task.group = &group;
+		submitTask(task);
+	}
+
+	/**
+	 * Wait for every task in a group to finish. The calling thread runs queued tasks while it waits.
+	 * Once there are none left a thread outside the pool sleeps until the group finishes.
+	 * @param group The group to wait for
+	 */
+	void wait(TaskGroup &group);
+};
+
+}
@@ -0,0 +1,190 @@
+/**
+ * autoanalysis.cpp
+ * See autoanalysis.hpp for details.
+ *
+ * Copyright (c) 2018 FRC Team 2655 - The Flying Platypi
+ * See LICENSE file for details
+ */
+
+#include "autoanalysis.hpp"
+
+#include <iostream>
+#include <algorithm>
+#include <limits>
+
+using namespace team2655;
+
+namespace{
+
+const uint64_t Unbounded = std::numeric_limits<uint64_t>::max();
+
+uint64_t addTicks(uint64_t a, uint64_t b){
+	return (a == Unbounded || b == Unbounded) ? Unbounded : a + b;
+}
+
+class Analyzer{
+private:
+	const AutoScript &script;
+	const std::vector<CmdTimeoutBound> &commandTimeouts;
+	AutoTime period;
+
+public:
+	ScriptAnalysis result;
+
+	Analyzer(const AutoScript &script, const std::vector<CmdTimeoutBound> &commandTimeouts, AutoTime period) :
+			script(script), commandTimeouts(commandTimeouts), period(period){
+		result.unboundedRow = script.size();
+	}
+
+	/**
+	 * Ticks from a command row starting to the next row starting (Unbounded if the command has no timeout bound)
+	 */
+	uint64_t commandTicks(const ScriptRow &row) const{
+		CmdTimeoutBound bound = (row.opcode.index < commandTimeouts.size()) ? commandTimeouts[row.opcode.index] : nullptr;
+		if(bound == nullptr)
+			return Unbounded;
+		AutoTime timeout = bound(row.arguments());
+		if(timeout == AutoTime::max())
+			return Unbounded;
+		timeout = std::max(timeout, AutoTime(1)); // The AutoManager never uses a bound below 1ns (0 is no timeout)
+		uint64_t ticks = (uint64_t)(timeout.count() / period.count()) + ((timeout.count() % period.count()) != 0);
+		return ticks + 1;
+	}
+
+	/**
+	 * Ticks a row holds up the rows after it (0 for background rows and rows that cannot run)
+	 */
+	uint64_t rowTicks(size_t rowIndex) const{
+		const ScriptRow &row = script.row(rowIndex);
+		return (row.opcode.kind == AutoOpcode::Command) ? commandTicks(row) : 0;
+	}
+
+	/**
+	 * Report rows that have no registered command. Rows with invalid arguments were reported when the script was resolved.
+	 */
+	void checkRows(){
+		for(size_t i = 0; i < script.size(); ++i){
+			const ScriptRow &row = script.row(i);
+			if(row.opcode.kind == AutoOpcode::Unknown)
+				std::cerr << "Script row " << (i + 1) << " (\"" << script.name(row.nameId) << "\"): no command is registered with this name" << std::endl;
+			if(row.opcode.kind == AutoOpcode::Unknown || row.opcode.kind == AutoOpcode::Invalid)
+				result.valid = false;
+		}
+	}
+
+	void markUnbounded(size_t rowIndex){
+		result.unboundedRow = std::min(result.unboundedRow, rowIndex);
+	}
+
+	/**
+	 * Ticks of the group starting at a row (moves the row to the group's end row)
+	 */
+	uint64_t groupTicks(size_t &rowIndex){
+		size_t begin = rowIndex;
+		uint32_t kind = script.row(begin).opcode.index;
+		uint64_t ticks = 1; // A group without commands finishes right away
+		size_t unboundedMember = script.size();
+		bool first = true;
+		for(rowIndex++; rowIndex < script.size() && script.row(rowIndex).opcode.kind != AutoOpcode::GroupEnd; rowIndex++){
+			if(script.row(rowIndex).opcode.kind != AutoOpcode::Command)
+				continue;
+			uint64_t memberTicks = rowTicks(rowIndex);
+			if(memberTicks == Unbounded)
+				unboundedMember = std::min(unboundedMember, rowIndex);
+			if(first)
+				ticks = memberTicks;
+			else if(kind == AutoOpcode::Parallel)
+				ticks = std::max(ticks, memberTicks);
+			else if(kind == AutoOpcode::Race)
+				ticks = std::min(ticks, memberTicks);
+			first = false; // Deadline groups keep the first command's ticks
+		}
+		if(ticks == Unbounded)
+			markUnbounded(kind == AutoOpcode::Parallel ? unboundedMember : begin);
+		return ticks;
+	}
+
+	void analyzeLinear(){
+		uint64_t total = 0;
+		for(size_t i = 0; i < script.size(); ++i){
+			uint64_t ticks;
+			if(script.row(i).opcode.kind == AutoOpcode::GroupBegin){
+				ticks = groupTicks(i);
+			}else{
+				ticks = rowTicks(i);
+				if(ticks == Unbounded)
+					markUnbounded(i);
+			}
+			total = addTicks(total, ticks);
+		}
+		result.worstCaseTicks = total;
+	}
+
+	void analyzeGraph(){
+		// Longest chain of dependencies. Rows start the tick after the last row they run after finishes.
+		const ScriptGraph &graph = script.graph();
+		std::vector<uint32_t> waiting = graph.dependencyCount;
+		std::vector<uint64_t> startTick(script.size(), 0);
+		std::vector<uint32_t> ready(graph.roots.begin(), graph.roots.end());
+		uint64_t longest = 0;
+		for(size_t r = 0; r < ready.size(); ++r){
+			uint32_t rowIndex = ready[r];
+			uint64_t ticks = rowTicks(rowIndex);
+			if(ticks == Unbounded)
+				markUnbounded(rowIndex);
+			uint64_t finish = addTicks(startTick[rowIndex], ticks);
+			// The run ends on the tick its last command finishes, not the tick after it (when dependents would start)
+			longest = std::max(longest, (ticks == 0 || finish == Unbounded) ? finish : finish - 1);
+			for(uint32_t d = graph.dependentStart[rowIndex]; d < graph.dependentStart[rowIndex + 1]; ++d){
+				uint32_t dependent = graph.dependents[d];
+				startTick[dependent] = std::max(startTick[dependent], finish);
+				if(--waiting[dependent] == 0)
+					ready.push_back(dependent);
+			}
+		}
+		result.worstCaseTicks = longest;
+	}
+};
+
+}
+
+ScriptAnalysis team2655::analyzeScript(const AutoScript &script, const std::vector<CmdTimeoutBound> &commandTimeouts, AutoTime period){
+	Analyzer analyzer(script, commandTimeouts, period);
+	analyzer.checkRows();
+	if(script.graph().enabled)
+		analyzer.analyzeGraph();
+	else
+		analyzer.analyzeLinear();
+
+	ScriptAnalysis &result = analyzer.result;
+	result.bounded = result.worstCaseTicks != Unbounded;
+	if(result.bounded){
+		result.worstCase = period * (int64_t)result.worstCaseTicks;
+	}else{
+		result.worstCaseTicks = 0;
+		result.worstCase = AutoTime::max();
+	}
+	return result;
+}
+
+bool team2655::checkScriptAnalysis(const ScriptAnalysis &analysis, const AutoScript &script, const std::string &fileName, AutoTime durationLimit){
+	if(!analysis.valid){
+		std::cerr << "Script file: \"" << fileName << "\" has rows that cannot run." << std::endl;
+		return false;
+	}
+	if(durationLimit <= AutoTime(0))
+		return true;
+
+	if(!analysis.bounded){
+		const ScriptRow &row = script.row(analysis.unboundedRow);
+		std::cerr << "Script file: \"" << fileName << "\" row " << (analysis.unboundedRow + 1) << " (\"" << script.name(row.nameId) <<
+				"\"): the command has no timeout bound so the script may not finish in time." << std::endl;
+		return false;
+	}
+	if(analysis.worstCase > durationLimit){
+		std::cerr << "Script file: \"" << fileName << "\" can run for " << std::chrono::duration<double>(analysis.worstCase).count() <<
+				"s (the limit is " << std::chrono::duration<double>(durationLimit).count() << "s)." << std::endl;
+		return false;
+	}
+	return true;
+}
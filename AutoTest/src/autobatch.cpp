@@ -0,0 +1,209 @@
+/**
+ * autobatch.cpp
+ * See autobatch.hpp for details.
+ *
+ * Copyright (c) 2018 FRC Team 2655 - The Flying Platypi
+ * See LICENSE file for details
+ */
+
+#include "autobatch.hpp"
+#include "autoargs.hpp"
+
+#include <iostream>
+#include <algorithm>
+
+using namespace team2655;
+
+bool AutoBatch::checkRegisterName(std::string &name) const{
+	std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+
+	if(AutoOpcode::builtin(name).kind != AutoOpcode::Unknown){
+		std::cerr << "Cannot register command with name \"" << name << "\". The name is part of the script language." << std::endl;
+		return false;
+	}
+	if(registrations.find(name) != registrations.end()){
+		std::cerr << "Cannot register command with name \"" << name << "\". A command is already registered with that name." << std::endl;
+		return false;
+	}
+	return true;
+}
+
+bool AutoBatch::loadScript(const std::string &fileName){
+	script.clear();
+	rows.clear();
+	scriptValues.clear();
+	if(!script.load(fileName))
+		return false;
+
+	bool valid = true;
+	for(size_t i = 0; i < script.size(); ++i){
+		const ScriptRow &row = script.row(i);
+		std::string_view name = script.name(row.nameId);
+		auto it = registrations.find(std::string(name));
+		if(it == registrations.end()){
+			std::cerr << "Script file: \"" << fileName << "\" row " << (i + 1) << ": no batch command is named \"" << name << "\"." << std::endl;
+			valid = false;
+			continue;
+		}
+
+		BatchRow batchRow;
+		batchRow.background = it->second.background;
+		batchRow.command = it->second.command;
+		batchRow.firstColumn = (uint32_t)scriptValues.size();
+		batchRow.argCount = row.argCount;
+		size_t expected = batchRow.background ? bgCommands[batchRow.command]->argumentCount() : commands[batchRow.command]->argumentCount();
+		if(row.argCount != expected){
+			std::cerr << "Script file: \"" << fileName << "\" row " << (i + 1) << " (\"" << name << "\"): expected " << expected <<
+					" argument(s) but got " << row.argCount << "." << std::endl;
+			valid = false;
+		}
+		for(size_t arg = 0; arg < row.argCount; ++arg){
+			double value = 0;
+			if(!parseArg(row.args[arg], value)){
+				std::cerr << "Script file: \"" << fileName << "\" row " << (i + 1) << " (\"" << name << "\"): argument " << (arg + 1) <<
+						" (\"" << row.args[arg] << "\") is not a number." << std::endl;
+				valid = false;
+			}
+			scriptValues.push_back(value);
+		}
+		rows.push_back(batchRow);
+	}
+
+	if(!valid){
+		script.clear();
+		rows.clear();
+		scriptValues.clear();
+	}
+	setInstances(instances);
+	return valid;
+}
+
+void AutoBatch::setInstances(size_t count){
+	instances = count;
+	columns.resize(scriptValues.size());
+	columnPointers.resize(scriptValues.size());
+	for(size_t i = 0; i < columns.size(); ++i){
+		columns[i].assign(count, scriptValues[i]);
+		columnPointers[i] = columns[i].data();
+	}
+
+	nextRow.assign(count, 0);
+	runningCommand.assign(count, 0);
+	advance.assign(count, 0);
+	finished.assign(count, 0);
+	finishTicks.assign(count, NotFinished);
+	mask.assign(count, 0);
+	reached.reserve(count);
+}
+
+double *AutoBatch::argument(size_t row, size_t arg){
+	if(row >= rows.size() || arg >= rows[row].argCount)
+		return nullptr;
+	return columns[rows[row].firstColumn + arg].data();
+}
+
+void AutoBatch::startReachedRows(){
+	// Instances were added in order so a stable sort keeps each row's instances in order
+	std::stable_sort(reached.begin(), reached.end(), [](const std::pair<uint32_t, uint32_t> &a, const std::pair<uint32_t, uint32_t> &b){
+		return a.first < b.first;
+	});
+	for(size_t first = 0; first < reached.size();){
+		uint32_t rowIndex = reached[first].first;
+		size_t last = first;
+		for(; last < reached.size() && reached[last].first == rowIndex; ++last){
+			mask[reached[last].second] = 1;
+		}
+
+		const BatchRow &row = rows[rowIndex];
+		std::string_view name = script.name(script.row(rowIndex).nameId);
+		BatchArgs args(columnPointers.data() + row.firstColumn, row.argCount);
+		if(row.background){
+			bgCommands[row.command]->update(name, args, mask.data());
+		}else{
+			commands[row.command]->start(name, args, mask.data());
+			std::vector<uint8_t> &running = runningMasks[row.command];
+			for(size_t i = first; i < last; ++i){
+				running[reached[i].second] = 1;
+			}
+			runningCounts[row.command] += last - first;
+		}
+
+		for(size_t i = first; i < last; ++i){
+			mask[reached[i].second] = 0;
+		}
+		first = last;
+	}
+}
+
+size_t AutoBatch::run(size_t maxTicks){
+	for(auto &command : commands){
+		command->resize(instances, period);
+	}
+	for(auto &command : bgCommands){
+		command->resize(instances, period);
+	}
+	std::fill(nextRow.begin(), nextRow.end(), 0);
+	std::fill(advance.begin(), advance.end(), 1);
+	std::fill(finished.begin(), finished.end(), 0);
+	std::fill(finishTicks.begin(), finishTicks.end(), NotFinished);
+	runningMasks.resize(commands.size());
+	for(std::vector<uint8_t> &running : runningMasks){
+		running.assign(instances, 0);
+	}
+	runningCounts.assign(commands.size(), 0);
+
+	size_t remaining = instances;
+	size_t tick = 0;
+	for(; tick < maxTicks && remaining > 0; ++tick){
+		// Instances whose command finished last tick move on (updating background commands on the way)
+		reached.clear();
+		for(size_t i = 0; i < instances; ++i){
+			if(!advance[i])
+				continue;
+			advance[i] = 0;
+			uint32_t row = nextRow[i];
+			while(row < rows.size() && rows[row].background){
+				reached.emplace_back(row, (uint32_t)i);
+				row++;
+			}
+			if(row < rows.size()){
+				reached.emplace_back(row, (uint32_t)i);
+				runningCommand[i] = rows[row].command;
+				row++;
+			}else{
+				finishTicks[i] = (uint32_t)tick;
+				remaining--;
+			}
+			nextRow[i] = row;
+		}
+		if(!reached.empty())
+			startReachedRows();
+
+		// Each command processes all of its instances at once
+		bool anyRunning = false;
+		for(size_t c = 0; c < commands.size(); ++c){
+			if(runningCounts[c] > 0){
+				commands[c]->process(runningMasks[c].data(), finished.data());
+				anyRunning = true;
+			}
+		}
+		if(anyRunning){
+			for(size_t i = 0; i < instances; ++i){
+				if(!finished[i])
+					continue;
+				finished[i] = 0;
+				uint32_t command = runningCommand[i];
+				if(runningMasks[command][i]){
+					runningMasks[command][i] = 0;
+					runningCounts[command]--;
+					advance[i] = 1;
+				}
+			}
+		}
+
+		for(auto &command : bgCommands){
+			command->process();
+		}
+	}
+	return tick;
+}
@@ -0,0 +1,89 @@
+/**
+ * autoexecutor.cpp
+ * See autoexecutor.hpp for details.
+ *
+ * Copyright (c) 2018 FRC Team 2655 - The Flying Platypi
+ * See LICENSE file for details
+ */
+
+#include "autoexecutor.hpp"
+
+#include <algorithm>
+
+using namespace team2655;
+
+void AutoExecutor::Slot::operator()(){
+	running = manager->process();
+	// Queue the next tick of this manager only after this one finished. This keeps its ticks in order.
+	if(running)
+		executor->pool.submit(executor->freeRunning, *this);
+}
+
+void AutoExecutor::Batch::operator()(){
+	for(size_t i = first; i < last; ++i){
+		executor->stillRunning[i] = executor->managers[i]->process(executor->tickTime);
+	}
+}
+
+AutoExecutor::AutoExecutor(size_t threadCount) : pool(threadCount){
+
+}
+
+AutoManager &AutoExecutor::add(std::unique_ptr<AutoManager> manager){
+	managers.push_back(std::move(manager));
+	buildBatches();
+	return *managers.back();
+}
+
+void AutoExecutor::buildBatches(){
+	batches.clear();
+	stillRunning.resize(managers.size());
+	slots.resize(managers.size());
+	if(managers.empty())
+		return;
+
+	// Several batches per worker so stealing can even out managers with slow ticks
+	size_t batchCount = std::min(managers.size(), pool.size() * 4);
+	size_t perBatch = (managers.size() + batchCount - 1) / batchCount;
+	for(size_t first = 0; first < managers.size(); first += perBatch){
+		Batch batch;
+		batch.executor = this;
+		batch.first = first;
+		batch.last = std::min(first + perBatch, managers.size());
+		batches.push_back(batch);
+	}
+
+	for(size_t i = 0; i < managers.size(); ++i){
+		slots[i].executor = this;
+		slots[i].manager = managers[i].get();
+		slots[i].running = false;
+	}
+}
+
+void AutoExecutor::setClock(AutoClock *clock){
+	this->clock = (clock == nullptr) ? &SteadyAutoClock::instance() : clock;
+}
+
+size_t AutoExecutor::tick(){
+	return tick(clock->now());
+}
+
+size_t AutoExecutor::tick(AutoTime now){
+	tickTime = now;
+
+	TaskGroup group;
+	for(Batch &batch : batches){
+		pool.submit(group, batch);
+	}
+	pool.wait(group);
+
+	return std::count(stillRunning.begin(), stillRunning.end(), 1);
+}
+
+void AutoExecutor::runFreeRunning(){
+	for(Slot &slot : slots){
+		slot.running = true;
+		pool.submit(freeRunning, slot);
+	}
+	pool.wait(freeRunning);
+}
@@ -0,0 +1,271 @@
+/**
+ * autoloader.cpp
+ * See autoloader.hpp for details.
+ *
+ * Copyright (c) 2018 FRC Team 2655 - The Flying Platypi
+ * See LICENSE file for details
+ */
+
+#include "autoloader.hpp"
+
+#include <algorithm>
+#include <cctype>
+
+using namespace team2655;
+
+static bool startsWithIgnoreCase(std::string_view text, std::string_view prefix){
+	if(text.size() < prefix.size())
+		return false;
+	for(size_t i = 0; i < prefix.size(); ++i){
+		if(::tolower((unsigned char)text[i]) != prefix[i])
+			return false;
+	}
+	return true;
+}
+
+bool team2655::isRowAnnotation(std::string_view field){
+	return startsWithIgnoreCase(field, "id=") || startsWithIgnoreCase(field, "after=");
+}
+
+bool team2655::splitRowAnnotations(ScriptRow &row){
+	row.argCount += row.annotationCount;
+	row.annotationCount = 0;
+	while(row.argCount > 0 && isRowAnnotation(row.args[row.argCount - 1])){
+		row.argCount--;
+		row.annotationCount++;
+	}
+	return row.annotationCount > 0;
+}
+
+bool team2655::buildScriptGraph(AutoScript &script){
+	ScriptGraph &graph = script.graph();
+	size_t rowCount = script.size();
+	graph.clear();
+	graph.enabled = true;
+	graph.dependencyCount.assign(rowCount, 0);
+
+	bool valid = true;
+	auto reject = [&](size_t i, const std::string &problem){
+		ScriptRow &row = script.row(i);
+		std::cerr << "Script row " << (i + 1) << " (\"" << script.name(row.nameId) << "\"): " << problem << std::endl;
+		row.opcode.kind = AutoOpcode::Invalid;
+		valid = false;
+	};
+
+	// Ids
+	std::unordered_map<std::string_view, uint32_t> ids;
+	for(size_t i = 0; i < rowCount; ++i){
+		const ScriptRow &row = script.row(i);
+		if(row.opcode.kind == AutoOpcode::GroupBegin || row.opcode.kind == AutoOpcode::GroupEnd)
+			reject(i, "groups cannot be used in a script with id= / after= annotations");
+		for(uint32_t a = row.argCount; a < row.argCount + row.annotationCount; ++a){
+			if(!startsWithIgnoreCase(row.args[a], "id="))
+				continue;
+			std::string_view id = row.args[a].substr(3);
+			if(!ids.emplace(id, (uint32_t)i).second)
+				reject(i, "id \"" + std::string(id) + "\" is already used by row " + std::to_string(ids[id] + 1));
+		}
+	}
+
+	// Edges (dependency -> dependent), then grouped by dependency
+	std::vector<std::pair<uint32_t, uint32_t>> edges;
+	for(size_t i = 0; i < rowCount; ++i){
+		const ScriptRow &row = script.row(i);
+		for(uint32_t a = row.argCount; a < row.argCount + row.annotationCount; ++a){
+			if(!startsWithIgnoreCase(row.args[a], "after="))
+				continue;
+			std::string_view id = row.args[a].substr(6);
+			auto it = ids.find(id);
+			if(it == ids.end()){
+				reject(i, "runs after unknown id \"" + std::string(id) + "\"");
+				continue;
+			}
+			edges.emplace_back(it->second, (uint32_t)i);
+			graph.dependencyCount[i]++;
+		}
+	}
+	std::sort(edges.begin(), edges.end());
+	graph.dependentStart.assign(rowCount + 1, 0);
+	graph.dependents.reserve(edges.size());
+	for(const auto &edge : edges){
+		graph.dependentStart[edge.first + 1]++;
+		graph.dependents.push_back(edge.second);
+	}
+	for(size_t i = 0; i < rowCount; ++i){
+		graph.dependentStart[i + 1] += graph.dependentStart[i];
+	}
+
+	for(size_t i = 0; i < rowCount; ++i){
+		if(graph.dependencyCount[i] == 0)
+			graph.roots.push_back((uint32_t)i);
+	}
+
+	// Topological sort (Kahn) to find cycles. Rows that are never released are in (or after) a cycle.
+	std::vector<uint32_t> waiting = graph.dependencyCount;
+	std::vector<uint32_t> ready = graph.roots;
+	size_t released = 0;
+	while(!ready.empty()){
+		uint32_t row = ready.back();
+		ready.pop_back();
+		released++;
+		for(uint32_t d = graph.dependentStart[row]; d < graph.dependentStart[row + 1]; ++d){
+			if(--waiting[graph.dependents[d]] == 0)
+				ready.push_back(graph.dependents[d]);
+		}
+	}
+	if(released != rowCount){
+		for(size_t i = 0; i < rowCount; ++i){
+			if(waiting[i] != 0)
+				reject(i, "depends on a cycle (or is part of one)");
+		}
+	}
+
+	return valid;
+}
+
+AutoOpcode ScriptResolver::operator()(std::string_view name) const{
+	auto it = opcodes.find(std::string(name));
+	return (it == opcodes.end()) ? AutoOpcode() : it->second;
+}
+
+ScriptLoader::ScriptLoader() : worker(&ScriptLoader::run, this){
+
+}
+
+ScriptLoader::~ScriptLoader(){
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_one();
+	worker.join();
+	drainRetired(); // Retired after the loader's last check
+}
+
+void ScriptLoader::load(const std::string &fileName, std::shared_ptr<const ScriptResolver> resolver){
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		Job job;
+		job.fileName = fileName;
+		job.resolver = std::move(resolver);
+		jobs.push_back(std::move(job));
+		loading[fileName]++;
+	}
+	wake.notify_one();
+}
+
+ScriptLoader::Status ScriptLoader::status(const std::string &fileName){
+	std::lock_guard<std::mutex> lock(mutex);
+	if(loading.find(fileName) != loading.end())
+		return Status::Loading;
+	auto it = scripts.find(fileName);
+	if(it == scripts.end())
+		return Status::NotRequested;
+	return it->second->valid ? Status::Ready : Status::Failed;
+}
+
+PreparedScriptPointer ScriptLoader::take(const std::string &fileName){
+	std::lock_guard<std::mutex> lock(mutex);
+	if(loading.find(fileName) != loading.end())
+		return nullptr;
+	auto it = scripts.find(fileName);
+	if(it == scripts.end() || !it->second->valid)
+		return nullptr;
+	PreparedScriptPointer script = std::move(it->second);
+	scripts.erase(it);
+	return script;
+}
+
+void ScriptLoader::retire(PreparedScriptPointer script){
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		Job job;
+		job.retired = std::move(script);
+		jobs.push_back(std::move(job));
+	}
+	wake.notify_one();
+}
+
+void ScriptLoader::retireFromTick(PreparedScriptPointer script){
+	size_t head = retireHead.load(std::memory_order_relaxed);
+	if(head - retireTail.load(std::memory_order_acquire) == RetireSlots){
+		retire(std::move(script));
+		return;
+	}
+	retiredSlots[head % RetireSlots] = std::move(script);
+	retireHead.store(head + 1, std::memory_order_release);
+	wake.notify_one(); // Without the mutex the loader may miss this. It checks the slots every RetireCheckPeriod.
+}
+
+bool ScriptLoader::retiredPending(){
+	return retireTail.load(std::memory_order_relaxed) != retireHead.load(std::memory_order_acquire);
+}
+
+void ScriptLoader::drainRetired(){
+	size_t tail = retireTail.load(std::memory_order_relaxed);
+	while(tail != retireHead.load(std::memory_order_acquire)){
+		PreparedScriptPointer script = std::move(retiredSlots[tail % RetireSlots]);
+		retireTail.store(++tail, std::memory_order_release);
+		script.reset();
+	}
+}
+
+PreparedScriptPointer ScriptLoader::prepare(const std::string &fileName, const ScriptResolver &resolver){
+	PreparedScriptPointer prepared = std::make_shared<PreparedScript>();
+	prepared->fileName = fileName;
+	prepared->registrationVersion = resolver.registrationVersion;
+	if(!prepared->script.load(fileName))
+		return prepared;
+
+	// The prepared script owns its parsed arguments
+	for(const ArgSchemaPointer &schema : resolver.commandSchemas){
+		prepared->commandSchemas.push_back(schema ? schema->clone() : nullptr);
+	}
+	for(const ArgSchemaPointer &schema : resolver.bgCommandSchemas){
+		prepared->bgCommandSchemas.push_back(schema ? schema->clone() : nullptr);
+	}
+
+	bool resolved = resolveScriptRows(prepared->script, resolver, prepared->commandSchemas, prepared->bgCommandSchemas);
+	ScriptAnalysis analysis = analyzeScript(prepared->script, resolver.commandTimeouts, resolver.tickPeriod);
+	prepared->valid = checkScriptAnalysis(analysis, prepared->script, fileName, resolver.durationLimit) && resolved;
+	return prepared;
+}
+
+void ScriptLoader::run(){
+	std::unique_lock<std::mutex> lock(mutex);
+	while(true){
+		wake.wait_for(lock, RetireCheckPeriod, [this](){ return stopping || !jobs.empty() || retiredPending(); });
+		if(retiredPending()){
+			lock.unlock();
+			drainRetired();
+			lock.lock();
+		}
+		if(jobs.empty()){
+			if(stopping)
+				return; // Nothing left to destroy
+			continue;
+		}
+
+		Job job = std::move(jobs.front());
+		jobs.pop_front();
+		if(stopping && job.retired == nullptr)
+			continue; // Loads requested before shutdown are dropped
+
+		// Load (or destroy) without holding the lock so the control thread never waits on the disk
+		lock.unlock();
+		PreparedScriptPointer prepared;
+		if(job.retired != nullptr)
+			job.retired.reset();
+		else
+			prepared = prepare(job.fileName, *job.resolver);
+		job.resolver.reset();
+		lock.lock();
+
+		if(prepared != nullptr){
+			scripts[job.fileName] = std::move(prepared);
+			auto it = loading.find(job.fileName);
+			if(it != loading.end() && --it->second == 0)
+				loading.erase(it);
+		}
+	}
+}
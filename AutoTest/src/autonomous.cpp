@@ -10,8 +10,6 @@
 
 #include <chrono>
 #include <sstream>
-#include <regex>
-#include <fstream>
 #include <iostream>
 #include <algorithm>
 
@@ -21,12 +19,8 @@ using namespace team2655;
 /// AutoCommand
 ////////////////////////////////////////////////////////////////////////
 
-int64_t AutoCommand::currentTimeMillis(){
-	return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
-}
-
 bool AutoCommand::hasTimedOut(){
-	return timeout > 0 && (currentTimeMillis()  - startTime >= timeout);
+	return timeout > AutoTime(0) && (tickTime - startTime >= timeout);
 }
 
 bool AutoCommand::hasStarted(){
@@ -38,23 +32,49 @@ bool AutoCommand::isComplete(){
 }
 
 void AutoCommand::setTimeout(int timeoutMs){
-	this->timeout = timeoutMs;
+	this->timeout = std::chrono::milliseconds(timeoutMs);
+}
+
+void AutoCommand::setTimeout(AutoTime timeout){
+	this->timeout = timeout;
 }
 
 int AutoCommand::getTimeout(){
+	return (int)std::chrono::duration_cast<std::chrono::milliseconds>(this->timeout).count();
+}
+
+AutoTime AutoCommand::getTimeoutDuration(){
 	return this->timeout;
 }
 
-void AutoCommand::doStart(std::string commandName, std::vector<std::string> args){
+void AutoCommand::setStarted(std::string_view commandName, const ArgList &args, AutoTime now){
 	this->commandName = commandName;
 	this->arguments = args;
-	this->startTime = currentTimeMillis();
+	this->tickTime = now;
+	this->startTime = now;
 	this->_hasStarted = true;
+}
+
+void AutoCommand::clearState(){
+	sleeping = false;
+	wakeTime = AutoTime::max();
+	wakeRequested.store(false);
+	_hasStarted = false;
+	_isComplete = false;
+	timeout = AutoTime(0);
+	startTime = AutoTime(0);
+	commandName = std::string_view();
+	arguments = ArgList();
+}
+
+void AutoCommand::doStart(std::string_view commandName, const ArgList &args, AutoTime now){
+	setStarted(commandName, args, now);
 	// Call the start function to be used by custom commands
 	start(commandName, args);
 }
 
-void AutoCommand::doProcess(){
+void AutoCommand::doProcess(AutoTime now){
+	this->tickTime = now;
 	// If the command has timed out complete the command
 	if(hasTimedOut()){
 		complete();
@@ -66,6 +86,23 @@ void AutoCommand::doProcess(){
 	process();
 }
 
+void AutoCommand::sleepUntil(AutoTime deadline){
+	if(wakeRequested.exchange(false))
+		return;
+	sleeping = true;
+	wakeTime = deadline;
+}
+
+void AutoCommand::wake(){
+	wakeRequested.store(true);
+}
+
+void AutoCommand::doReset(){
+	clearState();
+	// Call the reset function to be used by custom commands
+	reset();
+}
+
 void AutoCommand::complete(){
 	this->_isComplete = true;
 	// Call the complete function to be used by custom commands
@@ -76,10 +113,29 @@ void AutoCommand::complete(){
 /// BackgroundAutoCommand
 ////////////////////////////////////////////////////////////////////////
 
-void BackgroundAutoCommand::doUpdateArgs(std::string commandName, std::vector<std::string> args){
+void BackgroundAutoCommand::doUpdateArgs(std::string_view commandName, const ArgList &args, AutoTime now){
+	tickTime = now;
 	updateArgs(commandName, args);
 }
 
+void BackgroundAutoCommand::doProcess(AutoTime now){
+	tickTime = now;
+	process();
+}
+
+void BackgroundAutoCommand::sleepUntil(AutoTime deadline){
+	if(wakeRequested.exchange(false))
+		return;
+	sleeping = true;
+	wakeTime = deadline;
+}
+
+void BackgroundAutoCommand::wake(){
+	wakeRequested.store(true);
+	if(wakeSignal != nullptr)
+		wakeSignal->store(true);
+}
+
 ////////////////////////////////////////////////////////////////////////
 /// AutoManager
 ////////////////////////////////////////////////////////////////////////
@@ -94,17 +150,62 @@ std::vector<std::string> AutoManager::split(const std::string& s, char delimiter
 	return tokens;
 }
 
+AutoOpcode AutoManager::resolveName(std::string_view nameView) const{
+	AutoOpcode opcode;
+	std::string name(nameView);
+	auto bgIt = backgroundCommands.find(name);
+	if(bgIt != backgroundCommands.end()){
+		opcode.kind = AutoOpcode::Background;
+		opcode.index = (uint32_t)bgIt->second;
+		return opcode;
+	}
+	auto cmdIt = registeredCommands.find(name);
+	if(cmdIt != registeredCommands.end()){
+		opcode.kind = AutoOpcode::Command;
+		opcode.index = cmdIt->second;
+	}
+	return opcode;
+}
+
+bool AutoManager::resolveScript(){
+	if(scriptResolved)
+		return true;
+
+	bool valid = resolveScriptRows(script, [this](std::string_view name){ return resolveName(name); }, commandSchemas, bgCommandSchemas);
+	scriptResolved = true;
+	return valid;
+}
+
 // Registration methods
 
-void AutoManager::registerCommand(CmdCreator creator, std::string name){
+bool AutoManager::checkRegisterName(std::string &name) const{
 	std::transform(name.begin(), name.end(), name.begin(), ::tolower);
 
+	if(AutoOpcode::builtin(name).kind != AutoOpcode::Unknown){
+		std::cerr << "Cannot register command with name \"" << name << "\". The name is part of the script language." << std::endl;
+		return false;
+	}
+
 	// Only one command *or* background command can have a key.
-	if(backgroundCommands.find(name) == backgroundCommands.end() && registeredCommands.find(name) == registeredCommands.end()){
-		registeredCommands[name] = creator;
-	}else{
+	if(backgroundCommands.find(name) != backgroundCommands.end() || registeredCommands.find(name) != registeredCommands.end()){
 		std::cerr << "Cannot register command with name \"" << name << "\". A command is already registered with that name." << std::endl;
+		return false;
 	}
+	return true;
+}
+
+void AutoManager::registerCommand(CmdCreator creator, std::string name, ArgSchemaPointer schema, CmdTimeoutBound timeoutBound){
+	if(!checkRegisterName(name))
+		return;
+
+	registeredCommands[name] = (uint32_t)commandCreators.size();
+	commandCreators.push_back(creator);
+	commandSchemas.push_back(std::move(schema));
+	commandTimeouts.push_back(timeoutBound);
+	commandPools.emplace_back();
+	commandPools.back().reserve(1); // Only one command runs at a time so one pooled command is usually enough
+	registrationVersion++;
+	resolveRegisteredName(name);
 }
 
 void AutoManager::registerCommand(CmdCreator creator, std::vector<std::string> names){
@@ -114,10 +215,29 @@ void AutoManager::registerCommand(CmdCreator creator, std::vector<std::string> n
 }
 
 void AutoManager::unregisterAll(){
+	// End the script so no running command outlives its creator (creator indices are reused by the next registrations)
+	killAuto();
+
 	registeredCommands.clear();
+	commandCreators.clear();
+	commandSchemas.clear();
+	commandTimeouts.clear();
+	commandPools.clear();
 	backgroundCommands.clear();
 	bgCommandTypes.clear();
 	uniqueBgCommands.clear();
+	bgCommandStoreIndices.clear();
+	bgLastRows.clear();
+	bgStoreTypes.clear();
+	bgSharedCommands.clear();
+	bgCommandStores.clear(); // Destroys the background commands
+	bgCommandSchemas.clear();
+	bgScheduleValid = false;
+	registrationVersion++;
+
+	// Every row's opcode is stale. Resolved now (every row becomes unknown) so the next tick does not have to.
+	scriptResolved = false;
+	resolveScript();
 }
 
 // Script management
@@ -126,59 +246,135 @@ bool AutoManager::loadScript(std::string fileName){
 
 	clearCommands();
 
-	std::ifstream scriptFile;
-	scriptFile.open(fileName);
+	if(!script.load(fileName))
+		return false;
+	scriptResolved = false;
+	fingerprintValid = false;
 
-	if(!scriptFile.good()){
-		std::cerr << "Script file: \"" << fileName << "\" not found." << std::endl;
-		scriptFile.close();
-		return false; // Some error accessing the file
+	// Resolve every row and parse typed arguments now so a bad script fails here instead of while running
+	bool resolved = resolveScript();
+	if(!checkScriptAnalysis(analyzeScript(), script, fileName, durationLimit) || !resolved){
+		clearCommands();
+		return false;
 	}
 
-	// Get the file contents
-	std::stringstream fileContents;
-	fileContents << scriptFile.rdbuf();
-	scriptFile.close();
+	// Reset
+	currentCommandIndex = -1;
+	graphStarted = false;
+	recycleCurrentCommand();
+
+	return true;
+}
+
+std::shared_ptr<const ScriptResolver> AutoManager::snapshotRegistrations() const{
+	std::shared_ptr<ScriptResolver> resolver = std::make_shared<ScriptResolver>();
+	for(const auto &element : registeredCommands){
+		AutoOpcode opcode;
+		opcode.kind = AutoOpcode::Command;
+		opcode.index = element.second;
+		resolver->opcodes[element.first] = opcode;
+	}
+	for(const auto &element : backgroundCommands){
+		AutoOpcode opcode;
+		opcode.kind = AutoOpcode::Background;
+		opcode.index = (uint32_t)element.second;
+		resolver->opcodes[element.first] = opcode;
+	}
+	for(const ArgSchemaPointer &schema : commandSchemas){
+		resolver->commandSchemas.push_back(schema ? schema->clone() : nullptr);
+	}
+	for(const ArgSchemaPointer &schema : bgCommandSchemas){
+		resolver->bgCommandSchemas.push_back(schema ? schema->clone() : nullptr);
+	}
+	resolver->commandTimeouts = commandTimeouts;
+	resolver->durationLimit = durationLimit;
+	resolver->tickPeriod = tickPeriod;
+	resolver->registrationVersion = registrationVersion;
+	return resolver;
+}
 
-	// Remove spaces before and after commas
-	// Commands and args cannot start or end with spaces
-	//std::string csvData = std::regex_replace(fileContents.str(), std::regex(",\\ +"), ",");
+void AutoManager::setDurationLimit(AutoTime limit, AutoTime period){
+	durationLimit = limit;
+	tickPeriod = period;
+}
 
-	// Standardize line endings convert any line ending int '\n'
-	std::string csvData = std::regex_replace(fileContents.str(), std::regex("(\r\n|\r|\n)"), "\n");
+ScriptAnalysis AutoManager::analyzeScript(){
+	resolveScript();
+	return team2655::analyzeScript(script, commandTimeouts, tickPeriod);
+}
 
-	std::vector<std::string> lines = split(csvData, '\n'); // Separate each line
+void AutoManager::preloadScript(const std::string &fileName){
+	if(scriptLoader == nullptr)
+		scriptLoader.reset(new ScriptLoader());
+	scriptLoader->load(fileName, snapshotRegistrations());
+}
 
-	// Separate each column of the CSV
-	for(size_t i = 0; i < lines.size(); i++){
-		std::vector<std::string> columns = split(lines[i], ','); // All the columns in the CSV
-		loadedCommands.push_back(columns[0]); // This is the command
-		columns.erase(columns.begin()); // Remove the command from the list of columns. This will leave only arguments
-		loadedArguments.push_back(columns);
+void AutoManager::preloadScripts(const std::vector<std::string> &fileNames){
+	if(fileNames.empty())
+		return;
+	// All the scripts share one copy of the registrations
+	if(scriptLoader == nullptr)
+		scriptLoader.reset(new ScriptLoader());
+	std::shared_ptr<const ScriptResolver> resolver = snapshotRegistrations();
+	for(const std::string &fileName : fileNames){
+		scriptLoader->load(fileName, resolver);
 	}
+}
 
-	// Reset
-	currentCommandIndex = -1;
-	currentCommand.release();
+ScriptLoader::Status AutoManager::getPreloadStatus(const std::string &fileName){
+	if(scriptLoader == nullptr)
+		return ScriptLoader::Status::NotRequested;
+	return scriptLoader->status(fileName);
+}
+
+bool AutoManager::useScript(const std::string &fileName){
+	if(scriptLoader == nullptr)
+		return false;
+	PreparedScriptPointer prepared = scriptLoader->take(fileName);
+	if(prepared == nullptr)
+		return false;
 
+	// Publish for the next tick. A script that was waiting and never installed is dropped.
+	PreparedScriptPointer replaced = std::atomic_exchange(&pendingScript, prepared);
+	scriptSwapPending.store(true, std::memory_order_release);
+	if(replaced != nullptr)
+		scriptLoader->retire(std::move(replaced));
 	return true;
 }
 
+void AutoManager::installScript(PreparedScriptPointer prepared){
+	killAuto();
+
+	// Swap so the old script (and its parsed arguments) end up in the prepared object and are destroyed on the loader thread
+	std::swap(script, prepared->script);
+	telemetryNames = 0;
+	fingerprintValid = false;
+	std::fill(bgLastRows.begin(), bgLastRows.end(), SnapshotBackground::NoRow);
+	if(prepared->registrationVersion == registrationVersion){
+		commandSchemas.swap(prepared->commandSchemas);
+		bgCommandSchemas.swap(prepared->bgCommandSchemas);
+		scriptResolved = true;
+	}else{
+		// Commands were registered after the preload. The rows have to be resolved again (on this thread).
+		std::cerr << "WARNING: Commands were registered after \"" << prepared->fileName << "\" was preloaded. It will be resolved again." << std::endl;
+		scriptResolved = false;
+	}
+	currentCommandIndex = -1;
+	graphStarted = false;
+
+	scriptLoader->retireFromTick(std::move(prepared));
+}
+
 void AutoManager::addCommand(std::string command, std::vector<std::string> arguments, int pos){
 
 	// Any position beyond the end of the vector is converted to -1 (aka the end)
-	if((pos > ((int)loadedCommands.size())) || pos < -1)
+	if((pos > ((int)script.size())) || pos < -1)
 		pos = -1;
 
-	// Add to the end otherwise insert at a position
-	if(pos == -1){
-		loadedCommands.push_back(command);
-		loadedArguments.push_back(arguments);
-	}else{
-		loadedCommands.insert(loadedCommands.begin() + pos, command);
-		loadedArguments.insert(loadedArguments.begin() + pos, arguments);
-	}
-
+	size_t firstRow = (pos == -1) ? script.size() : pos;
+	script.insert(firstRow, command, arguments);
+	fingerprintValid = false;
+	resolveInsertedRows(firstRow, 1);
 }
 
 void AutoManager::addCommands(std::vector<std::string> commands, std::vector<std::vector<std::string>> arguments, int pos){
@@ -189,108 +385,1099 @@ void AutoManager::addCommands(std::vector<std::string> commands, std::vector<std
 	}
 
 	// Any position beyond the end of the vector is converted to -1 (aka the end)
-	if(pos > ((int)loadedCommands.size()) || pos < -1)
+	if(pos > ((int)script.size()) || pos < -1)
 		pos = -1;
 
-	loadedCommands.insert((pos == -1) ? loadedCommands.end() : loadedCommands.begin() + pos,
-			              commands.begin(),
-						  commands.end());
-	loadedArguments.insert((pos == -1) ? loadedArguments.end() : loadedArguments.begin() + pos,
-						   arguments.begin(),
-						   arguments.end());
+	size_t firstRow = (pos == -1) ? script.size() : pos;
+	script.insert(firstRow, commands, arguments);
+	fingerprintValid = false;
+	resolveInsertedRows(firstRow, commands.size());
+}
+
+void AutoManager::enableCommandInjection(size_t capacity){
+	injectedCommands.reset(new MpscRing<InjectedCommand>(capacity));
+}
+
+bool AutoManager::injectCommand(std::string_view command, const std::string_view *args, size_t argCount){
+	if(injectedCommands == nullptr || !InjectedCommand::fits(command, args, argCount))
+		return false;
+	return injectedCommands->tryPush([&](InjectedCommand &injected){
+		injected.set(command, args, argCount);
+	});
+}
+
+void AutoManager::drainInjectedCommands(){
+	size_t firstRow = script.size();
+	std::string_view args[InjectedCommand::MaxArgs];
+	while(injectedCommands->tryPop([&](const InjectedCommand &injected){
+		size_t argCount = injected.arguments(args);
+		script.insert(script.size(), injected.name(), args, argCount);
+	})){  }
+
+	if(script.size() != firstRow){
+		fingerprintValid = false;
+		resolveInsertedRows(firstRow, script.size() - firstRow);
+	}
+}
+
+void AutoManager::resolveRow(size_t rowIndex, std::string &error){
+	ScriptRow &row = script.row(rowIndex);
+	row.opcode = AutoOpcode::builtin(script.name(row.nameId));
+	if(row.opcode.kind == AutoOpcode::Unknown)
+		row.opcode = resolveName(script.name(row.nameId));
+	row.parsed = nullptr;
+
+	ArgSchema *schema = nullptr;
+	if(row.opcode.kind == AutoOpcode::Command)
+		schema = commandSchemas[row.opcode.index].get();
+	else if(row.opcode.kind == AutoOpcode::Background)
+		schema = bgCommandSchemas[row.opcode.index].get();
+	if(schema != nullptr && !schema->parse(row.arguments(), row.parsed, error)){
+		std::cerr << "Script row " << (rowIndex + 1) << " (\"" << script.name(row.nameId) << "\"): " << error << std::endl;
+		row.opcode.kind = AutoOpcode::Invalid;
+	}
+}
+
+bool AutoManager::resolveRows(size_t firstRow, size_t lastRow){
+	// Graphs and groups are checked against the whole script
+	for(size_t i = firstRow; i < lastRow; ++i){
+		ScriptRow &row = script.row(i);
+		uint32_t kind = AutoOpcode::builtin(script.name(row.nameId)).kind;
+		if(splitRowAnnotations(row) || kind == AutoOpcode::GroupBegin || kind == AutoOpcode::GroupEnd)
+			return false;
+	}
+
+	std::string error;
+	for(size_t i = firstRow; i < lastRow; ++i){
+		resolveRow(i, error);
+	}
+	return true;
+}
+
+void AutoManager::resolveInsertedRows(size_t firstRow, size_t count){
+	if(count == 0)
+		return;
+
+	// Rows after the inserted ones moved down
+	for(uint32_t &lastRow : bgLastRows){
+		if(lastRow != SnapshotBackground::NoRow && lastRow >= firstRow)
+			lastRow += (uint32_t)count;
+	}
+
+	if(scriptResolved && script.graph().enabled){
+		// Only the new rows are parsed (running commands keep their parsed arguments), then the graph is built again
+		std::string error;
+		for(size_t i = firstRow; i < firstRow + count; ++i){
+			splitRowAnnotations(script.row(i));
+			resolveRow(i, error);
+		}
+		buildScriptGraph(script);
+	}else if(!(scriptResolved && resolveRows(firstRow, firstRow + count))){
+		scriptResolved = false;
+		resolveScript();
+	}
+
+	if(script.graph().enabled)
+		remapGraphRun(firstRow, count);
+}
+
+void AutoManager::remapGraphRun(size_t firstRow, size_t count){
+	if(!graphStarted || graphWaiting.size() + count != script.size())
+		return; // No run in progress (the first tick sets up the run from the new graph)
+	const ScriptGraph &graph = script.graph();
+
+	// The rows that finished have nothing left to wait for and are not ready or running
+	graphFinished.assign(graphWaiting.size(), 0);
+	for(size_t i = 0; i < graphWaiting.size(); ++i){
+		graphFinished[i] = graphWaiting[i] == 0;
+	}
+	for(uint32_t row : graphReady){
+		graphFinished[row] = 0;
+	}
+	for(const ActiveCommand &active : graphRunning){
+		graphFinished[active.row] = 0;
+	}
+	graphFinished.insert(graphFinished.begin() + firstRow, count, 0);
+
+	// Move the rows after the inserted ones
+	for(uint32_t &row : graphReady){
+		if(row >= firstRow)
+			row += (uint32_t)count;
+	}
+	for(ActiveCommand &active : graphRunning){
+		if(active.row >= firstRow)
+			active.row += (uint32_t)count;
+	}
+
+	// Each row waits for its dependencies in the new graph that have not finished.
+	// New rows with nothing to wait for start on the next tick (or this one when they were injected).
+	graphWaiting = graph.dependencyCount;
+	for(size_t i = 0; i < graphFinished.size(); ++i){
+		if(!graphFinished[i])
+			continue;
+		for(uint32_t d = graph.dependentStart[i]; d < graph.dependentStart[i + 1]; ++d){
+			graphWaiting[graph.dependents[d]]--;
+		}
+	}
+	for(size_t i = firstRow; i < firstRow + count; ++i){
+		if(graphWaiting[i] == 0)
+			graphReady.push_back((uint32_t)i);
+	}
+}
+
+void AutoManager::resolveRegisteredName(const std::string &name){
+	uint32_t nameId;
+	if(!scriptResolved || !script.findName(name, nameId))
+		return; // No row uses the name (or every row is resolved again anyway)
+
+	std::string error;
+	for(size_t i = 0; i < script.size(); ++i){
+		if(script.row(i).nameId == nameId)
+			resolveRow(i, error);
+	}
+}
+
+void AutoManager::restartScript(){
+	killAuto();
+	currentCommandIndex = -1;
+	graphStarted = false;
 }
 
 size_t AutoManager::loadedCommandCount(){
-	return loadedCommands.size();
+	return script.size();
 }
 
 void AutoManager::clearCommands(){
 	killAuto();
-	loadedCommands.clear();
-	loadedArguments.clear();
+	script.clear();
+	telemetryNames = 0;
+	fingerprintValid = false;
+	std::fill(bgLastRows.begin(), bgLastRows.end(), SnapshotBackground::NoRow);
 	currentCommandIndex = -1;
+	graphStarted = false;
 }
 
 // Perform actions
 
+CmdPointer AutoManager::acquireCommand(uint32_t creatorIndex){
+	AutoTime start = (profiler == nullptr) ? AutoTime(0) : AutoProfiler::now();
+	std::vector<CmdPointer> &pool = commandPools[creatorIndex];
+	CmdPointer command;
+	if(pool.empty()){
+		command = commandCreators[creatorIndex]();
+	}else{
+		command = std::move(pool.back());
+		pool.pop_back();
+	}
+	if(profiler != nullptr)
+		profiler->record(AutoProfiler::Kind::Create, creatorIndex, start, AutoProfiler::now() - start);
+	return command;
+}
+
+void AutoManager::recycleCommand(CmdPointer &command, uint32_t creator){
+	if(command.get() == nullptr)
+		return;
+	command->doReset();
+	commandPools[creator].push_back(std::move(command));
+}
+
+void AutoManager::recycleCurrentCommand(){
+	recycleCommand(currentCommand, currentCommandCreator);
+}
+
+void AutoManager::limitTimeout(AutoCommand &command, AutoTime bound){
+	if(bound == AutoTime::max())
+		return;
+	bound = std::max(bound, AutoTime(1)); // A timeout of 0 would mean no timeout
+	if(command.timeout <= AutoTime(0) || command.timeout > bound)
+		command.timeout = bound;
+}
+
+void AutoManager::runCommand(AutoCommand &command, uint32_t creator, size_t rowIndex){
+	if(command.sleeping){
+		// Wake for the deadline, the timeout or an explicit wake
+		AutoTime deadline = command.wakeTime;
+		if(command.timeout > AutoTime(0))
+			deadline = std::min(deadline, command.startTime + command.timeout);
+		if(tickTime < deadline && !(command.wakeRequested.load(std::memory_order_relaxed) && command.wakeRequested.exchange(false)))
+			return;
+		command.sleeping = false;
+	}
+
+	FramePool::Scope frames(framePool); // Coroutine commands allocate their frames from this manager
+	AutoTime start = (profiler == nullptr) ? AutoTime(0) : AutoProfiler::now();
+	AutoProfiler::Kind kind;
+	if(!command.hasStarted()){
+		const ScriptRow &row = script.row(rowIndex);
+		if(telemetry != nullptr)
+			logEvent(TelemetryEvent::CommandStart, creator, rowIndex);
+		command.doStart(script.name(row.nameId), row.arguments(), tickTime);
+		if(creator < commandTimeouts.size() && commandTimeouts[creator] != nullptr)
+			limitTimeout(command, commandTimeouts[creator](row.arguments()));
+		if(!command.sleeping)
+			command.process();
+		kind = AutoProfiler::Kind::Start;
+	}else{
+		command.doProcess(tickTime);
+		kind = AutoProfiler::Kind::Process;
+	}
+	if(profiler != nullptr)
+		profiler->record(kind, creator, start, AutoProfiler::now() - start);
+	if(telemetry != nullptr && command.isComplete())
+		logCommandEnd(command, creator, rowIndex, false);
+}
+
+void AutoManager::startGroup(){
+	groupKind = script.row(currentCommandIndex).opcode.index;
+	groupActive = true;
+
+	// Resolving guarantees the group has an end row
+	for(currentCommandIndex++; currentCommandIndex < script.size(); currentCommandIndex++){
+		const ScriptRow &row = script.row(currentCommandIndex);
+		if(row.opcode.kind == AutoOpcode::GroupEnd){
+			break;
+		}else if(row.opcode.kind == AutoOpcode::Command){
+			ActiveCommand groupCommand;
+			groupCommand.creator = row.opcode.index;
+			groupCommand.row = currentCommandIndex;
+			groupCommand.command = acquireCommand(row.opcode.index);
+			groupCommands.push_back(std::move(groupCommand));
+		}else if(row.opcode.kind == AutoOpcode::Background){
+			updateBgCommand(currentCommandIndex);
+		}else{
+			skipRow(currentCommandIndex);
+		}
+	}
+}
+
+void AutoManager::processGroup(){
+	for(ActiveCommand &groupCommand : groupCommands){
+		if(!groupCommand.command->isComplete())
+			runCommand(*groupCommand.command, groupCommand.creator, groupCommand.row);
+	}
+
+	if(groupKind != AutoOpcode::Parallel && groupFinished()){
+		for(ActiveCommand &groupCommand : groupCommands){
+			if(!groupCommand.command->isComplete()){
+				groupCommand.command->complete();
+				if(telemetry != nullptr)
+					logCommandEnd(*groupCommand.command, groupCommand.creator, groupCommand.row, true);
+			}
+		}
+	}
+}
+
+bool AutoManager::groupFinished() const{
+	if(groupCommands.empty())
+		return true;
+	switch(groupKind){
+	case AutoOpcode::Race:
+		for(const ActiveCommand &groupCommand : groupCommands){
+			if(groupCommand.command->isComplete())
+				return true;
+		}
+		return false;
+	case AutoOpcode::Deadline:
+		return groupCommands.front().command->isComplete();
+	default:
+		for(const ActiveCommand &groupCommand : groupCommands){
+			if(!groupCommand.command->isComplete())
+				return false;
+		}
+		return true;
+	}
+}
+
+void AutoManager::recycleGroup(){
+	for(ActiveCommand &groupCommand : groupCommands){
+		recycleCommand(groupCommand.command, groupCommand.creator);
+	}
+	groupCommands.clear();
+	groupActive = false;
+}
+
 void AutoManager::handleNextBgCommands(){
 	// If the next command is a background command process background commands until
 	//    there are no more commands or until the next is not a background command
-	std::string key = loadedCommands[currentCommandIndex];
-	std::transform(key.begin(), key.end(), key.begin(), ::tolower);
-	while(backgroundCommands.find(key) != backgroundCommands.end()){
-		uniqueBgCommands[backgroundCommands[key]]->doUpdateArgs(key, loadedArguments[currentCommandIndex]);
+	while(currentCommandIndex < script.size() && script.row(currentCommandIndex).opcode.kind == AutoOpcode::Background){
+		updateBgCommand(currentCommandIndex);
 		currentCommandIndex++;
+	}
+}
+
+void AutoManager::updateBgCommand(size_t rowIndex){
+	const ScriptRow &row = script.row(rowIndex);
+	if(telemetry != nullptr)
+		logEvent(TelemetryEvent::BackgroundUpdate, row.opcode.index, rowIndex);
+
+	// New arguments always wake the command
+	if(bgScheduleValid)
+		wakeBgCommand(row.opcode.index);
+	else
+		uniqueBgCommands[row.opcode.index]->sleeping = false; // Listed as awake when the schedule is built
+	uniqueBgCommands[row.opcode.index]->doUpdateArgs(script.name(row.nameId), row.arguments(), tickTime);
+	bgLastRows[row.opcode.index] = (uint32_t)rowIndex;
+}
+
+void AutoManager::skipRow(size_t rowIndex){
+	const ScriptRow &row = script.row(rowIndex);
+	if(row.opcode.kind == AutoOpcode::Invalid)
+		std::cerr << "WARNING: Invalid arguments for \"" << script.name(row.nameId) << "\". Command will be skipped.\n";
+	else
+		std::cerr << "WARNING: No command registered for key \"" << script.name(row.nameId) << "\". Command will be skipped.\n";
+	if(telemetry != nullptr)
+		logEvent(TelemetryEvent::CommandSkipped, 0, rowIndex);
+}
+
+void AutoManager::logEvent(TelemetryEvent::Type type, uint32_t index, size_t rowIndex){
+	uint32_t nameId = script.row(rowIndex).nameId;
+	// Names are sent the first time they are used (again after the script is replaced)
+	for(; telemetryNames <= nameId; ++telemetryNames){
+		telemetry->setName(telemetryNames, script.name(telemetryNames));
+	}
+	telemetry->record(type, index, (uint32_t)rowIndex, nameId, tickTime);
+}
 
-		// Get next key. This will repeat if the next key is for a background command
-		key = loadedCommands[currentCommandIndex];
-		std::transform(key.begin(), key.end(), key.begin(), ::tolower);
+void AutoManager::logCommandEnd(const AutoCommand &command, uint32_t creator, size_t rowIndex, bool cancelled){
+	TelemetryEvent::Type type = TelemetryEvent::CommandComplete;
+	if(cancelled)
+		type = TelemetryEvent::CommandCancelled;
+	else if(command.timeout > AutoTime(0) && tickTime - command.startTime >= command.timeout)
+		type = TelemetryEvent::CommandTimeout;
+	logEvent(type, creator, rowIndex);
+}
+
+void AutoManager::wakeBgCommand(size_t index){
+	BackgroundAutoCommand &command = *uniqueBgCommands[index];
+	if(!command.sleeping)
+		return;
+	command.sleeping = false;
+	command.sleepGeneration++;
+	if(!bgTasks[index].awake){
+		bgTasks[index].awake = true;
+		bgAwake.push_back(index);
+		bgAwakeSorted = false;
+	}
+}
+
+void AutoManager::BgTask::operator()(){
+	BackgroundAutoCommand &command = *manager->uniqueBgCommands[index];
+	if(command.sleeping || !command.shouldProcess())
+		return;
+	if(manager->profiler == nullptr){
+		command.doProcess(manager->tickTime);
+	}else{
+		// Only written here. Recorded by processBgCommands after the stage so the profiler is never shared between threads.
+		profileStart = AutoProfiler::now();
+		command.doProcess(manager->tickTime);
+		profileDuration = AutoProfiler::now() - profileStart;
+	}
+}
+
+void AutoManager::buildBgSchedule(){
+	size_t count = uniqueBgCommands.size();
+	bgTasks.resize(count);
+	bgBatch.reserve(count);
+
+	// Kahn's algorithm, one stage per round so everything in a stage is independent
+	std::vector<std::vector<size_t>> dependents(count);
+	std::vector<size_t> waitingOn(count, 0);
+	for(size_t i = 0; i < count; ++i){
+		bgTasks[i].manager = this;
+		bgTasks[i].index = i;
+		bgTasks[i].store = bgCommandStoreIndices[i];
+		for(const std::string &name : uniqueBgCommands[i]->runAfter()){
+			std::string key = name;
+			std::transform(key.begin(), key.end(), key.begin(), ::tolower);
+			auto it = backgroundCommands.find(key);
+			if(it == backgroundCommands.end()){
+				std::cerr << "WARNING: Background command \"" << bgCommandTypes[i] << "\" runs after unknown command \"" << name << "\"." << std::endl;
+				continue;
+			}
+			if(it->second == i)
+				continue;
+			dependents[it->second].push_back(i);
+			waitingOn[i]++;
+		}
+	}
+
+	std::vector<size_t> ready;
+	for(size_t i = 0; i < count; ++i){
+		if(waitingOn[i] == 0)
+			ready.push_back(i);
+	}
+	uint32_t stage = 0;
+	uint32_t rank = 0;
+	while(!ready.empty()){
+		// Commands keep the order they would have without batching. Runs of one type next to each other
+		// (ex instances registered one after another) are processed in one batch.
+		std::vector<size_t> next;
+		for(size_t i : ready){
+			bgTasks[i].stage = stage;
+			bgTasks[i].rank = rank++;
+			bgTasks[i].parallel = threadPool != nullptr && uniqueBgCommands[i]->isParallelSafe();
+			for(size_t dependent : dependents[i]){
+				if(--waitingOn[dependent] == 0)
+					next.push_back(dependent);
+			}
+		}
+		stage++;
+		ready.swap(next);
+	}
+
+	if(rank != count){
+		// Cycle. Ignore dependencies and process in registration order.
+		std::cerr << "WARNING: Background command dependencies contain a cycle. Dependencies will be ignored." << std::endl;
+		for(size_t i = 0; i < count; ++i){
+			bgTasks[i].stage = 0;
+			bgTasks[i].rank = (uint32_t)i;
+			bgTasks[i].parallel = false;
+		}
+	}
+
+	// Start over with the awake list and deadlines
+	bgAwake.clear();
+	bgWakeups.clear();
+	for(size_t i = 0; i < count; ++i){
+		BackgroundAutoCommand &command = *uniqueBgCommands[i];
+		bgTasks[i].awake = !command.sleeping;
+		if(!command.sleeping){
+			bgAwake.push_back(i);
+		}else if(command.wakeTime != AutoTime::max()){
+			bgWakeups.push_back({ command.wakeTime, i, command.sleepGeneration });
+			std::push_heap(bgWakeups.begin(), bgWakeups.end(), std::greater<BgWakeup>());
+		}
+	}
+	bgAwakeSorted = false;
+
+	bgScheduleValid = true;
+}
+
+void AutoManager::processBgCommands(){
+	if(!bgScheduleValid)
+		buildBgSchedule();
+
+	// Wake sleeping commands whose deadline has passed or that were woken from another thread
+	while(!bgWakeups.empty() && bgWakeups.front().deadline <= tickTime){
+		BgWakeup wakeup = bgWakeups.front();
+		std::pop_heap(bgWakeups.begin(), bgWakeups.end(), std::greater<BgWakeup>());
+		bgWakeups.pop_back();
+		if(uniqueBgCommands[wakeup.index]->sleepGeneration == wakeup.generation)
+			wakeBgCommand(wakeup.index);
+	}
+	if(bgWakePending.load(std::memory_order_relaxed) && bgWakePending.exchange(false)){
+		for(size_t i = 0; i < uniqueBgCommands.size(); ++i){
+			BackgroundAutoCommand &command = *uniqueBgCommands[i];
+			if(command.sleeping && command.wakeRequested.exchange(false))
+				wakeBgCommand(i);
+		}
+	}
+
+	if(!bgAwakeSorted){
+		std::sort(bgAwake.begin(), bgAwake.end(), [this](size_t a, size_t b){ return bgTasks[a].rank < bgTasks[b].rank; });
+		bgAwakeSorted = true;
+	}
+
+	// Process the awake commands stage by stage
+	for(size_t first = 0; first < bgAwake.size();){
+		uint32_t stage = bgTasks[bgAwake[first]].stage;
+		size_t last = first;
+		while(last < bgAwake.size() && bgTasks[bgAwake[last]].stage == stage)
+			last++;
+
+		// Hand the parallel commands to the pool then do the serial ones while they run
+		TaskGroup group;
+		bool anyParallel = false;
+		for(size_t i = first; i < last; ++i){
+			BgTask &task = bgTasks[bgAwake[i]];
+			if(task.parallel){
+				threadPool->submit(group, task);
+				anyParallel = true;
+			}
+		}
+		for(size_t i = first; i < last;){
+			BgTask &task = bgTasks[bgAwake[i]];
+			if(task.parallel){
+				i++;
+			}else if(profiler != nullptr){
+				task(); // Measured one command at a time
+				i++;
+			}else{
+				// Hand the run of serial commands of one type to their store (one virtual call for the run)
+				bgBatch.clear();
+				for(; i < last && !bgTasks[bgAwake[i]].parallel && bgTasks[bgAwake[i]].store == task.store; ++i){
+					bgBatch.push_back(uniqueBgCommands[bgAwake[i]]);
+				}
+				bgCommandStores[task.store]->processBatch(bgBatch.data(), bgBatch.size(), tickTime);
+			}
+		}
+		if(anyParallel)
+			threadPool->wait(group);
+		first = last;
 	}
+
+	if(profiler != nullptr){
+		for(size_t index : bgAwake){
+			BgTask &task = bgTasks[index];
+			if(task.profileDuration >= AutoTime(0)){
+				profiler->record(AutoProfiler::Kind::Background, (uint32_t)task.index, task.profileStart, task.profileDuration);
+				task.profileDuration = AutoTime(-1);
+			}
+		}
+	}
+
+	// Commands that went to sleep leave the awake list (keeping it in schedule order)
+	size_t kept = 0;
+	for(size_t index : bgAwake){
+		BackgroundAutoCommand &command = *uniqueBgCommands[index];
+		if(command.sleeping){
+			bgTasks[index].awake = false;
+			if(command.wakeTime != AutoTime::max()){
+				bgWakeups.push_back({ command.wakeTime, index, command.sleepGeneration });
+				std::push_heap(bgWakeups.begin(), bgWakeups.end(), std::greater<BgWakeup>());
+			}
+		}else{
+			bgAwake[kept++] = index;
+		}
+	}
+	bgAwake.resize(kept);
+}
+
+void AutoManager::setThreadPool(WorkStealingPool *pool){
+	threadPool = pool;
+	bgScheduleValid = false;
+}
+
+void AutoManager::setClock(AutoClock *clock){
+	this->clock = (clock == nullptr) ? &SteadyAutoClock::instance() : clock;
+}
+
+AutoClock &AutoManager::getClock(){
+	return *clock;
+}
+
+void AutoManager::setTelemetry(TelemetryLog *log){
+	telemetry = log;
+	telemetryNames = 0;
+}
+
+void AutoManager::setProfiler(AutoProfiler *profiler){
+	this->profiler = profiler;
+}
+
+std::string AutoManager::profileName(AutoProfiler::Kind kind, uint32_t index) const{
+	static const char *const suffixes[AutoProfiler::KindCount] = { "tick", ".create", ".start", ".process", ".process" };
+	if(kind == AutoProfiler::Kind::Tick)
+		return suffixes[0];
+
+	// Use the alphabetically first name registered for the command so names do not depend on hash order
+	std::string name;
+	if(kind == AutoProfiler::Kind::Background){
+		for(const auto &element : backgroundCommands){
+			if(element.second == index && (name.empty() || element.first < name))
+				name = element.first;
+		}
+	}else{
+		for(const auto &element : registeredCommands){
+			if(element.second == index && (name.empty() || element.first < name))
+				name = element.first;
+		}
+	}
+	if(name.empty())
+		name = "#" + std::to_string(index); // Unregistered since it was measured
+	return name + suffixes[(int)kind];
+}
+
+std::vector<ProfileEntry> AutoManager::getProfile() const{
+	std::vector<ProfileEntry> entries;
+	if(profiler == nullptr)
+		return entries;
+
+	for(int k = 0; k < AutoProfiler::KindCount; ++k){
+		AutoProfiler::Kind kind = (AutoProfiler::Kind)k;
+		for(uint32_t i = 0; i < profiler->indexCount(kind); ++i){
+			const LatencyHistogram &histogram = profiler->histogram(kind, i);
+			if(histogram.getCount() == 0)
+				continue;
+			ProfileEntry entry;
+			entry.name = profileName(kind, i);
+			entry.count = histogram.getCount();
+			entry.p50 = AutoTime(histogram.percentile(50));
+			entry.p99 = AutoTime(histogram.percentile(99));
+			entry.max = AutoTime(histogram.getMax());
+			entry.total = AutoTime(histogram.getTotal());
+			entries.push_back(entry);
+		}
+	}
+	return entries;
+}
+
+bool AutoManager::writeChromeTrace(std::ostream &out) const{
+	if(profiler == nullptr)
+		return false;
+
+	std::vector<AutoProfiler::TraceEvent> events = profiler->traceEvents();
+	AutoTime origin = events.empty() ? AutoTime(0) : events.front().start;
+	for(const AutoProfiler::TraceEvent &event : events){
+		origin = std::min(origin, event.start);
+	}
+
+	// Complete ("X") events in microseconds. Background commands get their own row since they may overlap.
+	out << "{\"traceEvents\":[";
+	for(size_t i = 0; i < events.size(); ++i){
+		const AutoProfiler::TraceEvent &event = events[i];
+		int tid = (event.kind == AutoProfiler::Kind::Background) ? 2 + (int)event.index : 1;
+		out << (i == 0 ? "\n" : ",\n");
+		out << "{\"name\":\"" << profileName(event.kind, event.index) << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << tid
+			<< ",\"ts\":" << (event.start - origin).count() / 1000.0
+			<< ",\"dur\":" << event.duration.count() / 1000.0 << "}";
+	}
+	out << "\n]}\n";
+	return true;
+}
+
+void AutoManager::setSnapshotBuffer(SnapshotBuffer *buffer){
+	snapshotBuffer = buffer;
+}
+
+uint64_t AutoManager::getScriptFingerprint(){
+	if(fingerprintValid)
+		return scriptFingerprint;
+
+	// FNV-1a over every row's name and arguments (a zero byte after each field so fields cannot run together)
+	uint64_t hash = 14695981039346656037ull;
+	auto add = [&hash](std::string_view text){
+		for(char c : text){
+			hash ^= (uint8_t)c;
+			hash *= 1099511628211ull;
+		}
+		hash *= 1099511628211ull;
+	};
+	for(size_t i = 0; i < script.size(); ++i){
+		const ScriptRow &row = script.row(i);
+		add(script.name(row.nameId));
+		for(uint32_t arg = 0; arg < row.argCount; ++arg){
+			add(row.args[arg]);
+		}
+	}
+	scriptFingerprint = hash;
+	fingerprintValid = true;
+	return scriptFingerprint;
+}
+
+void AutoManager::saveCommand(SnapshotWriter &out, AutoCommand &command, uint32_t creator, size_t rowIndex){
+	SnapshotCommand record = {};
+	record.row = (uint32_t)rowIndex;
+	record.creator = creator;
+	record.started = command._hasStarted;
+	record.complete = command._isComplete;
+	record.sleeping = command.sleeping;
+	record.elapsed = (command.tickTime - command.startTime).count();
+	record.timeout = command.timeout.count();
+	record.wakeIn = (command.wakeTime == AutoTime::max()) ? SnapshotCommand::NoWake : (command.wakeTime - tickTime).count();
+	out.write(record);
+	size_t block = out.beginBlock();
+	if(record.started && !record.complete)
+		command.saveState(out);
+	out.endBlock(block);
+}
+
+bool AutoManager::restoreCommand(SnapshotReader &in, ActiveCommand &active){
+	SnapshotCommand record;
+	SnapshotReader state;
+	if(!in.read(record) || !in.readBlock(state) || record.row >= script.size())
+		return false;
+	const ScriptRow &row = script.row(record.row);
+	if(row.opcode.kind != AutoOpcode::Command || row.opcode.index != record.creator)
+		return false;
+
+	active.creator = record.creator;
+	active.row = record.row;
+	active.command = acquireCommand(record.creator);
+	AutoCommand &command = *active.command;
+	if(!record.started)
+		return true;
+	if(record.complete){
+		// Finished on the tick the snapshot was saved. The script moves on next tick.
+		command.setStarted(script.name(row.nameId), row.arguments(), tickTime);
+		command._isComplete = true;
+		return true;
+	}
+
+	command.doStart(script.name(row.nameId), row.arguments(), tickTime);
+	command.startTime = tickTime - AutoTime(record.elapsed);
+	command.timeout = AutoTime(record.timeout);
+	command.sleeping = record.sleeping;
+	command.wakeTime = (record.wakeIn == SnapshotCommand::NoWake) ? AutoTime::max() : tickTime + AutoTime(record.wakeIn);
+	return command.restoreState(state);
+}
+
+size_t AutoManager::saveSnapshot(uint8_t *data, size_t capacity){
+	SnapshotWriter out(data, capacity);
+	bool graph = script.graph().enabled;
+
+	SnapshotHeader header = {};
+	header.magic = SnapshotHeader::Magic;
+	header.version = SnapshotHeader::CurrentVersion;
+	header.scriptFingerprint = getScriptFingerprint();
+	header.rowCount = (uint32_t)script.size();
+	header.bgCommandCount = (uint32_t)uniqueBgCommands.size();
+	header.mode = graph ? SnapshotHeader::Graph : SnapshotHeader::Linear;
+	out.write(header);
+
+	if(graph){
+		out.write<uint8_t>(graphStarted);
+		out.write<uint32_t>((uint32_t)graphWaiting.size());
+		out.write(graphWaiting.data(), graphWaiting.size() * sizeof(uint32_t));
+		out.write<uint32_t>((uint32_t)graphReady.size());
+		out.write(graphReady.data(), graphReady.size() * sizeof(uint32_t));
+		out.write<uint32_t>((uint32_t)graphRunning.size());
+		for(ActiveCommand &active : graphRunning){
+			saveCommand(out, *active.command, active.creator, active.row);
+		}
+	}else{
+		out.write<uint64_t>(currentCommandIndex);
+		out.write<uint8_t>(groupActive);
+		out.write<uint32_t>(groupKind);
+		if(groupActive){
+			out.write<uint32_t>((uint32_t)groupCommands.size());
+			for(ActiveCommand &groupCommand : groupCommands){
+				saveCommand(out, *groupCommand.command, groupCommand.creator, groupCommand.row);
+			}
+		}else if(currentCommand.get() != nullptr){
+			out.write<uint32_t>(1);
+			saveCommand(out, *currentCommand, currentCommandCreator, currentCommandIndex);
+		}else{
+			out.write<uint32_t>(0);
+		}
+	}
+
+	for(size_t i = 0; i < uniqueBgCommands.size(); ++i){
+		BackgroundAutoCommand &command = *uniqueBgCommands[i];
+		SnapshotBackground record = {};
+		record.lastRow = bgLastRows[i];
+		record.sleeping = command.sleeping;
+		record.wakeIn = (command.wakeTime == AutoTime::max()) ? SnapshotCommand::NoWake : (command.wakeTime - tickTime).count();
+		out.write(record);
+		size_t block = out.beginBlock();
+		command.saveState(out);
+		out.endBlock(block);
+	}
+
+	return out.failed() ? 0 : out.size();
+}
+
+bool AutoManager::restoreSnapshot(const SnapshotBuffer &buffer){
+	const uint8_t *data = nullptr;
+	size_t size = 0;
+	if(!buffer.latest(data, size))
+		return false;
+	return restoreSnapshot(data, size);
+}
+
+bool AutoManager::restoreSnapshot(const uint8_t *data, size_t size){
+	resolveScript();
+
+	SnapshotReader in(data, size);
+	SnapshotHeader header;
+	const char *problem = nullptr;
+	if(!in.read(header) || header.magic != SnapshotHeader::Magic || header.version != SnapshotHeader::CurrentVersion)
+		problem = "not a snapshot or saved by another version";
+	else if(header.rowCount != script.size() || header.scriptFingerprint != getScriptFingerprint())
+		problem = "saved with a different script";
+	else if(header.bgCommandCount != uniqueBgCommands.size() || header.mode != (script.graph().enabled ? SnapshotHeader::Graph : SnapshotHeader::Linear))
+		problem = "saved with different commands";
+	if(problem != nullptr){
+		std::cerr << "Snapshot: " << problem << ". The script will run from the start." << std::endl;
+		restartScript();
+		return false;
+	}
+
+	// Start from nothing running then recreate what was running when the snapshot was saved.
+	// The saved tick is put one period back so the next process() is the tick after it (time spent restarting is not counted).
+	killAuto();
+	tickTime = clock->now() - tickPeriod;
+	bool valid = true;
+	if(header.mode == SnapshotHeader::Graph){
+		uint8_t started = 0;
+		uint32_t count = 0;
+		// A started run waits on every row. A run that was not started (or was killed) waits on none and has nothing
+		// ready or running, since finishing a row counts down the rows that wait on it.
+		valid = in.read(started) && in.read(count) && (count == 0 || (started && count == script.size()));
+		bool waiting = count != 0;
+		if(valid){
+			graphStarted = started;
+			graphWaiting.resize(count);
+			valid = in.read(graphWaiting.data(), count * sizeof(uint32_t)) && in.read(count) && count <= script.size() &&
+					(waiting || count == 0);
+		}
+		if(valid){
+			graphReady.resize(count);
+			valid = in.read(graphReady.data(), count * sizeof(uint32_t)) && in.read(count) && (waiting || count == 0);
+			for(uint32_t row : graphReady){
+				valid = valid && row < script.size();
+			}
+		}
+		for(uint32_t i = 0; valid && i < count; ++i){
+			ActiveCommand active;
+			valid = restoreCommand(in, active);
+			if(active.command.get() != nullptr)
+				graphRunning.push_back(std::move(active));
+		}
+	}else{
+		uint64_t index = 0;
+		uint8_t group = 0;
+		uint32_t kind = 0;
+		uint32_t count = 0;
+		valid = in.read(index) && in.read(group) && in.read(kind) && in.read(count) &&
+				((size_t)index == (size_t)-1 || index <= script.size()) && (group || count <= 1);
+		if(valid){
+			currentCommandIndex = (size_t)index;
+			groupActive = group;
+			groupKind = kind;
+		}
+		for(uint32_t i = 0; valid && i < count; ++i){
+			ActiveCommand active;
+			valid = restoreCommand(in, active);
+			if(active.command.get() == nullptr){
+				continue;
+			}else if(group){
+				groupCommands.push_back(std::move(active));
+			}else{
+				currentCommand = std::move(active.command);
+				currentCommandCreator = active.creator;
+			}
+		}
+	}
+
+	for(size_t i = 0; valid && i < uniqueBgCommands.size(); ++i){
+		BackgroundAutoCommand &command = *uniqueBgCommands[i];
+		SnapshotBackground record;
+		SnapshotReader state;
+		if(!in.read(record) || !in.readBlock(state)){
+			valid = false;
+			break;
+		}
+		if(record.lastRow != SnapshotBackground::NoRow){
+			if(record.lastRow >= script.size() || script.row(record.lastRow).opcode.kind != AutoOpcode::Background ||
+					script.row(record.lastRow).opcode.index != i){
+				valid = false;
+				break;
+			}
+			const ScriptRow &row = script.row(record.lastRow);
+			command.doUpdateArgs(script.name(row.nameId), row.arguments(), tickTime);
+		}
+		bgLastRows[i] = record.lastRow;
+		valid = command.restoreState(state);
+		command.sleeping = record.sleeping;
+		command.wakeTime = (record.wakeIn == SnapshotCommand::NoWake) ? AutoTime::max() : tickTime + AutoTime(record.wakeIn);
+		command.sleepGeneration++;
+	}
+	bgScheduleValid = false; // Rebuilds the awake list and wake deadlines from the restored sleep state
+
+	if(!valid){
+		std::cerr << "Snapshot: damaged or does not match the script. The script will run from the start." << std::endl;
+		restartScript();
+		return false;
+	}
+	return true;
 }
 
 bool AutoManager::process(){
-	if(loadedCommandCount() < 1)
-		return false; // At the end of the non-existent script. Consider this the same as finished with a script
+	return process(clock->now());
+}
 
+bool AutoManager::processLinear(){
 	bool result = true;
-	// If the current command is done of there is no current command
-	if(currentCommand.get() == nullptr || currentCommand.get()->isComplete()){
+	// If the current command (or group) is done or there is no current command
+	if(groupActive ? groupFinished() : (currentCommand.get() == nullptr || currentCommand.get()->isComplete())){
 		// Move on to the next command
 		currentCommandIndex++;
-		currentCommand.release();
+		recycleCurrentCommand();
+		recycleGroup();
 
-		// If this is the end of the loadedCommands will return false, but still needs to reach processing of bg commands
-		if(currentCommandIndex >= ((int)loadedCommands.size())){
+		// If this is the end of the script will return false, but still needs to reach processing of bg commands
+		if(currentCommandIndex >= script.size()){
 			result =  false;
+			if(currentCommandIndex == script.size())
+				currentCommandIndex--; // Rows appended later (injected) run next
 		}else{
 			// Handle the next several (if any) background commands
 			handleNextBgCommands();
 
-			// If this is the end of the loadedCommands will return false, but still needs to reach processing of bg commands
-			if(currentCommandIndex >= ((int)loadedCommands.size())){
+			// If this is the end of the script will return false, but still needs to reach processing of bg commands
+			if(currentCommandIndex >= script.size()){
 				result =  false;
+				currentCommandIndex = script.size() - 1;
 			}else{
 				// Get next command
-				std::string key = loadedCommands[currentCommandIndex];
-				std::transform(key.begin(), key.end(), key.begin(), ::tolower);
-				if(registeredCommands.find(key) != registeredCommands.end()){
-					currentCommand = registeredCommands[key](); // Run the creator for this command
+				const ScriptRow &row = script.row(currentCommandIndex);
+				if(row.opcode.kind == AutoOpcode::Command){
+					currentCommand = acquireCommand(row.opcode.index); // Reuse a finished command or run the creator for this command
+					currentCommandCreator = row.opcode.index;
+				}else if(row.opcode.kind == AutoOpcode::GroupBegin){
+					startGroup();
 				}else{
-					std::cerr << "WARNING: No command registered for key \"" << key << "\". Command will be skipped." << std::endl;
+					skipRow(currentCommandIndex);
 				}
 			}
 		}
+	}
+
+	// start or process the current command or group (if it were completed it will have been handled above)
+	if(groupActive)
+		processGroup();
+	else if(currentCommand.get() != nullptr)
+		runCommand(*currentCommand, currentCommandCreator, currentCommandIndex);
 
-		
+	return result;
+}
+
+bool AutoManager::processGraph(){
+	const ScriptGraph &graph = script.graph();
+	if(!graphStarted){
+		// First tick of a run
+		graphWaiting = graph.dependencyCount;
+		graphReady.assign(graph.roots.begin(), graph.roots.end());
+		graphStarted = true;
 	}
 
-	// start or process the current command (if it were completed it will have been handled above)
-	if(currentCommand.get() != nullptr){
-		if(!currentCommand.get()->hasStarted()){
-			currentCommand.get()->doStart(loadedCommands[currentCommandIndex], loadedArguments[currentCommandIndex]);
-			currentCommand.get()->process();
-		}else{
-			currentCommand.get()->doProcess();
+	// Start everything that is ready. Background rows (and skipped rows) finish right away so their dependents
+	// are appended and started this tick too.
+	for(size_t i = 0; i < graphReady.size(); ++i){
+		uint32_t rowIndex = graphReady[i];
+		const ScriptRow &row = script.row(rowIndex);
+		if(row.opcode.kind == AutoOpcode::Command){
+			ActiveCommand active;
+			active.command = acquireCommand(row.opcode.index);
+			active.creator = row.opcode.index;
+			active.row = rowIndex;
+			graphRunning.push_back(std::move(active));
+			continue;
+		}
+		if(row.opcode.kind == AutoOpcode::Background)
+			updateBgCommand(rowIndex);
+		else
+			skipRow(rowIndex);
+		releaseGraphRow(rowIndex);
+	}
+	graphReady.clear();
+
+	// Start or process the running commands. Dependents of the ones that finish start next tick.
+	// The unfinished commands are moved up in place so commands are always processed in the order they started.
+	size_t kept = 0;
+	for(size_t i = 0; i < graphRunning.size(); ++i){
+		ActiveCommand &active = graphRunning[i];
+		runCommand(*active.command, active.creator, active.row);
+		if(!active.command->isComplete()){
+			if(kept != i)
+				graphRunning[kept] = std::move(active);
+			kept++;
+			continue;
 		}
+		size_t rowIndex = active.row;
+		recycleCommand(active.command, active.creator);
+		releaseGraphRow(rowIndex);
+	}
+	graphRunning.erase(graphRunning.begin() + kept, graphRunning.end());
+
+	return !graphRunning.empty() || !graphReady.empty();
+}
+
+void AutoManager::releaseGraphRow(size_t rowIndex){
+	const ScriptGraph &graph = script.graph();
+	for(uint32_t d = graph.dependentStart[rowIndex]; d < graph.dependentStart[rowIndex + 1]; ++d){
+		uint32_t dependent = graph.dependents[d];
+		if(--graphWaiting[dependent] == 0)
+			graphReady.push_back(dependent);
+	}
+}
+
+
+bool AutoManager::process(AutoTime now){
+	// Switch to a preloaded script between ticks
+	if(scriptSwapPending.load(std::memory_order_acquire)){
+		scriptSwapPending.store(false, std::memory_order_relaxed);
+		PreparedScriptPointer prepared = std::atomic_exchange(&pendingScript, PreparedScriptPointer());
+		if(prepared != nullptr)
+			installScript(std::move(prepared));
+	}
+
+	if(injectedCommands != nullptr)
+		drainInjectedCommands();
+
+	if(loadedCommandCount() < 1)
+		return false; // At the end of the non-existent script. Consider this the same as finished with a script
+
+	tickTime = now;
+	if(telemetry != nullptr)
+		telemetry->record(TelemetryEvent::Tick, 0, 0, 0, now);
+
+	AutoTime profileTickStart{0};
+	uint64_t profileAllocations = 0;
+	if(profiler != nullptr){
+		profileTickStart = AutoProfiler::now();
+		profileAllocations = profiler->allocations();
 	}
 
+	// Rows are resolved when they are added or registered. This only does work for an injected group or graph row
+	// or a preloaded script that was resolved against older registrations.
+	resolveScript();
+
+	bool result = script.graph().enabled ? processGraph() : processLinear();
+
 	// Process background commands
-	for (auto const &element : uniqueBgCommands){
-		if(element.get()->shouldProcess())
-			element.get()->process();
+	processBgCommands();
+
+	if(snapshotBuffer != nullptr){
+		size_t capacity = 0;
+		uint8_t *slot = snapshotBuffer->writeSlot(capacity);
+		size_t size = saveSnapshot(slot, capacity);
+		if(size > 0)
+			snapshotBuffer->publish(size);
+		else
+			snapshotBuffer->recordDropped();
+	}
+
+	if(profiler != nullptr){
+		profiler->record(AutoProfiler::Kind::Tick, 0, profileTickStart, AutoProfiler::now() - profileTickStart);
+		profiler->recordAllocations(profiler->allocations() - profileAllocations);
 	}
 
 	return result; // True if there are more commands to handle in the script (this could be false but bg commands still need to run)
 }
 
 void AutoManager::killAuto(){
-	if(currentCommand.get() != nullptr)
+	if(currentCommand.get() != nullptr && !currentCommand->isComplete()){
 		currentCommand.get()->complete();
-	currentCommandIndex = loadedCommands.size();
-	currentCommand.release();
+		if(telemetry != nullptr)
+			logCommandEnd(*currentCommand, currentCommandCreator, currentCommandIndex, true);
+	}
+	for(ActiveCommand &groupCommand : groupCommands){
+		if(!groupCommand.command->isComplete()){
+			groupCommand.command->complete();
+			if(telemetry != nullptr)
+				logCommandEnd(*groupCommand.command, groupCommand.creator, groupCommand.row, true);
+		}
+	}
+	for(ActiveCommand &active : graphRunning){
+		if(!active.command->isComplete()){
+			active.command->complete();
+			if(telemetry != nullptr)
+				logCommandEnd(*active.command, active.creator, active.row, true);
+		}
+		recycleCommand(active.command, active.creator);
+	}
+	graphRunning.clear();
+	graphReady.clear();
+	graphWaiting.clear(); // Rows after the killed commands (or added later) never start
+	graphStarted = true;  // Stay at the end of the graph until the script is restarted
+	currentCommandIndex = script.size();
+	recycleCurrentCommand();
+	recycleGroup();
 
 	// Kill all background commands
-	for (auto const &element : uniqueBgCommands){
-		element.get()->kill();
+	for (BackgroundAutoCommand *command : uniqueBgCommands){
+		command->kill();
 	}
 }
@@ -0,0 +1,133 @@
+/**
+ * autoprofiler.cpp
+ * See autoprofiler.hpp for details.
+ *
+ * Copyright (c) 2018 FRC Team 2655 - The Flying Platypi
+ * See LICENSE file for details
+ */
+
+#include "autoprofiler.hpp"
+
+#include <algorithm>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+using namespace team2655;
+
+////////////////////////////////////////////////////////////////////////
+/// LatencyHistogram
+////////////////////////////////////////////////////////////////////////
+
+static int highestBit(uint64_t value){
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanReverse64(&index, value);
+	return (int)index;
+#else
+	return 63 - __builtin_clzll(value);
+#endif
+}
+
+int LatencyHistogram::bucketIndex(uint64_t value){
+	const uint64_t subBuckets = 1 << SubBucketBits;
+	if(value < subBuckets)
+		return (int)value;
+	int exponent = highestBit(value);
+	int sub = (int)((value >> (exponent - SubBucketBits)) & (subBuckets - 1));
+	return ((exponent - SubBucketBits + 1) << SubBucketBits) + sub;
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(int index){
+	const int subBuckets = 1 << SubBucketBits;
+	if(index < subBuckets)
+		return (uint64_t)index;
+	int exponent = (index >> SubBucketBits) + SubBucketBits - 1;
+	uint64_t sub = (uint64_t)(index & (subBuckets - 1));
+	uint64_t width = (uint64_t)1 << (exponent - SubBucketBits);
+	return ((subBuckets + sub) << (exponent - SubBucketBits)) + width - 1;
+}
+
+void LatencyHistogram::record(uint64_t value){
+	buckets[bucketIndex(value)]++;
+	count++;
+	total += value;
+	maxValue = std::max(maxValue, value);
+}
+
+uint64_t LatencyHistogram::percentile(double percentile) const{
+	if(count == 0)
+		return 0;
+	uint64_t target = (uint64_t)(percentile / 100.0 * count + 0.5);
+	target = std::max<uint64_t>(target, 1);
+	uint64_t seen = 0;
+	for(int i = 0; i < BucketCount; ++i){
+		seen += buckets[i];
+		if(seen >= target)
+			return std::min(bucketUpperBound(i), maxValue);
+	}
+	return maxValue;
+}
+
+void LatencyHistogram::reset(){
+	buckets.fill(0);
+	count = 0;
+	total = 0;
+	maxValue = 0;
+}
+
+////////////////////////////////////////////////////////////////////////
+/// AutoProfiler
+////////////////////////////////////////////////////////////////////////
+
+void AutoProfiler::record(Kind kind, uint32_t index, AutoTime start, AutoTime duration){
+	std::vector<LatencyHistogram> &kindHistograms = histograms[(int)kind];
+	if(index >= kindHistograms.size())
+		kindHistograms.resize(index + 1); // Only the first measurement of a command allocates
+	kindHistograms[index].record((uint64_t)duration.count());
+
+	if(!trace.empty()){
+		TraceEvent &event = trace[traceNext];
+		event.kind = kind;
+		event.index = index;
+		event.start = start;
+		event.duration = duration;
+		traceNext++;
+		if(traceNext == trace.size()){
+			traceNext = 0;
+			traceWrapped = true;
+		}
+	}
+}
+
+void AutoProfiler::enableTrace(size_t maxEvents){
+	trace.assign(maxEvents, TraceEvent());
+	traceNext = 0;
+	traceWrapped = false;
+}
+
+const LatencyHistogram &AutoProfiler::histogram(Kind kind, uint32_t index) const{
+	static const LatencyHistogram empty;
+	const std::vector<LatencyHistogram> &kindHistograms = histograms[(int)kind];
+	return (index < kindHistograms.size()) ? kindHistograms[index] : empty;
+}
+
+std::vector<AutoProfiler::TraceEvent> AutoProfiler::traceEvents() const{
+	std::vector<TraceEvent> events;
+	if(traceWrapped)
+		events.insert(events.end(), trace.begin() + traceNext, trace.end());
+	events.insert(events.end(), trace.begin(), trace.begin() + traceNext);
+	return events;
+}
+
+void AutoProfiler::reset(){
+	for(std::vector<LatencyHistogram> &kindHistograms : histograms){
+		for(LatencyHistogram &histogram : kindHistograms){
+			histogram.reset();
+		}
+	}
+	allocationsPerTick.reset();
+	traceNext = 0;
+	traceWrapped = false;
+}
@@ -0,0 +1,141 @@
+/**
+ * autorunner.cpp
+ * See autorunner.hpp for details.
+ *
+ * Copyright (c) 2018 FRC Team 2655 - The Flying Platypi
+ * See LICENSE file for details
+ */
+
+#include "autorunner.hpp"
+
+#include <thread>
+#include <chrono>
+#include <algorithm>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <cerrno>
+#endif
+
+using namespace team2655;
+
+static AutoTime steadyNow(){
+	return SteadyAutoClock::instance().now();
+}
+
+PeriodicRunner::PeriodicRunner(AutoManager &manager, double rateHz) : manager(manager){
+	setRate(rateHz);
+}
+
+void PeriodicRunner::setRate(double rateHz){
+	period = std::chrono::duration_cast<AutoTime>(std::chrono::duration<double>(1.0 / rateHz));
+}
+
+void PeriodicRunner::setPeriod(AutoTime period){
+	this->period = period;
+}
+
+void PeriodicRunner::setOverrunPolicy(OverrunPolicy policy){
+	this->policy = policy;
+}
+
+bool PeriodicRunner::pinCurrentThread(int cpu){
+#ifdef __linux__
+	cpu_set_t cpus;
+	CPU_ZERO(&cpus);
+	CPU_SET(cpu, &cpus);
+	return pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) == 0;
+#else
+	(void)cpu;
+	return false;
+#endif
+}
+
+bool PeriodicRunner::setRealtimePriority(int priority){
+#ifdef __linux__
+	sched_param param;
+	param.sched_priority = priority;
+	return pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0;
+#else
+	(void)priority;
+	return false;
+#endif
+}
+
+void PeriodicRunner::sleepUntil(AutoTime deadline){
+#ifdef __linux__
+	// steady_clock is CLOCK_MONOTONIC on Linux. Sleeping to an absolute time cannot oversleep because of
+	// time lost between computing and starting a relative sleep.
+	timespec ts;
+	ts.tv_sec = (time_t)std::chrono::duration_cast<std::chrono::seconds>(deadline).count();
+	ts.tv_nsec = (long)(deadline - std::chrono::seconds(ts.tv_sec)).count();
+	while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR){  }
+#else
+	std::this_thread::sleep_until(std::chrono::steady_clock::time_point(
+			std::chrono::duration_cast<std::chrono::steady_clock::duration>(deadline)));
+#endif
+}
+
+void PeriodicRunner::publishStats(bool wait){
+	if(resetRequested.exchange(false))
+		stats = Stats();
+	std::unique_lock<std::mutex> lock(statsMutex, std::defer_lock);
+	if(wait)
+		lock.lock();
+	else if(!lock.try_lock())
+		return; // Never block the control loop on a reader
+	publishedStats = stats;
+}
+
+void PeriodicRunner::run(){
+	// A manager on the steady clock is given the time sampled for the tick instead of reading the clock again
+	bool steadyManager = &manager.getClock() == &SteadyAutoClock::instance();
+	AutoTime deadline = steadyNow();
+	// The request is consumed when run() returns because of it (a stop before run() is not lost)
+	while(!stopRequested.exchange(false)){
+		sleepUntil(deadline);
+
+		AutoTime start = steadyNow();
+		bool hasMore = steadyManager ? manager.process(start) : manager.process();
+		AutoTime end = steadyNow();
+
+		AutoTime jitter = std::max(start - deadline, AutoTime(0));
+		stats.ticks++;
+		stats.totalJitter += jitter;
+		stats.maxJitter = std::max(stats.maxJitter, jitter);
+		stats.maxTickTime = std::max(stats.maxTickTime, end - start);
+
+		if(!hasMore)
+			break;
+
+		deadline += period;
+		if(end > deadline){
+			stats.overruns++;
+			if(policy == OverrunPolicy::Skip){
+				// Move to the first deadline that is still in the future
+				uint64_t missed = (uint64_t)((end - deadline) / period) + 1;
+				stats.skippedTicks += missed;
+				deadline += period * missed;
+			}
+		}
+		publishStats(false);
+	}
+	publishStats(true);
+}
+
+void PeriodicRunner::stop(){
+	stopRequested = true;
+}
+
+PeriodicRunner::Stats PeriodicRunner::getStats() const{
+	std::lock_guard<std::mutex> lock(statsMutex);
+	return publishedStats;
+}
+
+void PeriodicRunner::resetStats(){
+	std::lock_guard<std::mutex> lock(statsMutex);
+	publishedStats = Stats();
+	resetRequested = true;
+}
@@ -0,0 +1,500 @@
+/**
+ * autoscript.cpp
+ * See autoscript.hpp for details.
+ *
+ * Copyright (c) 2018 FRC Team 2655 - The Flying Platypi
+ * See LICENSE file for details
+ */
+
+#include "autoscript.hpp"
+
+#include <cstring>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define AUTOHELPER_HAS_MMAP
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace team2655;
+
+////////////////////////////////////////////////////////////////////////
+/// AutoOpcode
+////////////////////////////////////////////////////////////////////////
+
+AutoOpcode AutoOpcode::builtin(std::string_view name){
+	AutoOpcode opcode;
+	for(const Builtin &builtin : builtins){
+		if(name == builtin.name){
+			opcode.kind = builtin.kind;
+			opcode.index = builtin.group;
+			break;
+		}
+	}
+	return opcode;
+}
+
+////////////////////////////////////////////////////////////////////////
+/// ScriptArena
+////////////////////////////////////////////////////////////////////////
+
+char *ScriptArena::allocate(size_t size, size_t alignment){
+	if(!blocks.empty()){
+		Block &block = blocks.back();
+		size_t start = (block.used + alignment - 1) & ~(alignment - 1);
+		if(start + size <= block.size){
+			block.used = start + size;
+			return block.data.get() + start;
+		}
+	}
+
+	// Large allocations (a whole script file) get a block of their own.
+	// Blocks come from new[] so they are aligned for any fundamental type.
+	Block block;
+	block.size = std::max(size, BlockSize);
+	block.data.reset(new char[block.size]);
+	block.used = size;
+	blocks.push_back(std::move(block));
+	return blocks.back().data.get();
+}
+
+std::string_view ScriptArena::store(std::string_view text){
+	if(text.empty())
+		return std::string_view();
+	char *data = allocate(text.size());
+	std::memcpy(data, text.data(), text.size());
+	return std::string_view(data, text.size());
+}
+
+void ScriptArena::clear(){
+	blocks.clear();
+}
+
+size_t ScriptArena::capacity() const{
+	size_t total = 0;
+	for(const Block &block : blocks){
+		total += block.size;
+	}
+	return total;
+}
+
+////////////////////////////////////////////////////////////////////////
+/// ScriptCsvParser
+////////////////////////////////////////////////////////////////////////
+
+static inline bool isSpace(char c){
+	return c == ' ' || c == '\t';
+}
+
+static inline bool isFieldEnd(char c){
+	return c == ',' || c == '\n' || c == '\r';
+}
+
+ScriptCsvParser::ScriptCsvParser(char *data, size_t size) : pos(data), end(data + size){
+
+}
+
+bool ScriptCsvParser::nextRow(std::vector<std::string_view> &fields){
+	fields.clear();
+	while(pos < end){
+		// Parse one line
+		while(true){
+			while(pos < end && isSpace(*pos))
+				pos++;
+
+			if(pos < end && *pos == '"'){
+				// Quoted field. Unescape "" in place (the result is never longer than the source)
+				pos++;
+				char *start = pos;
+				char *out = pos;
+				while(pos < end){
+					if(*pos == '"'){
+						if(pos + 1 < end && pos[1] == '"'){
+							*out++ = '"';
+							pos += 2;
+							continue;
+						}
+						pos++;
+						break;
+					}
+					*out++ = *pos++;
+				}
+				fields.emplace_back(start, out - start);
+				// Ignore anything between the closing quote and the next delimiter
+				while(pos < end && !isFieldEnd(*pos))
+					pos++;
+			}else{
+				char *start = pos;
+				while(pos < end && !isFieldEnd(*pos))
+					pos++;
+				char *stop = pos;
+				while(stop > start && isSpace(stop[-1]))
+					stop--;
+				fields.emplace_back(start, stop - start);
+			}
+
+			if(pos < end && *pos == ','){
+				pos++;
+				continue;
+			}
+
+			// End of line. Any of \r\n, \r or \n
+			if(pos < end && *pos == '\r')
+				pos++;
+			if(pos < end && *pos == '\n')
+				pos++;
+			break;
+		}
+
+		while(!fields.empty() && fields.back().empty())
+			fields.pop_back();
+
+		if(!fields.empty())
+			return true; // Blank lines are skipped
+	}
+	return false;
+}
+
+////////////////////////////////////////////////////////////////////////
+/// MappedFile
+////////////////////////////////////////////////////////////////////////
+
+MappedFile::MappedFile(MappedFile &&other) : fileData(other.fileData), fileSize(other.fileSize), buffer(std::move(other.buffer)){
+	other.fileData = nullptr;
+	other.fileSize = 0;
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&other){
+	if(this != &other){
+		close();
+		fileData = other.fileData;
+		fileSize = other.fileSize;
+		buffer = std::move(other.buffer);
+		other.fileData = nullptr;
+		other.fileSize = 0;
+	}
+	return *this;
+}
+
+MappedFile::~MappedFile(){
+	close();
+}
+
+bool MappedFile::open(const std::string &fileName){
+	close();
+#ifdef AUTOHELPER_HAS_MMAP
+	int fd = ::open(fileName.c_str(), O_RDONLY);
+	if(fd < 0)
+		return false;
+	struct stat info;
+	if(fstat(fd, &info) != 0){
+		::close(fd);
+		return false;
+	}
+	fileSize = (size_t)info.st_size;
+	if(fileSize == 0){
+		::close(fd);
+		return true;
+	}
+	void *mapping = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd); // The mapping keeps the file open
+	if(mapping == MAP_FAILED){
+		fileSize = 0;
+		return false;
+	}
+	fileData = static_cast<const char*>(mapping);
+	return true;
+#else
+	std::ifstream file(fileName, std::ios::binary | std::ios::ate);
+	if(!file.good())
+		return false;
+	fileSize = (size_t)file.tellg();
+	file.seekg(0, std::ios::beg);
+	buffer.reset(new char[fileSize]);
+	if(!file.read(buffer.get(), fileSize)){
+		close();
+		return false;
+	}
+	fileData = buffer.get();
+	return true;
+#endif
+}
+
+void MappedFile::close(){
+#ifdef AUTOHELPER_HAS_MMAP
+	if(fileData != nullptr && buffer == nullptr)
+		munmap(const_cast<char*>(fileData), fileSize);
+#endif
+	buffer.reset();
+	fileData = nullptr;
+	fileSize = 0;
+}
+
+////////////////////////////////////////////////////////////////////////
+/// AutoScript
+////////////////////////////////////////////////////////////////////////
+
+uint32_t AutoScript::internName(std::string_view name){
+	internScratch.assign(name.begin(), name.end());
+	std::transform(internScratch.begin(), internScratch.end(), internScratch.begin(), ::tolower);
+	auto it = nameIds.find(internScratch);
+	if(it != nameIds.end())
+		return it->second;
+	uint32_t id = (uint32_t)names.size();
+	std::string_view stored = arena.store(internScratch);
+	names.push_back(stored);
+	nameIds[stored] = id;
+	return id;
+}
+
+bool AutoScript::findName(std::string_view name, uint32_t &id) const{
+	auto it = nameIds.find(name);
+	if(it == nameIds.end())
+		return false;
+	id = it->second;
+	return true;
+}
+
+ScriptRow AutoScript::makeRow(std::string_view name, const std::string_view *args, size_t argCount, bool copyArgs){
+	ScriptRow row;
+	row.nameId = internName(name);
+	row.argCount = (uint32_t)argCount;
+	row.annotationCount = 0;
+	std::string_view *rowArgs = arena.allocateArray<std::string_view>(argCount);
+	for(size_t i = 0; i < argCount; ++i){
+		rowArgs[i] = copyArgs ? arena.store(args[i]) : args[i];
+	}
+	row.args = rowArgs;
+	row.parsed = nullptr;
+	return row;
+}
+
+bool AutoScript::loadCsv(const std::string &fileName){
+	std::ifstream scriptFile(fileName, std::ios::binary | std::ios::ate);
+
+	if(!scriptFile.good()){
+		std::cerr << "Script file: \"" << fileName << "\" not found." << std::endl;
+		return false; // Some error accessing the file
+	}
+
+	// Read the whole file into the arena in one read. Commands and arguments are views into this text.
+	std::streamoff fileSize = scriptFile.tellg();
+	scriptFile.seekg(0, std::ios::beg);
+	char *csvData = arena.allocate((size_t)fileSize);
+	if(!scriptFile.read(csvData, fileSize)){
+		std::cerr << "Script file: \"" << fileName << "\" could not be read." << std::endl;
+		return false;
+	}
+	scriptFile.close();
+
+	// Reserve the row table once instead of regrowing it for large scripts
+	rows.reserve(rows.size() + std::count(csvData, csvData + fileSize, '\n') + 1);
+
+	// Separate each row and column of the CSV
+	ScriptCsvParser parser(csvData, (size_t)fileSize);
+	std::vector<std::string_view> columns; // All the columns in the current row
+	while(parser.nextRow(columns)){
+		// The first column is the command. The rest of the columns are arguments
+		rows.push_back(makeRow(columns[0], columns.data() + 1, columns.size() - 1, false));
+	}
+	return true;
+}
+
+static bool sectionFits(uint32_t offset, uint64_t count, size_t elementSize, size_t fileSize){
+	return offset % 4 == 0 && offset <= fileSize && count * elementSize <= fileSize - offset;
+}
+
+bool AutoScript::loadBinary(const std::string &fileName){
+	MappedFile file;
+	if(!file.open(fileName)){
+		std::cerr << "Script file: \"" << fileName << "\" not found." << std::endl;
+		return false;
+	}
+
+	// Check everything the rows will reference before using any of it
+	BinaryScriptHeader header;
+	if(file.size() < sizeof(header)){
+		std::cerr << "Script file: \"" << fileName << "\" is not a compiled script." << std::endl;
+		return false;
+	}
+	std::memcpy(&header, file.data(), sizeof(header));
+	if(header.magic != BinaryScriptHeader::Magic || header.byteOrder != BinaryScriptHeader::ByteOrderMark){
+		std::cerr << "Script file: \"" << fileName << "\" is not a compiled script (or was compiled on a machine with a different byte order)." << std::endl;
+		return false;
+	}
+	if(header.version != BinaryScriptHeader::CurrentVersion){
+		std::cerr << "Script file: \"" << fileName << "\" was compiled for version " << header.version << " (expected "
+				<< BinaryScriptHeader::CurrentVersion << "). Recompile it." << std::endl;
+		return false;
+	}
+	if(header.fileSize != file.size() ||
+			!sectionFits(header.namesOffset, header.nameCount, sizeof(BinaryScriptName), file.size()) ||
+			!sectionFits(header.rowsOffset, header.rowCount, sizeof(BinaryScriptRow), file.size()) ||
+			!sectionFits(header.argsOffset, header.argCount, sizeof(BinaryScriptArg), file.size()) ||
+			!sectionFits(header.textOffset, header.textSize, 1, file.size())){
+		std::cerr << "Script file: \"" << fileName << "\" is corrupt." << std::endl;
+		return false;
+	}
+
+	const BinaryScriptName *fileNames = reinterpret_cast<const BinaryScriptName*>(file.data() + header.namesOffset);
+	const BinaryScriptRow *fileRows = reinterpret_cast<const BinaryScriptRow*>(file.data() + header.rowsOffset);
+	const BinaryScriptArg *fileArgs = reinterpret_cast<const BinaryScriptArg*>(file.data() + header.argsOffset);
+	const char *text = file.data() + header.textOffset;
+
+	for(uint32_t i = 0; i < header.nameCount; ++i){
+		if((uint64_t)fileNames[i].textOffset + fileNames[i].length > header.textSize){
+			std::cerr << "Script file: \"" << fileName << "\" is corrupt." << std::endl;
+			return false;
+		}
+	}
+	for(uint32_t i = 0; i < header.argCount; ++i){
+		if((uint64_t)fileArgs[i].textOffset + fileArgs[i].length > header.textSize){
+			std::cerr << "Script file: \"" << fileName << "\" is corrupt." << std::endl;
+			return false;
+		}
+	}
+	for(uint32_t i = 0; i < header.rowCount; ++i){
+		if(fileRows[i].nameId >= header.nameCount || (uint64_t)fileRows[i].firstArg + fileRows[i].argCount > header.argCount){
+			std::cerr << "Script file: \"" << fileName << "\" is corrupt." << std::endl;
+			return false;
+		}
+	}
+
+	// The file's names may already be interned by earlier loads
+	std::vector<uint32_t> nameMap(header.nameCount);
+	for(uint32_t i = 0; i < header.nameCount; ++i){
+		nameMap[i] = internName(std::string_view(text + fileNames[i].textOffset, fileNames[i].length));
+	}
+
+	// One array of views for every argument in the file. The views point into the mapped text.
+	std::string_view *args = arena.allocateArray<std::string_view>(header.argCount);
+	for(uint32_t i = 0; i < header.argCount; ++i){
+		args[i] = std::string_view(text + fileArgs[i].textOffset, fileArgs[i].length);
+	}
+
+	rows.reserve(rows.size() + header.rowCount);
+	for(uint32_t i = 0; i < header.rowCount; ++i){
+		ScriptRow row;
+		row.nameId = nameMap[fileRows[i].nameId];
+		row.argCount = fileRows[i].argCount;
+		row.annotationCount = 0;
+		row.args = args + fileRows[i].firstArg;
+		row.parsed = nullptr;
+		rows.push_back(row);
+	}
+
+	mappedFiles.push_back(std::move(file));
+	return true;
+}
+
+bool AutoScript::load(const std::string &fileName){
+	uint32_t magic = 0;
+	std::ifstream scriptFile(fileName, std::ios::binary);
+	scriptFile.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+	scriptFile.close();
+	if(magic == BinaryScriptHeader::Magic)
+		return loadBinary(fileName);
+	return loadCsv(fileName);
+}
+
+static uint32_t alignSection(uint32_t offset){
+	return (offset + 3) & ~3u;
+}
+
+bool AutoScript::saveBinary(const std::string &fileName) const{
+	std::string text;
+	std::unordered_map<std::string_view, uint32_t> textOffsets; // Identical arguments share their text
+	auto storeText = [&](std::string_view value) -> uint32_t {
+		auto it = textOffsets.find(value);
+		if(it != textOffsets.end())
+			return it->second;
+		uint32_t offset = (uint32_t)text.size();
+		text.append(value.data(), value.size());
+		textOffsets[value] = offset;
+		return offset;
+	};
+
+	std::vector<BinaryScriptName> fileNames(names.size());
+	for(size_t i = 0; i < names.size(); ++i){
+		fileNames[i].textOffset = storeText(names[i]);
+		fileNames[i].length = (uint32_t)names[i].size();
+	}
+
+	std::vector<BinaryScriptRow> fileRows(rows.size());
+	std::vector<BinaryScriptArg> fileArgs;
+	for(size_t i = 0; i < rows.size(); ++i){
+		const ScriptRow &row = rows[i];
+		fileRows[i].nameId = row.nameId;
+		fileRows[i].firstArg = (uint32_t)fileArgs.size();
+		fileRows[i].argCount = row.argCount + row.annotationCount; // Annotations are loaded as arguments and split off when resolving
+		for(uint32_t a = 0; a < fileRows[i].argCount; ++a){
+			BinaryScriptArg arg = {};
+			arg.textOffset = storeText(row.args[a]);
+			arg.length = (uint32_t)row.args[a].size();
+			fileArgs.push_back(arg);
+		}
+	}
+
+	BinaryScriptHeader header = {};
+	header.magic = BinaryScriptHeader::Magic;
+	header.byteOrder = BinaryScriptHeader::ByteOrderMark;
+	header.version = BinaryScriptHeader::CurrentVersion;
+	header.nameCount = (uint32_t)fileNames.size();
+	header.rowCount = (uint32_t)fileRows.size();
+	header.argCount = (uint32_t)fileArgs.size();
+	header.textSize = (uint32_t)text.size();
+	header.namesOffset = alignSection(sizeof(header));
+	header.rowsOffset = alignSection(header.namesOffset + header.nameCount * sizeof(BinaryScriptName));
+	header.argsOffset = alignSection(header.rowsOffset + header.rowCount * sizeof(BinaryScriptRow));
+	header.textOffset = alignSection(header.argsOffset + header.argCount * sizeof(BinaryScriptArg));
+	header.fileSize = header.textOffset + header.textSize;
+
+	std::vector<char> data(header.fileSize, 0);
+	std::memcpy(data.data(), &header, sizeof(header));
+	std::memcpy(data.data() + header.namesOffset, fileNames.data(), fileNames.size() * sizeof(BinaryScriptName));
+	std::memcpy(data.data() + header.rowsOffset, fileRows.data(), fileRows.size() * sizeof(BinaryScriptRow));
+	std::memcpy(data.data() + header.argsOffset, fileArgs.data(), fileArgs.size() * sizeof(BinaryScriptArg));
+	std::memcpy(data.data() + header.textOffset, text.data(), text.size());
+
+	std::ofstream file(fileName, std::ios::binary | std::ios::trunc);
+	if(!file.good() || !file.write(data.data(), data.size())){
+		std::cerr << "Could not write compiled script: \"" << fileName << "\"." << std::endl;
+		return false;
+	}
+	return true;
+}
+
+void AutoScript::insert(size_t pos, std::string_view name, const std::vector<std::string> &arguments){
+	std::vector<std::string_view> args(arguments.begin(), arguments.end());
+	ScriptRow row = makeRow(name, args.data(), args.size(), true);
+	rows.insert(pos, &row, 1);
+}
+
+void AutoScript::insert(size_t pos, std::string_view name, const std::string_view *args, size_t argCount){
+	ScriptRow row = makeRow(name, args, argCount, true);
+	rows.insert(pos, &row, 1);
+}
+
+void AutoScript::insert(size_t pos, const std::vector<std::string> &names, const std::vector<std::vector<std::string>> &arguments){
+	std::vector<ScriptRow> newRows(names.size());
+	std::vector<std::string_view> args;
+	for(size_t i = 0; i < names.size(); ++i){
+		args.assign(arguments[i].begin(), arguments[i].end());
+		newRows[i] = makeRow(names[i], args.data(), args.size(), true);
+	}
+	rows.insert(pos, newRows.data(), newRows.size());
+}
+
+void AutoScript::clear(){
+	rows.clear();
+	names.clear();
+	nameIds.clear();
+	arena.clear();
+	mappedFiles.clear();
+	scriptGraph.clear();
+}
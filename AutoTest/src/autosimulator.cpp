@@ -0,0 +1,77 @@
+/**
+ * autosimulator.cpp
+ * See autosimulator.hpp for details.
+ *
+ * Copyright (c) 2018 FRC Team 2655 - The Flying Platypi
+ * See LICENSE file for details
+ */
+
+#include "autosimulator.hpp"
+#include "autothreads.hpp"
+
+#include <algorithm>
+
+using namespace team2655;
+
+AutoSimulator::AutoSimulator(AutoTime period, AutoTime timeLimit) : period(period), timeLimit(timeLimit){
+
+}
+
+SimulationResult AutoSimulator::run(AutoManager &manager) const{
+	SimulationResult result;
+	result.loaded = true;
+	AutoTime wallStart = SteadyAutoClock::instance().now();
+
+	FakeAutoClock clock;
+	AutoClock &previousClock = manager.getClock();
+	manager.setClock(&clock);
+	manager.restartScript();
+
+	while(clock.now() <= timeLimit){
+		result.ticks++;
+		if(!manager.process(clock.now())){
+			result.finished = true;
+			break;
+		}
+		clock.advance(period);
+	}
+	result.simulatedTime = std::min(clock.now(), timeLimit);
+	if(!result.finished)
+		manager.killAuto();
+
+	manager.setClock(&previousClock);
+	result.wallTime = SteadyAutoClock::instance().now() - wallStart;
+	return result;
+}
+
+namespace{
+
+// One case run by a pool task. Results are written to the case's own slot.
+struct SimulationTask{
+	const AutoSimulator *simulator;
+	const SimulationCase *simulationCase;
+	SimulationResult *result;
+	void operator()(){
+		AutoManager manager;
+		if(simulationCase->setup && !simulationCase->setup(manager))
+			return;
+		*result = simulator->run(manager);
+	}
+};
+
+}
+
+std::vector<SimulationResult> AutoSimulator::runBatch(const std::vector<SimulationCase> &cases, size_t threadCount) const{
+	std::vector<SimulationResult> results(cases.size());
+	std::vector<SimulationTask> tasks(cases.size());
+	WorkStealingPool pool(threadCount);
+	TaskGroup group;
+	for(size_t i = 0; i < cases.size(); ++i){
+		tasks[i].simulator = this;
+		tasks[i].simulationCase = &cases[i];
+		tasks[i].result = &results[i];
+		pool.submit(group, tasks[i]);
+	}
+	pool.wait(group);
+	return results;
+}
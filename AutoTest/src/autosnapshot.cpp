@@ -0,0 +1,140 @@
+/**
+ * autosnapshot.cpp
+ * See autosnapshot.hpp for details.
+ *
+ * Copyright (c) 2018 FRC Team 2655 - The Flying Platypi
+ * See LICENSE file for details
+ */
+
+#include "autosnapshot.hpp"
+
+#include <new>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define AUTOHELPER_HAS_MMAP
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace team2655;
+
+namespace{
+
+// Every part of the file starts on a cache line
+constexpr size_t Alignment = 64;
+
+size_t alignUp(size_t value){
+	return (value + Alignment - 1) / Alignment * Alignment;
+}
+
+uint64_t checksum(const uint8_t *data, size_t size){
+	// FNV-1a
+	uint64_t hash = 14695981039346656037ull;
+	for(size_t i = 0; i < size; ++i){
+		hash ^= data[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+}
+
+SnapshotBuffer::~SnapshotBuffer(){
+	close();
+}
+
+SnapshotBuffer::SlotHeader *SnapshotBuffer::slotHeader(uint64_t sequence) const{
+	size_t slotStride = alignUp(sizeof(SlotHeader) + slotSize);
+	return reinterpret_cast<SlotHeader*>(mapping + alignUp(sizeof(Header)) + (sequence % 2) * slotStride);
+}
+
+bool SnapshotBuffer::open(const std::string &fileName, size_t slotSize){
+	close();
+	this->slotSize = slotSize;
+	size_t size = alignUp(sizeof(Header)) + 2 * alignUp(sizeof(SlotHeader) + slotSize);
+
+#ifdef AUTOHELPER_HAS_MMAP
+	int fd = ::open(fileName.c_str(), O_RDWR | O_CREAT, 0644);
+	if(fd < 0)
+		return false;
+	struct stat info;
+	if(fstat(fd, &info) != 0 || ((size_t)info.st_size != size && ftruncate(fd, (off_t)size) != 0)){
+		::close(fd);
+		return false;
+	}
+	void *mapped = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	::close(fd); // The mapping keeps the file open
+	if(mapped == MAP_FAILED)
+		return false;
+	mapping = static_cast<uint8_t*>(mapped);
+#else
+	buffer.reset(new uint8_t[size]());
+	mapping = buffer.get();
+#endif
+	mappingSize = size;
+
+	// Start over if the file is new or was made for another slot size
+	Header *fileHeader = header();
+	if(fileHeader->magic != Header::Magic || fileHeader->version != SnapshotHeader::CurrentVersion || fileHeader->slotSize != slotSize){
+		fileHeader->magic = Header::Magic;
+		fileHeader->version = SnapshotHeader::CurrentVersion;
+		fileHeader->slotSize = slotSize;
+		new (&fileHeader->published) std::atomic<uint64_t>(0);
+	}
+	return true;
+}
+
+void SnapshotBuffer::close(){
+#ifdef AUTOHELPER_HAS_MMAP
+	if(mapping != nullptr && buffer == nullptr)
+		munmap(mapping, mappingSize);
+#endif
+	buffer.reset();
+	mapping = nullptr;
+	mappingSize = 0;
+}
+
+uint8_t *SnapshotBuffer::writeSlot(size_t &capacity){
+	if(mapping == nullptr){
+		capacity = 0;
+		return nullptr;
+	}
+	capacity = slotSize;
+	uint64_t next = header()->published.load(std::memory_order_relaxed) + 1;
+	return reinterpret_cast<uint8_t*>(slotHeader(next) + 1);
+}
+
+void SnapshotBuffer::publish(size_t size){
+	if(mapping == nullptr || size > slotSize)
+		return;
+	uint64_t next = header()->published.load(std::memory_order_relaxed) + 1;
+	SlotHeader *slot = slotHeader(next);
+	slot->sequence = next;
+	slot->size = size;
+	slot->checksum = checksum(reinterpret_cast<const uint8_t*>(slot + 1), size);
+	header()->published.store(next, std::memory_order_release);
+}
+
+bool SnapshotBuffer::latest(const uint8_t *&data, size_t &size) const{
+	if(mapping == nullptr)
+		return false;
+	uint64_t sequence = header()->published.load(std::memory_order_acquire);
+	if(sequence == 0)
+		return false;
+	const SlotHeader *slot = slotHeader(sequence);
+	if(slot->sequence != sequence || slot->size > slotSize)
+		return false;
+	const uint8_t *slotData = reinterpret_cast<const uint8_t*>(slot + 1);
+	if(checksum(slotData, slot->size) != slot->checksum)
+		return false;
+	data = slotData;
+	size = slot->size;
+	return true;
+}
+
+void SnapshotBuffer::clear(){
+	if(mapping != nullptr)
+		header()->published.store(0, std::memory_order_release);
+}
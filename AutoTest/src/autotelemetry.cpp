@@ -0,0 +1,159 @@
+/**
+ * autotelemetry.cpp
+ * See autotelemetry.hpp for details.
+ *
+ * Copyright (c) 2018 FRC Team 2655 - The Flying Platypi
+ * See LICENSE file for details
+ */
+
+#include "autotelemetry.hpp"
+
+#include <iostream>
+#include <chrono>
+#include <algorithm>
+
+using namespace team2655;
+
+TelemetryLog::~TelemetryLog(){
+	close();
+}
+
+bool TelemetryLog::open(const std::string &fileName, size_t capacity){
+	close();
+	file.open(fileName, std::ios::binary | std::ios::trunc);
+	if(!file.good()){
+		std::cerr << "Telemetry file: \"" << fileName << "\" could not be opened." << std::endl;
+		return false;
+	}
+	TelemetryHeader header;
+	header.magic = TelemetryHeader::Magic;
+	header.byteOrder = TelemetryHeader::ByteOrderMark;
+	header.version = TelemetryHeader::CurrentVersion;
+	header.eventSize = sizeof(TelemetryEvent);
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+	size_t size = 1;
+	while(size < capacity)
+		size <<= 1;
+	ring.reset(new TelemetryEvent[size]);
+	mask = size - 1;
+	head.store(0);
+	tail.store(0);
+	dropped.store(0);
+	droppedWritten = 0;
+	stopping.store(false);
+	writer = std::thread(&TelemetryLog::run, this);
+	return true;
+}
+
+void TelemetryLog::close(){
+	if(ring == nullptr)
+		return;
+	stopping.store(true);
+	writer.join();
+	save();
+	file.close();
+	ring.reset();
+	pendingNames.clear();
+}
+
+void TelemetryLog::setName(uint32_t nameId, std::string_view name){
+	std::lock_guard<std::mutex> lock(namesMutex);
+	pendingNames.emplace_back(nameId, std::string(name));
+}
+
+void TelemetryLog::run(){
+	while(!stopping.load()){
+		save();
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+}
+
+void TelemetryLog::save(){
+	// Events recorded after a setName call are only saved after the name. Their setName happened before
+	// head was read below, so taking the names after reading head gets them.
+	uint64_t first = tail.load(std::memory_order_relaxed);
+	uint64_t last = head.load(std::memory_order_acquire);
+	std::vector<std::pair<uint32_t, std::string>> names;
+	{
+		std::lock_guard<std::mutex> lock(namesMutex);
+		names.swap(pendingNames);
+	}
+	for(const auto &name : names){
+		TelemetryEvent event = {};
+		event.type = TelemetryEvent::Name;
+		event.index = name.first;
+		event.nameId = (uint32_t)name.second.size();
+		file.write(reinterpret_cast<const char*>(&event), sizeof(event));
+		static const char padding[8] = {};
+		file.write(name.second.data(), name.second.size());
+		file.write(padding, (8 - name.second.size() % 8) % 8);
+	}
+
+	// Events are written straight from the ring (in up to two contiguous pieces)
+	while(first != last){
+		size_t start = (size_t)(first & mask);
+		size_t count = (size_t)std::min<uint64_t>(last - first, mask + 1 - start);
+		file.write(reinterpret_cast<const char*>(&ring[start]), count * sizeof(TelemetryEvent));
+		first += count;
+		tail.store(first, std::memory_order_release);
+	}
+
+	uint64_t droppedNow = dropped.load(std::memory_order_relaxed);
+	if(droppedNow != droppedWritten){
+		TelemetryEvent event = {};
+		event.type = TelemetryEvent::Dropped;
+		event.nameId = (uint32_t)droppedNow;
+		file.write(reinterpret_cast<const char*>(&event), sizeof(event));
+		droppedWritten = droppedNow;
+	}
+	file.flush();
+}
+
+bool team2655::readTelemetry(const std::string &fileName, std::vector<TelemetryRecord> &records){
+	records.clear();
+	std::ifstream file(fileName, std::ios::binary);
+	if(!file.good()){
+		std::cerr << "Telemetry file: \"" << fileName << "\" not found." << std::endl;
+		return false;
+	}
+	TelemetryHeader header;
+	if(!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.magic != TelemetryHeader::Magic ||
+			header.byteOrder != TelemetryHeader::ByteOrderMark || header.version != TelemetryHeader::CurrentVersion ||
+			header.eventSize != sizeof(TelemetryEvent)){
+		std::cerr << "Telemetry file: \"" << fileName << "\" is not a telemetry log (or has a different version or byte order)." << std::endl;
+		return false;
+	}
+
+	TelemetryRecord record;
+	while(file.read(reinterpret_cast<char*>(&record.event), sizeof(TelemetryEvent))){
+		record.name.clear();
+		if(record.event.type == TelemetryEvent::Name){
+			size_t length = record.event.nameId;
+			size_t padded = (length + 7) / 8 * 8;
+			record.name.resize(padded);
+			if(!file.read(&record.name[0], padded)){
+				std::cerr << "Telemetry file: \"" << fileName << "\" is truncated." << std::endl;
+				return false;
+			}
+			record.name.resize(length);
+		}
+		records.push_back(record);
+	}
+	return true;
+}
+
+const char *team2655::telemetryTypeName(uint16_t type){
+	switch(type){
+	case TelemetryEvent::Tick: return "tick";
+	case TelemetryEvent::CommandStart: return "start";
+	case TelemetryEvent::CommandComplete: return "complete";
+	case TelemetryEvent::CommandTimeout: return "timeout";
+	case TelemetryEvent::CommandCancelled: return "cancelled";
+	case TelemetryEvent::CommandSkipped: return "skipped";
+	case TelemetryEvent::BackgroundUpdate: return "background";
+	case TelemetryEvent::Name: return "name";
+	case TelemetryEvent::Dropped: return "dropped";
+	default: return "unknown";
+	}
+}
@@ -0,0 +1,173 @@
+/**
+ * autothreads.cpp
+ * See autothreads.hpp for details.
+ *
+ * Copyright (c) 2018 FRC Team 2655 - The Flying Platypi
+ * See LICENSE file for details
+ */
+
+#include "autothreads.hpp"
+
+using namespace team2655;
+
+// The worker the current thread is (if it is a worker of a pool)
+static thread_local WorkStealingPool *currentPool = nullptr;
+static thread_local size_t currentWorker = 0;
+
+////////////////////////////////////////////////////////////////////////
+/// WorkStealingPool::Worker
+////////////////////////////////////////////////////////////////////////
+
+void WorkStealingPool::Worker::push(const Task &task){
+	if(count == tasks.size()){
+		// Full. Grow and unwrap the ring so the oldest task is first again.
+		std::vector<Task> grown(tasks.size() < 16 ? 16 : tasks.size() * 2);
+		for(size_t i = 0; i < count; ++i){
+			grown[i] = tasks[(head + i) % tasks.size()];
+		}
+		tasks.swap(grown);
+		head = 0;
+	}
+	tasks[(head + count) % tasks.size()] = task;
+	count++;
+}
+
+bool WorkStealingPool::Worker::popNewest(Task &task){
+	if(count == 0)
+		return false;
+	count--;
+	task = tasks[(head + count) % tasks.size()];
+	return true;
+}
+
+bool WorkStealingPool::Worker::popOldest(Task &task){
+	if(count == 0)
+		return false;
+	task = tasks[head];
+	head = (head + 1) % tasks.size();
+	count--;
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////
+/// WorkStealingPool
+////////////////////////////////////////////////////////////////////////
+
+WorkStealingPool::WorkStealingPool(size_t threadCount){
+	if(threadCount == 0)
+		threadCount = std::thread::hardware_concurrency();
+	if(threadCount == 0)
+		threadCount = 1;
+
+	for(size_t i = 0; i < threadCount; ++i){
+		workers.push_back(std::unique_ptr<Worker>(new Worker()));
+	}
+	for(size_t i = 0; i < threadCount; ++i){
+		threads.push_back(std::thread(&WorkStealingPool::workerLoop, this, i));
+	}
+}
+
+WorkStealingPool::~WorkStealingPool(){
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		stopping = true;
+	}
+	sleepCondition.notify_all();
+	for(std::thread &thread : threads){
+		thread.join();
+	}
+}
+
+bool WorkStealingPool::takeTask(size_t preferred, Task &task){
+	if(pending.load(std::memory_order_acquire) == 0)
+		return false;
+
+	// Own queue first (newest task, it is most likely to be in cache)
+	{
+		Worker &worker = *workers[preferred];
+		std::lock_guard<std::mutex> lock(worker.mutex);
+		if(worker.popNewest(task)){
+			pending--;
+			return true;
+		}
+	}
+
+	// Steal the oldest task from another worker
+	for(size_t i = 1; i < workers.size(); ++i){
+		Worker &worker = *workers[(preferred + i) % workers.size()];
+		std::lock_guard<std::mutex> lock(worker.mutex);
+		if(worker.popOldest(task)){
+			pending--;
+			return true;
+		}
+	}
+	return false;
+}
+
+void WorkStealingPool::runTask(const Task &task){
+	task.run(task.context);
+	if(task.group->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1){
+		// Last task of the group. Take the lock so a waiter checking the group cannot miss this notification.
+		{
+			std::lock_guard<std::mutex> lock(doneMutex);
+		}
+		doneCondition.notify_all();
+	}
+}
+
+void WorkStealingPool::submitTask(const Task &task){
+	task.group->remaining.fetch_add(1, std::memory_order_relaxed);
+
+	// Counted before it is queued so a thread taking it can never take pending below 0
+	pending++;
+
+	// Tasks submitted by a worker go to its own queue. Others are spread over the workers.
+	size_t target = (currentPool == this) ? currentWorker : (nextWorker++ % workers.size());
+	{
+		Worker &worker = *workers[target];
+		std::lock_guard<std::mutex> lock(worker.mutex);
+		worker.push(task);
+	}
+
+	// Take the sleep lock so a worker checking for work cannot miss this notification
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+	}
+	sleepCondition.notify_one();
+}
+
+void WorkStealingPool::wait(TaskGroup &group){
+	bool worker = currentPool == this;
+	size_t preferred = worker ? currentWorker : 0;
+	Task task;
+	while(!group.done()){
+		if(takeTask(preferred, task)){
+			runTask(task);
+		}else if(worker){
+			// The group's other tasks are running on other workers. Stay ready to take tasks they submit.
+			std::this_thread::yield();
+		}else{
+			// Nothing left to help with. Sleep until the group's last task finishes.
+			std::unique_lock<std::mutex> lock(doneMutex);
+			doneCondition.wait(lock, [&group](){ return group.done(); });
+		}
+	}
+}
+
+void WorkStealingPool::workerLoop(size_t index){
+	currentPool = this;
+	currentWorker = index;
+
+	Task task;
+	while(true){
+		if(takeTask(index, task)){
+			runTask(task);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		sleepCondition.wait(lock, [this](){ return stopping || pending.load() > 0; });
+		if(stopping)
+			return;
+	}
+}
@@ -1,61 +1,55 @@
 #include <autonomous.hpp>
+#include <autorunner.hpp>
+#include <autosimulator.hpp>
 
 #include <iostream>
 #include <string>
 #include <vector>
-#include <thread>
 #include <chrono>
+#include <tuple>
 
 using namespace team2655;
 
 // Blocking command to drive
-class DriveCommand: public AutoCommand{
+class DriveCommand: public TypedAutoCommand<double>{
 public:
-    void start(std::string commandName, std::vector<std::string> args) override {
-        // Make sure there are enough arguments
-        if(args.size() < 1){
-            // Not enough arguments. Complete and exit function
-            complete();
-            return;
-        }
-        // Set the timeout for command based on the arguments
-        setTimeout((int)(stod(args[0]) * 1000));
+    // Argument is the time in seconds (validated when the script is loaded)
+    // The timeout for the command is based on the arguments (and lets scripts be checked for how long they run)
+    static AutoTime timeoutFor(const std::tuple<double> &args){
+        return std::chrono::duration_cast<AutoTime>(std::chrono::duration<double>(std::get<0>(args)));
     }
+    void start(std::string_view commandName, const std::tuple<double> &args) override {  }
     void process() override {
-        std::cout << "Process drive." << std::endl;
+        std::cout << "Process drive.\n";
     }
     void handleComplete() override {
-        std::cout << "Complete drive." << std::endl;
+        std::cout << "Complete drive.\n";
     }
 };
 
 // Blocking command to rotate
-class RotateCommand: public AutoCommand{
+class RotateCommand: public TypedAutoCommand<double>{
 public:
-    void start(std::string commandName, std::vector<std::string> args) override {
-        // Make sure there are enough arguments
-        if(args.size() < 1){
-            // Not enough arguments. Complete and exit function
-            complete();
-            return;
-        }
-        // Set the timeout for command based on the arguments
-        setTimeout((int)(stod(args[0]) * 1000));
+    // Argument is the time in seconds (validated when the script is loaded)
+    // The timeout for the command is based on the arguments (and lets scripts be checked for how long they run)
+    static AutoTime timeoutFor(const std::tuple<double> &args){
+        return std::chrono::duration_cast<AutoTime>(std::chrono::duration<double>(std::get<0>(args)));
     }
+    void start(std::string_view commandName, const std::tuple<double> &args) override {  }
     void process() override {
-        std::cout << "Process rotate." << std::endl;
+        std::cout << "Process rotate.\n";
     }
     void handleComplete() override {
-        std::cout << "Complete rotate." << std::endl;
+        std::cout << "Complete rotate.\n";
     }
 };
 
 // Background command to handle intake
-class IntakeCommand : public BackgroundAutoCommand{
+class IntakeCommand : public TypedBackgroundAutoCommand<>{
 private:
     double speed = 0;
 public:
-    virtual void updateArgs(std::string commandName, std::vector<std::string> args) override {
+    virtual void updateArgs(std::string_view commandName, const std::tuple<> &args) override {
         if(commandName == "intake_in"){
             speed = 1;
         }else if(commandName == "intake_out"){
@@ -66,10 +60,10 @@ public:
         }
     }
 	virtual void process() override {
-        std::cout << "Move intake " << speed << std::endl;
+        std::cout << "Move intake " << speed << '\n';
     }
 	virtual void kill() override {
-        std::cout << "Stop intake motors." << std::endl;
+        std::cout << "Stop intake motors.\n";
     }
 	virtual bool shouldProcess() override {
         return speed != 0;
@@ -77,54 +71,131 @@ public:
 };
 
 // Background command to handle lifter
-class LifterCommand : public BackgroundAutoCommand {
+class LifterCommand : public TypedBackgroundAutoCommand<int> {
 private:
     int targetPos = 0;
     int currentPos = 0;
 public:
-    virtual void updateArgs(std::string commandName, std::vector<std::string> args) override {
-        if(args.size()  >= 1){
-            targetPos = stoi(args[0]);
-        }
+    virtual void updateArgs(std::string_view commandName, const std::tuple<int> &args) override {
+        targetPos = std::get<0>(args);
     }
 	virtual void process() override {
         if(targetPos > currentPos){
-            std::cout << "raise lifter" << std::endl;
+            std::cout << "raise lifter\n";
             currentPos++;
         }else{
-            std::cout << "lower lifter" << std::endl;
+            std::cout << "lower lifter\n";
             currentPos--;
         }
     }
 	virtual void kill() override {
         targetPos = currentPos;
-        std::cout << "Stop lifter" << std::endl;
+        std::cout << "Stop lifter\n";
     }
 	virtual bool shouldProcess() override {
         return abs(targetPos - currentPos) != 0;
     }
+    // Where the lifter is is not in the script so it is saved with snapshots (targetPos comes back from the script row)
+    virtual void saveState(SnapshotWriter &out) override {
+        out.write(currentPos);
+    }
+    virtual bool restoreState(SnapshotReader &in) override {
+        return in.read(currentPos);
+    }
 };
 
 AutoManager manager;
 
-int main(){
-    // Register commands with their names
-    manager.registerCommand(CommandCreator<DriveCommand>, "drive");
-    manager.registerCommand(CommandCreator<RotateCommand>, "rotate");
+void registerCommands(AutoManager &manager){
+    manager.registerCommand<DriveCommand>("drive");
+    manager.registerCommand<RotateCommand>("rotate");
     manager.registerBackgroundCommand<IntakeCommand>({"intake_in", "intake_out", "intake_stop"});
     manager.registerBackgroundCommand<LifterCommand>("move_lifter");
-    
+}
+
+// AutoTest [--telemetry log.bin] [--snapshot file] [script]   Run a script in real time at 20Hz (optionally logging telemetry
+//                                                             and resuming from / saving snapshots, ex --snapshot /dev/shm/auto.snap)
+// AutoTest --simulate script...                                Run scripts with simulated time as fast as possible (fails if any script does not finish)
+int main(int argc, char *argv[]){
+    std::vector<std::string> scripts;
+    std::string telemetryFile;
+    std::string snapshotFile;
+    bool simulate = false;
+    for(int i = 1; i < argc; ++i){
+        if(std::string(argv[i]) == "--simulate")
+            simulate = true;
+        else if(std::string(argv[i]) == "--telemetry" && i + 1 < argc)
+            telemetryFile = argv[++i];
+        else if(std::string(argv[i]) == "--snapshot" && i + 1 < argc)
+            snapshotFile = argv[++i];
+        else
+            scripts.push_back(argv[i]);
+    }
+    if(scripts.empty())
+        scripts.push_back("F:/Projects/FRC/TestProj/Test.csv"); // Mock script
+
+    if(simulate){
+        std::vector<SimulationCase> cases;
+        for(const std::string &script : scripts){
+            SimulationCase simulationCase;
+            simulationCase.name = script;
+            simulationCase.setup = [script](AutoManager &manager){
+                registerCommands(manager);
+                manager.setDurationLimit(std::chrono::seconds(15)); // Scripts that may not finish are rejected before running
+                return manager.loadScript(script);
+            };
+            cases.push_back(simulationCase);
+        }
+
+        AutoSimulator simulator;
+        std::vector<SimulationResult> results = simulator.runBatch(cases);
+        bool passed = true;
+        for(size_t i = 0; i < results.size(); ++i){
+            const SimulationResult &result = results[i];
+            std::cout << cases[i].name << ": ";
+            if(!result.loaded)
+                std::cout << "failed to load";
+            else if(!result.finished)
+                std::cout << "did not finish in " << std::chrono::duration<double>(simulator.getTimeLimit()).count() << "s";
+            else
+                std::cout << "finished at " << std::chrono::duration<double>(result.simulatedTime).count() << "s ("
+                          << result.ticks << " ticks)";
+            std::cout << std::endl;
+            passed = passed && result.loaded && result.finished;
+        }
+        return passed ? 0 : 1;
+    }
+
+    // Register commands with their names
+    registerCommands(manager);
+
     // Load a mock script
-    manager.loadScript("F:/Projects/FRC/TestProj/Test.csv");
+    manager.loadScript(scripts[0]);
+
+    // Log command starts and ends (decode with AutoTelemetry)
+    TelemetryLog telemetry;
+    if(!telemetryFile.empty() && telemetry.open(telemetryFile))
+        manager.setTelemetry(&telemetry);
+
+    // Resume where an earlier run of the same script stopped then save a snapshot every tick
+    SnapshotBuffer snapshots;
+    if(!snapshotFile.empty() && snapshots.open(snapshotFile)){
+        if(manager.restoreSnapshot(snapshots))
+            std::cout << "Resumed from snapshot." << std::endl;
+        manager.setSnapshotBuffer(&snapshots);
+    }
+
+    // Run the mock script at 20Hz
+    PeriodicRunner runner(manager, 20);
+    runner.run();
 
-    // Run the mock script
-    bool hasMore = true;
-    do{
-        hasMore = manager.process();
-        std::this_thread::sleep_for(std::chrono::milliseconds(50));
-    }while(hasMore);
+    // The script finished so the next run starts from the beginning
+    manager.setSnapshotBuffer(nullptr);
+    snapshots.clear();
 
-    std::cout << "Simulated script complete." << std::endl;
+    std::cout << "Simulated script complete. " << runner.getStats().ticks << " ticks, "
+              << runner.getStats().overruns << " overruns." << std::endl;
 
+    manager.setTelemetry(nullptr);
     return 0;
-}
\ No newline at end of file
+}
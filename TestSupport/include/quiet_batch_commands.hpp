@@ -0,0 +1,98 @@
+/**
+ * quiet_batch_commands.hpp
+ * Batch versions of the quiet commands (same behavior as TickCommand, IntakeCommand and LifterCommand)
+ * for the tests and benchmarks. Each loop goes over every instance without branches so the compiler can vectorize it.
+ *
+ * Copyright (c) 2018 FRC Team 2655 - The Flying Platypi
+ * See LICENSE file for details
+ */
+
+#pragma once
+
+#include <autobatch.hpp>
+
+#include <vector>
+#include <cstdint>
+
+namespace quiet{
+
+class BatchTickCommand : public team2655::BatchAutoCommand{
+private:
+	std::vector<int32_t> ticksLeft;
+public:
+	size_t argumentCount() const override { return 1; }
+	void resize(size_t count, team2655::AutoTime period) override {
+		ticksLeft.assign(count, 0);
+	}
+	void start(std::string_view commandName, const team2655::BatchArgs &args, const uint8_t *starting) override {
+		const double *seconds = args[0];
+		int32_t *left = ticksLeft.data();
+		for(size_t i = 0, count = ticksLeft.size(); i < count; ++i){
+			left[i] = starting[i] ? (int32_t)(seconds[i] * 10) : left[i];
+		}
+	}
+	void process(const uint8_t *running, uint8_t *finished) override {
+		int32_t *left = ticksLeft.data();
+		for(size_t i = 0, count = ticksLeft.size(); i < count; ++i){
+			left[i] -= running[i];
+			finished[i] |= running[i] & (left[i] <= 0);
+		}
+	}
+};
+
+class BatchIntakeCommand : public team2655::BatchBackgroundCommand{
+private:
+	std::vector<float> speed;
+public:
+	size_t argumentCount() const override { return 0; }
+	void resize(size_t count, team2655::AutoTime period) override {
+		speed.assign(count, 0);
+	}
+	void update(std::string_view commandName, const team2655::BatchArgs &args, const uint8_t *updating) override {
+		float value = (commandName == "intake_in") ? 1.0f : (commandName == "intake_out") ? -1.0f : 0.0f;
+		for(size_t i = 0, count = speed.size(); i < count; ++i){
+			speed[i] = updating[i] ? value : speed[i];
+		}
+	}
+	void process() override {  }
+};
+
+class BatchLifterCommand : public team2655::BatchBackgroundCommand{
+private:
+	std::vector<int32_t> targetPos;
+	std::vector<int32_t> currentPos;
+public:
+	size_t argumentCount() const override { return 1; }
+	void resize(size_t count, team2655::AutoTime period) override {
+		targetPos.assign(count, 0);
+		currentPos.assign(count, 0);
+	}
+	void update(std::string_view commandName, const team2655::BatchArgs &args, const uint8_t *updating) override {
+		const double *target = args[0];
+		for(size_t i = 0, count = targetPos.size(); i < count; ++i){
+			targetPos[i] = updating[i] ? (int32_t)target[i] : targetPos[i];
+		}
+	}
+	void process() override {
+		int32_t *target = targetPos.data();
+		int32_t *current = currentPos.data();
+		for(size_t i = 0, count = targetPos.size(); i < count; ++i){
+			current[i] += (target[i] > current[i]) - (target[i] < current[i]);
+		}
+	}
+	int32_t position(size_t instance) const { return currentPos[instance]; }
+};
+
+/**
+ * Register the quiet batch commands with the names used by Test.csv
+ */
+inline void registerBatchCommands(team2655::AutoBatch &batch){
+	batch.registerCommand<BatchTickCommand>("drive");
+	batch.registerCommand<BatchTickCommand>("rotate");
+	batch.registerBackgroundCommand<BatchIntakeCommand>("intake_in");
+	batch.registerBackgroundCommand<BatchIntakeCommand>("intake_out");
+	batch.registerBackgroundCommand<BatchIntakeCommand>("intake_stop");
+	batch.registerBackgroundCommand<BatchLifterCommand>("move_lifter");
+}
+
+}
@@ -0,0 +1,116 @@
+/**
+ * quiet_commands.hpp
+ * Quiet versions of the example commands for the tests and benchmarks.
+ * Blocking commands finish after a number of ticks (10 per second of argument) instead of real time.
+ *
+ * Copyright (c) 2018 FRC Team 2655 - The Flying Platypi
+ * See LICENSE file for details
+ */
+
+#pragma once
+
+#include <autonomous.hpp>
+#include <autostatic.hpp>
+
+#include <cstdlib>
+
+namespace quiet{
+
+class TickCommand : public team2655::TypedAutoCommand<double>{
+private:
+	int ticksLeft = 0;
+public:
+	static constexpr std::string_view Names[] = { "drive", "rotate" }; // For StaticAutoManager
+	void start(std::string_view commandName, const std::tuple<double> &args) override {
+		ticksLeft = (int)(std::get<0>(args) * 10);
+	}
+	void process() override {
+		if(--ticksLeft <= 0)
+			complete();
+	}
+	void handleComplete() override {  }
+	void reset() override {
+		ticksLeft = 0;
+	}
+	void saveState(team2655::SnapshotWriter &out) override {
+		out.write(ticksLeft);
+	}
+	bool restoreState(team2655::SnapshotReader &in) override {
+		return in.read(ticksLeft);
+	}
+};
+
+class IntakeCommand : public team2655::TypedBackgroundAutoCommand<>{
+public:
+	static constexpr std::string_view Names[] = { "intake_in", "intake_out", "intake_stop" };
+	double speed = 0;
+	int ticks = 0; // Ticks processed
+	void updateArgs(std::string_view commandName, const std::tuple<> &args) override {
+		if(commandName == "intake_in"){
+			speed = 1;
+		}else if(commandName == "intake_out"){
+			speed = -1;
+		}else{
+			speed = 0;
+			sleep(); // Nothing to do until the script changes the speed
+		}
+	}
+	void process() override {
+		ticks++;
+	}
+	void kill() override {
+		speed = 0;
+		sleep();
+	}
+	bool shouldProcess() override {
+		return speed != 0;
+	}
+	void saveState(team2655::SnapshotWriter &out) override {
+		out.write(ticks);
+	}
+	bool restoreState(team2655::SnapshotReader &in) override {
+		return in.read(ticks);
+	}
+};
+
+class LifterCommand : public team2655::TypedBackgroundAutoCommand<int>{
+public:
+	static constexpr std::string_view Name = "move_lifter";
+	int targetPos = 0;
+	int currentPos = 0;
+	void updateArgs(std::string_view commandName, const std::tuple<int> &args) override {
+		targetPos = std::get<0>(args);
+	}
+	void process() override {
+		currentPos += (targetPos > currentPos) ? 1 : -1;
+		if(currentPos == targetPos)
+			sleep(); // At the target until the script gives a new one
+	}
+	void kill() override {
+		targetPos = currentPos;
+		sleep();
+	}
+	bool shouldProcess() override {
+		return std::abs(targetPos - currentPos) != 0;
+	}
+	void saveState(team2655::SnapshotWriter &out) override {
+		out.write(currentPos); // The target comes back from the script row
+	}
+	bool restoreState(team2655::SnapshotReader &in) override {
+		return in.read(currentPos);
+	}
+};
+
+typedef team2655::StaticAutoManager<TickCommand, IntakeCommand, LifterCommand> StaticQuietManager;
+
+/**
+ * Register the quiet commands with the names used by Test.csv and the synthetic benchmark scripts
+ */
+inline void registerCommands(team2655::AutoManager &manager){
+	manager.registerCommand<TickCommand>("drive");
+	manager.registerCommand<TickCommand>("rotate");
+	manager.registerBackgroundCommand<IntakeCommand>({"intake_in", "intake_out", "intake_stop"});
+	manager.registerBackgroundCommand<LifterCommand>("move_lifter");
+}
+
+}